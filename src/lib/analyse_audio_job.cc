@@ -26,15 +26,8 @@
 #include "film.h"
 #include "player.h"
 #include "playlist.h"
-#include "filter.h"
-#include "audio_filter_graph.h"
+#include "loudness_meter.h"
 #include "config.h"
-extern "C" {
-#include <libavutil/channel_layout.h>
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-#include <libavfilter/f_ebur128.h>
-#endif
-}
 #include <boost/foreach.hpp>
 #include <iostream>
 
@@ -51,7 +44,10 @@ using boost::dynamic_pointer_cast;
 using namespace boost::placeholders;
 #endif
 
-int const AnalyseAudioJob::_num_points = 1024;
+/** Number of points at the finest resolution of the analysis; AudioAnalysis
+ *  makes coarser resolutions from these.
+ */
+int const AnalyseAudioJob::_num_points = 16384;
 
 /** @param from_zero true to analyse audio from time 0 in the playlist, otherwise begin at Playlist::start */
 AnalyseAudioJob::AnalyseAudioJob (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist, bool from_zero)
@@ -64,14 +60,10 @@ AnalyseAudioJob::AnalyseAudioJob (shared_ptr<const Film> film, shared_ptr<const
 	, _current (0)
 	, _sample_peak (new float[film->audio_channels()])
 	, _sample_peak_frame (new Frame[film->audio_channels()])
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-	, _ebur128 (new AudioFilterGraph (film->audio_frame_rate(), film->audio_channels()))
-#endif
 {
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-	_filters.push_back (new Filter ("ebur128", "ebur128", "audio", "ebur128=peak=true"));
-	_ebur128->setup (_filters);
-#endif
+	if (Config::instance()->analyse_ebur128 ()) {
+		_loudness_meter.reset (new LoudnessMeter (film->audio_frame_rate(), film->audio_channels()));
+	}
 
 	for (int i = 0; i < film->audio_channels(); ++i) {
 		_sample_peak[i] = 0;
@@ -86,9 +78,6 @@ AnalyseAudioJob::AnalyseAudioJob (shared_ptr<const Film> film, shared_ptr<const
 AnalyseAudioJob::~AnalyseAudioJob ()
 {
 	stop_thread ();
-	BOOST_FOREACH (Filter const * i, _filters) {
-		delete const_cast<Filter*> (i);
-	}
 	delete[] _current;
 	delete[] _sample_peak;
 	delete[] _sample_peak_frame;
@@ -146,18 +135,12 @@ AnalyseAudioJob::run ()
 	}
 	_analysis->set_sample_peak (sample_peak);
 
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-	if (Config::instance()->analyse_ebur128 ()) {
-		void* eb = _ebur128->get("Parsed_ebur128_0")->priv;
-		vector<float> true_peak;
-		for (int i = 0; i < _film->audio_channels(); ++i) {
-			true_peak.push_back (av_ebur128_get_true_peaks(eb)[i]);
-		}
-		_analysis->set_true_peak (true_peak);
-		_analysis->set_integrated_loudness (av_ebur128_get_integrated_loudness(eb));
-		_analysis->set_loudness_range (av_ebur128_get_loudness_range(eb));
+	if (_loudness_meter) {
+		_analysis->set_true_peak (_loudness_meter->true_peaks ());
+		/* Report silence as the absolute gate, -70LUFS */
+		_analysis->set_integrated_loudness (_loudness_meter->integrated_loudness().get_value_or(-70));
+		_analysis->set_loudness_range (_loudness_meter->loudness_range ());
 	}
-#endif
 
 	if (_playlist->content().size() == 1) {
 		/* If there was only one piece of content in this analysis we may later need to know what its
@@ -182,11 +165,9 @@ AnalyseAudioJob::analyse (shared_ptr<const AudioBuffers> b, DCPTime time)
 {
 	DCPOMATIC_ASSERT (time >= _start);
 
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-	if (Config::instance()->analyse_ebur128 ()) {
-		_ebur128->process (b);
+	if (_loudness_meter) {
+		_loudness_meter->process (b);
 	}
-#endif
 
 	int const frames = b->frames ();
 	int const channels = b->channels ();
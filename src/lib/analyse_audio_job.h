@@ -31,12 +31,11 @@ class AudioBuffers;
 class AudioAnalysis;
 class Playlist;
 class AudioPoint;
-class AudioFilterGraph;
-class Filter;
+class LoudnessMeter;
 
 /** @class AnalyseAudioJob
  *  @brief A job to analyse the audio of a film and make a note of its
- *  broad peak and RMS levels.
+ *  broad peak and RMS levels and, if required, its loudness and true peaks.
  *
  *  After computing the peak and RMS levels the job will write a file
  *  to Film::audio_analysis_path.
@@ -73,8 +72,8 @@ private:
 
 	boost::shared_ptr<AudioAnalysis> _analysis;
 
-	boost::shared_ptr<AudioFilterGraph> _ebur128;
-	std::vector<Filter const *> _filters;
+	/** Meter for integrated loudness, loudness range and true peak, if required */
+	boost::shared_ptr<LoudnessMeter> _loudness_meter;
 
 	static const int _num_points;
 };
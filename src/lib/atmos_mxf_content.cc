@@ -67,7 +67,9 @@ AtmosMXFContent::valid_mxf (boost::filesystem::path path)
 void
 AtmosMXFContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 {
-	job->set_progress_unknown ();
+	if (job) {
+		job->set_progress_unknown ();
+	}
 	Content::examine (film, job);
 	shared_ptr<dcp::AtmosAsset> a (new dcp::AtmosAsset (path(0)));
 
@@ -75,6 +77,8 @@ AtmosMXFContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 		boost::mutex::scoped_lock lm (_mutex);
 		_length = a->intrinsic_duration ();
 	}
+
+	invalidate_xml_cache ();
 }
 
 string
@@ -23,13 +23,17 @@
 #include "util.h"
 #include "playlist.h"
 #include "audio_content.h"
+#include "exceptions.h"
 #include <dcp/raw_convert.h>
 #include <libxml++/libxml++.h>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
+#include <boost/scoped_array.hpp>
 #include <stdint.h>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <iostream>
 #include <inttypes.h>
 
@@ -45,97 +49,220 @@ using std::list;
 using boost::shared_ptr;
 using boost::optional;
 using boost::dynamic_pointer_cast;
+using boost::scoped_array;
 using dcp::raw_convert;
 
-int const AudioAnalysis::_current_state_version = 3;
+int const AudioAnalysis::_current_state_version = 4;
+int const AudioAnalysis::_minimum_level_points = 64;
+
+/** Identifier at the start of an analysis file */
+static char const magic[8] = { 'D', 'C', 'P', 'O', 'M', 'A', 'A', 'N' };
+/** Written as a native uint32_t so that we can spot files from a machine with different endianness */
+static uint32_t const byte_order = 0x01020304;
 
 AudioAnalysis::AudioAnalysis (int channels)
 {
-	_data.resize (channels);
+	_data.resize (1);
+	_data[0].resize (channels);
 }
 
+/** Load an analysis written by write().  The file starts with some identification,
+ *  followed by an XML description of everything except the peak/RMS points; then the
+ *  points for each level and channel follow as raw floats.
+ */
 AudioAnalysis::AudioAnalysis (boost::filesystem::path filename)
 {
-	cxml::Document f ("AudioAnalysis");
-	f.read_file (filename);
-
-	if (f.optional_number_child<int>("Version").get_value_or(1) < _current_state_version) {
-		/* Too old.  Throw an exception so that this analysis is re-run. */
-		throw OldFormatError ("Audio analysis file is too old");
+	FILE* f = fopen_boost (filename, "rb");
+	if (!f) {
+		throw OpenFileError (filename, errno, OpenFileError::READ);
 	}
 
-	BOOST_FOREACH (cxml::NodePtr i, f.node_children ("Channel")) {
-		vector<AudioPoint> channel;
+	try {
+		char m[sizeof(magic)];
+		uint32_t order = 0;
+		if (
+			fread (m, sizeof(m), 1, f) != 1 || memcmp (m, magic, sizeof(magic)) != 0 ||
+			fread (&order, sizeof(order), 1, f) != 1 || order != byte_order
+			) {
+			/* An old XML analysis or one from a machine of the other endianness.
+			   Throw an exception so that this analysis is re-run.
+			*/
+			throw OldFormatError ("Audio analysis file is too old");
+		}
+
+		uint32_t length;
+		checked_fread (&length, sizeof(length), f, filename);
+		scoped_array<char> xml (new char[length + 1]);
+		checked_fread (xml.get(), length, f, filename);
+		xml[length] = '\0';
 
-		BOOST_FOREACH (cxml::NodePtr j, i->node_children ("Point")) {
-			channel.push_back (AudioPoint (j));
+		cxml::Document doc ("AudioAnalysis");
+		doc.read_string (xml.get ());
+
+		if (doc.number_child<int>("Version") < _current_state_version) {
+			throw OldFormatError ("Audio analysis file is too old");
+		}
+
+		BOOST_FOREACH (cxml::ConstNodePtr i, doc.node_children ("SamplePeak")) {
+			_sample_peak.push_back (
+				PeakTime (
+					dcp::raw_convert<float>(i->content()), DCPTime(i->number_attribute<Frame>("Time"))
+					)
+				);
 		}
 
-		_data.push_back (channel);
+		BOOST_FOREACH (cxml::ConstNodePtr i, doc.node_children ("TruePeak")) {
+			_true_peak.push_back (dcp::raw_convert<float> (i->content ()));
+		}
+
+		_integrated_loudness = doc.optional_number_child<float> ("IntegratedLoudness");
+		_loudness_range = doc.optional_number_child<float> ("LoudnessRange");
+
+		_analysis_gain = doc.optional_number_child<double> ("AnalysisGain");
+		_samples_per_point = doc.number_child<int64_t> ("SamplesPerPoint");
+		_sample_rate = doc.number_child<int64_t> ("SampleRate");
+
+		BOOST_FOREACH (cxml::ConstNodePtr i, doc.node_children ("Level")) {
+			vector<vector<AudioPoint> > level;
+			BOOST_FOREACH (cxml::ConstNodePtr j, i->node_children ("Points")) {
+				level.push_back (vector<AudioPoint> ());
+				read_points (f, filename, level.back(), dcp::raw_convert<int> (j->content ()));
+			}
+			_data.push_back (level);
+		}
+	} catch (...) {
+		fclose (f);
+		throw;
 	}
 
-	BOOST_FOREACH (cxml::ConstNodePtr i, f.node_children ("SamplePeak")) {
-		_sample_peak.push_back (
-			PeakTime (
-				dcp::raw_convert<float>(i->content()), DCPTime(i->number_attribute<Frame>("Time"))
-				)
-			);
+	fclose (f);
+
+	if (_data.empty ()) {
+		throw OldFormatError ("Audio analysis file has no data");
 	}
+}
 
-	BOOST_FOREACH (cxml::ConstNodePtr i, f.node_children ("TruePeak")) {
-		_true_peak.push_back (dcp::raw_convert<float> (i->content ()));
+void
+AudioAnalysis::read_points (FILE* f, boost::filesystem::path filename, vector<AudioPoint>& points, int n)
+{
+	vector<float> buffer (n * AudioPoint::COUNT);
+	if (n > 0) {
+		checked_fread (&buffer[0], buffer.size() * sizeof(float), f, filename);
 	}
 
-	_integrated_loudness = f.optional_number_child<float> ("IntegratedLoudness");
-	_loudness_range = f.optional_number_child<float> ("LoudnessRange");
+	points.resize (n);
+	float const * p = buffer.empty() ? 0 : &buffer[0];
+	for (int i = 0; i < n; ++i) {
+		for (int j = 0; j < AudioPoint::COUNT; ++j) {
+			points[i][j] = *p++;
+		}
+	}
+}
+
+void
+AudioAnalysis::write_points (FILE* f, boost::filesystem::path filename, vector<AudioPoint> const & points) const
+{
+	vector<float> buffer;
+	buffer.reserve (points.size() * AudioPoint::COUNT);
+	BOOST_FOREACH (AudioPoint i, points) {
+		for (int j = 0; j < AudioPoint::COUNT; ++j) {
+			buffer.push_back (i[j]);
+		}
+	}
 
-	_analysis_gain = f.optional_number_child<double> ("AnalysisGain");
-	_samples_per_point = f.number_child<int64_t> ("SamplesPerPoint");
-	_sample_rate = f.number_child<int64_t> ("SampleRate");
+	if (!buffer.empty ()) {
+		checked_fwrite (&buffer[0], buffer.size() * sizeof(float), f, filename);
+	}
 }
 
 void
 AudioAnalysis::add_point (int c, AudioPoint const & p)
 {
 	DCPOMATIC_ASSERT (c < channels ());
-	_data[c].push_back (p);
+	/* Any coarser levels are now out of date */
+	_data.resize (1);
+	_data[0][c].push_back (p);
 }
 
 AudioPoint
-AudioAnalysis::get_point (int c, int p) const
+AudioAnalysis::get_point (int c, int p, int level) const
 {
-	DCPOMATIC_ASSERT (p < points (c));
-	return _data[c][p];
+	DCPOMATIC_ASSERT (p < points (c, level));
+	return _data[level][c][p];
 }
 
 int
 AudioAnalysis::channels () const
 {
-	return _data.size ();
+	return _data.front().size ();
 }
 
 int
-AudioAnalysis::points (int c) const
+AudioAnalysis::points (int c, int level) const
 {
+	DCPOMATIC_ASSERT (level < levels ());
 	DCPOMATIC_ASSERT (c < channels ());
-	return _data[c].size ();
+	return _data[level][c].size ();
+}
+
+int
+AudioAnalysis::levels () const
+{
+	return _data.size ();
+}
+
+/** @param points Number of points that the caller would like.
+ *  @return The coarsest level which has at least that many points, or the finest level
+ *  if there is no such level.
+ */
+int
+AudioAnalysis::level_for (int points) const
+{
+	if (channels() == 0) {
+		return 0;
+	}
+
+	int level = 0;
+	while ((level + 1) < levels() && this->points(0, level + 1) >= points) {
+		++level;
+	}
+	return level;
+}
+
+/** Make the coarser levels from level 0 by combining adjacent pairs of points */
+void
+AudioAnalysis::make_levels ()
+{
+	_data.resize (1);
+
+	while (!_data.back().empty() && static_cast<int>(_data.back().front().size()) >= _minimum_level_points * 2) {
+		vector<vector<AudioPoint> > const & finer = _data.back ();
+		vector<vector<AudioPoint> > coarser (finer.size ());
+		for (size_t i = 0; i < finer.size(); ++i) {
+			for (size_t j = 0; j < finer[i].size(); j += 2) {
+				AudioPoint a = finer[i][j];
+				if ((j + 1) < finer[i].size()) {
+					AudioPoint b = finer[i][j + 1];
+					a[AudioPoint::PEAK] = max (a[AudioPoint::PEAK], b[AudioPoint::PEAK]);
+					a[AudioPoint::RMS] = sqrt ((pow (a[AudioPoint::RMS], 2) + pow (b[AudioPoint::RMS], 2)) / 2);
+				}
+				coarser[i].push_back (a);
+			}
+		}
+		_data.push_back (coarser);
+	}
 }
 
 void
 AudioAnalysis::write (boost::filesystem::path filename)
 {
+	make_levels ();
+
 	shared_ptr<xmlpp::Document> doc (new xmlpp::Document);
 	xmlpp::Element* root = doc->create_root_node ("AudioAnalysis");
 
 	root->add_child("Version")->add_child_text (raw_convert<string> (_current_state_version));
 
-	BOOST_FOREACH (vector<AudioPoint>& i, _data) {
-		xmlpp::Element* channel = root->add_child ("Channel");
-		BOOST_FOREACH (AudioPoint& j, i) {
-			j.as_xml (channel->add_child ("Point"));
-		}
-	}
-
 	for (size_t i = 0; i < _sample_peak.size(); ++i) {
 		xmlpp::Element* n = root->add_child("SamplePeak");
 		n->add_child_text (raw_convert<string> (_sample_peak[i].peak));
@@ -161,7 +288,44 @@ AudioAnalysis::write (boost::filesystem::path filename)
 	root->add_child("SamplesPerPoint")->add_child_text (raw_convert<string> (_samples_per_point));
 	root->add_child("SampleRate")->add_child_text (raw_convert<string> (_sample_rate));
 
-	doc->write_to_file_formatted (filename.string ());
+	/* Describe the points that follow the XML */
+	BOOST_FOREACH (vector<vector<AudioPoint> > const & i, _data) {
+		xmlpp::Element* level = root->add_child ("Level");
+		BOOST_FOREACH (vector<AudioPoint> const & j, i) {
+			level->add_child("Points")->add_child_text (raw_convert<string> (j.size ()));
+		}
+	}
+
+	string const xml = doc->write_to_string ();
+
+	boost::filesystem::path tmp = filename;
+	tmp += ".tmp";
+
+	FILE* f = fopen_boost (tmp, "wb");
+	if (!f) {
+		throw OpenFileError (tmp, errno, OpenFileError::WRITE);
+	}
+
+	try {
+		checked_fwrite (magic, sizeof(magic), f, tmp);
+		checked_fwrite (&byte_order, sizeof(byte_order), f, tmp);
+		uint32_t const length = xml.length ();
+		checked_fwrite (&length, sizeof(length), f, tmp);
+		checked_fwrite (xml.c_str(), length, f, tmp);
+
+		BOOST_FOREACH (vector<vector<AudioPoint> > const & i, _data) {
+			BOOST_FOREACH (vector<AudioPoint> const & j, i) {
+				write_points (f, tmp, j);
+			}
+		}
+	} catch (...) {
+		fclose (f);
+		boost::filesystem::remove (tmp);
+		throw;
+	}
+
+	fclose (f);
+	boost::filesystem::rename (tmp, filename);
 }
 
 float
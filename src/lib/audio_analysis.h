@@ -26,6 +26,7 @@
 #include <libcxml/cxml.h>
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
+#include <cstdio>
 #include <vector>
 
 namespace xmlpp {
@@ -34,6 +35,14 @@ namespace xmlpp {
 
 class Playlist;
 
+/** @class AudioAnalysis
+ *  @brief The results of an audio analysis: peak and RMS levels over time for each channel,
+ *  along with overall peak and loudness figures.
+ *
+ *  The peak/RMS points are held at several resolutions.  Level 0 is the finest, as added
+ *  with add_point(); each subsequent level has half as many points as the one before.
+ *  Analyses are stored on disk in a binary format so that they can be loaded quickly.
+ */
 class AudioAnalysis : public boost::noncopyable
 {
 public:
@@ -68,9 +77,11 @@ public:
 		_loudness_range = r;
 	}
 
-	AudioPoint get_point (int c, int p) const;
-	int points (int c) const;
+	AudioPoint get_point (int c, int p, int level = 0) const;
+	int points (int c, int level = 0) const;
 	int channels () const;
+	int levels () const;
+	int level_for (int points) const;
 
 	std::vector<PeakTime> sample_peak () const {
 		return _sample_peak;
@@ -100,8 +111,11 @@ public:
 		_analysis_gain = gain;
 	}
 
-	int64_t samples_per_point () const {
-		return _samples_per_point;
+	/** @param level Resolution level.
+	 *  @return Number of audio samples covered by each point at that level.
+	 */
+	int64_t samples_per_point (int level = 0) const {
+		return _samples_per_point << level;
 	}
 
 	void set_samples_per_point (int64_t spp) {
@@ -121,7 +135,12 @@ public:
 	float gain_correction (boost::shared_ptr<const Playlist> playlist);
 
 private:
-	std::vector<std::vector<AudioPoint> > _data;
+	void make_levels ();
+	void read_points (FILE* f, boost::filesystem::path filename, std::vector<AudioPoint>& points, int n);
+	void write_points (FILE* f, boost::filesystem::path filename, std::vector<AudioPoint> const & points) const;
+
+	/** Points indexed by level, then channel, then point */
+	std::vector<std::vector<std::vector<AudioPoint> > > _data;
 	std::vector<PeakTime> _sample_peak;
 	std::vector<float> _true_peak;
 	boost::optional<float> _integrated_loudness;
@@ -135,6 +154,8 @@ private:
 	int _sample_rate;
 
 	static int const _current_state_version;
+	/** The coarsest level that make_levels() will create will have at least this many points */
+	static int const _minimum_level_points;
 };
 
 #endif
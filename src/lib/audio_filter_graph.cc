@@ -160,10 +160,6 @@ AudioFilterGraph::process (shared_ptr<const AudioBuffers> buffers)
 			break;
 		}
 
-		/* We don't extract audio data here, since the only use of this class
-		   is for ebur128.
-		*/
-
 		av_frame_unref (_frame);
 	}
 }
@@ -21,8 +21,10 @@
 #include "audio_ring_buffers.h"
 #include "dcpomatic_assert.h"
 #include "exceptions.h"
+#include "dcpomatic_log.h"
 #include <boost/foreach.hpp>
 #include <iostream>
+#include <cstring>
 
 using std::min;
 using std::cout;
@@ -34,11 +36,14 @@ using boost::optional;
 
 AudioRingBuffers::AudioRingBuffers ()
 	: _used_in_head (0)
+	, _frame_rate (48000)
 {
 
 }
 
-/** @param frame_rate Frame rate in use; this is only used to check timing consistency of the incoming data */
+/** @param frame_rate Frame rate in use; this is used to check timing consistency of the incoming data
+ *  and to work out the times of the data that get() returns.
+ */
 void
 AudioRingBuffers::put (shared_ptr<const AudioBuffers> data, DCPTime time, int frame_rate)
 {
@@ -54,6 +59,7 @@ AudioRingBuffers::put (shared_ptr<const AudioBuffers> data, DCPTime time, int fr
 	}
 
 	_buffers.push_back(make_pair(data, time));
+	_frame_rate = frame_rate;
 }
 
 /** @return time of the returned data; if it's not set this indicates an underrun */
@@ -77,7 +83,7 @@ AudioRingBuffers::get (float* out, int channels, int frames)
 
 		pair<shared_ptr<const AudioBuffers>, DCPTime> front = _buffers.front ();
 		if (!time) {
-			time = front.second + DCPTime::from_frames(_used_in_head, 48000);
+			time = front.second + DCPTime::from_frames(_used_in_head, _frame_rate);
 		}
 
 		int const to_do = min (frames, front.first->frames() - _used_in_head);
@@ -103,6 +109,50 @@ AudioRingBuffers::get (float* out, int channels, int frames)
 	return time;
 }
 
+/** Fill `out' with planar audio; any channels of `out' which we do not have are made silent,
+ *  as are any frames that we cannot fill.
+ *  @return time of this audio, or unset if there was a buffer underrun.
+ */
+optional<DCPTime>
+AudioRingBuffers::get (shared_ptr<AudioBuffers> out)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	optional<DCPTime> time;
+
+	int done = 0;
+	while (done < out->frames()) {
+		if (_buffers.empty ()) {
+			out->make_silent (done, out->frames() - done);
+			LOG_WARNING ("Audio underrun; missing %1 frames", out->frames() - done);
+			return time;
+		}
+
+		pair<shared_ptr<const AudioBuffers>, DCPTime> front = _buffers.front ();
+		if (!time) {
+			time = front.second + DCPTime::from_frames(_used_in_head, _frame_rate);
+		}
+
+		int const to_do = min (out->frames() - done, front.first->frames() - _used_in_head);
+		int const c = min (front.first->channels(), out->channels());
+		for (int i = 0; i < c; ++i) {
+			memcpy (out->data(i) + done, front.first->data(i) + _used_in_head, to_do * sizeof(float));
+		}
+		for (int i = c; i < out->channels(); ++i) {
+			memset (out->data(i) + done, 0, to_do * sizeof(float));
+		}
+		_used_in_head += to_do;
+		done += to_do;
+
+		if (_used_in_head == front.first->frames()) {
+			_buffers.pop_front ();
+			_used_in_head = 0;
+		}
+	}
+
+	return time;
+}
+
 optional<DCPTime>
 AudioRingBuffers::peek () const
 {
@@ -35,6 +35,7 @@ public:
 
 	void put (boost::shared_ptr<const AudioBuffers> data, DCPTime time, int frame_rate);
 	boost::optional<DCPTime> get (float* out, int channels, int frames);
+	boost::optional<DCPTime> get (boost::shared_ptr<AudioBuffers> out);
 	boost::optional<DCPTime> peek () const;
 
 	void clear ();
@@ -44,6 +45,8 @@ private:
 	mutable boost::mutex _mutex;
 	std::list<std::pair<boost::shared_ptr<const AudioBuffers>, DCPTime> > _buffers;
 	int _used_in_head;
+	/** Frame rate of the data that we were last given */
+	int _frame_rate;
 };
 
 #endif
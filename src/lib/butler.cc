@@ -26,6 +26,8 @@
 #include "cross.h"
 #include "compose.hpp"
 #include "exceptions.h"
+#include "trace.h"
+#include "metrics.h"
 #include <boost/weak_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -243,6 +245,7 @@ Butler::get_video (Error* e)
 	}
 
 	pair<shared_ptr<PlayerVideo>, DCPTime> const r = _video.get ();
+	Metrics::instance()->set ("butler_video_frames", _video.size());
 	_summon.notify_all ();
 	return r;
 }
@@ -291,6 +294,7 @@ try
 	/* If the weak_ptr cannot be locked the video obviously no longer requires any work */
 	if (video) {
 		LOG_TIMING("start-prepare in %1", thread_id());
+		TraceSpan span ("prepare");
 		video->prepare (_pixel_format, _aligned, _fast);
 		LOG_TIMING("finish-prepare in %1", thread_id());
 	}
@@ -316,6 +320,7 @@ Butler::video (shared_ptr<PlayerVideo> video, DCPTime time)
 
 	boost::mutex::scoped_lock lm2 (_buffers_mutex);
 	_video.put (video, time);
+	Metrics::instance()->set ("butler_video_frames", _video.size());
 }
 
 void
@@ -331,6 +336,7 @@ Butler::audio (shared_ptr<AudioBuffers> audio, DCPTime time, int frame_rate)
 
 	boost::mutex::scoped_lock lm2 (_buffers_mutex);
 	_audio.put (remap (audio, _audio_channels, _audio_mapping), time, frame_rate);
+	Metrics::instance()->set ("butler_audio_frames", _audio.size());
 }
 
 /** Try to get `frames' frames of audio and copy it into `out'.  Silence
@@ -341,6 +347,17 @@ optional<DCPTime>
 Butler::get_audio (float* out, Frame frames)
 {
 	optional<DCPTime> t = _audio.get (out, _audio_channels, frames);
+	Metrics::instance()->set ("butler_audio_frames", _audio.size());
+	_summon.notify_all ();
+	return t;
+}
+
+/** As get_audio() above, but giving planar audio; `out' will be filled with as many frames as it has */
+optional<DCPTime>
+Butler::get_audio (shared_ptr<AudioBuffers> out)
+{
+	optional<DCPTime> t = _audio.get (out);
+	Metrics::instance()->set ("butler_audio_frames", _audio.size());
 	_summon.notify_all ();
 	return t;
 }
@@ -57,6 +57,7 @@ public:
 
 	std::pair<boost::shared_ptr<PlayerVideo>, DCPTime> get_video (Error* e = 0);
 	boost::optional<DCPTime> get_audio (float* out, Frame frames);
+	boost::optional<DCPTime> get_audio (boost::shared_ptr<AudioBuffers> out);
 	boost::optional<TextRingBuffers::Data> get_closed_caption ();
 
 	void disable_audio ();
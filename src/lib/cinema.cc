@@ -35,6 +35,7 @@ using dcp::raw_convert;
 Cinema::Cinema (cxml::ConstNodePtr node)
 	: name (node->string_child ("Name"))
 	, notes (node->optional_string_child("Notes").get_value_or(""))
+	, _id (node->optional_string_child("Id").get_value_or(dcp::make_uuid()))
 {
 	BOOST_FOREACH (cxml::ConstNodePtr i, node->node_children("Email")) {
 		emails.push_back (i->content ());
@@ -64,6 +65,7 @@ Cinema::read_screens (cxml::ConstNodePtr node)
 void
 Cinema::as_xml (xmlpp::Element* parent) const
 {
+	parent->add_child("Id")->add_child_text (_id);
 	parent->add_child("Name")->add_child_text (name);
 
 	BOOST_FOREACH (string i, emails) {
@@ -23,6 +23,7 @@
  */
 
 #include <libcxml/cxml.h>
+#include <dcp/util.h>
 #include <boost/enable_shared_from_this.hpp>
 
 namespace xmlpp {
@@ -44,6 +45,7 @@ public:
 		: name (name_)
 		, emails (e)
 		, notes (notes_)
+		, _id (dcp::make_uuid ())
 		, _utc_offset_hour (utc_offset_hour)
 		, _utc_offset_minute (utc_offset_minute)
 	{}
@@ -64,6 +66,11 @@ public:
 	std::list<std::string> emails;
 	std::string notes;
 
+	/** @return an identifier which stays the same when the cinema is edited */
+	std::string id () const {
+		return _id;
+	}
+
 	int utc_offset_hour () const {
 		return _utc_offset_hour;
 	}
@@ -77,6 +84,7 @@ public:
 	}
 
 private:
+	std::string _id;
 	std::list<boost::shared_ptr<Screen> > _screens;
 	/** Offset such that the equivalent time in UTC can be determined
 	    by subtracting the offset from the local time.
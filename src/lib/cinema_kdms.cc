@@ -25,6 +25,7 @@
 #include "config.h"
 #include "util.h"
 #include "emailer.h"
+#include "email_queue.h"
 #include "compose.hpp"
 #include "log.h"
 #include "dcpomatic_log.h"
@@ -39,6 +40,7 @@ using std::string;
 using std::runtime_error;
 using boost::shared_ptr;
 using boost::function;
+using boost::optional;
 
 void
 CinemaKDMs::make_zip_file (boost::filesystem::path zip_file, dcp::NameFormat name_format, dcp::NameFormat::Map name_values) const
@@ -182,12 +184,62 @@ CinemaKDMs::write_zip_files (
 	return written;
 }
 
-/** Email one ZIP file per cinema to the cinema.
+/** Collects the results of sending KDM emails to a set of cinemas */
+class CinemaEmailResults
+{
+public:
+	CinemaEmailResults (int total, function<void (float)> set_progress)
+		: _total (total)
+		, _sent (0)
+		, _set_progress (set_progress)
+	{}
+
+	void done (string cinema, shared_ptr<Emailer> email, boost::filesystem::path zip_file, optional<string> error)
+	{
+		boost::filesystem::remove (zip_file);
+
+		dcpomatic_log->log ("Email content follows", LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log (email->email(), LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log ("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log (email->notes(), LogEntry::TYPE_DEBUG_EMAIL);
+
+		boost::mutex::scoped_lock lm (_mutex);
+
+		if (error) {
+			LOG_ERROR ("Failed to send KDMs to %1: %2", cinema, *error);
+			_failures.push_back (cinema + ": " + *error);
+		} else {
+			LOG_GENERAL ("Sent KDMs to %1", cinema);
+		}
+
+		++_sent;
+		if (_set_progress) {
+			_set_progress (float (_sent) / _total);
+		}
+	}
+
+	list<string> failures () const {
+		boost::mutex::scoped_lock lm (_mutex);
+		return _failures;
+	}
+
+private:
+	mutable boost::mutex _mutex;
+	int _total;
+	int _sent;
+	list<string> _failures;
+	function<void (float)> _set_progress;
+};
+
+/** Email one ZIP file per cinema to the cinema, sending to several cinemas at once.
+ *  If any emails cannot be sent the others will still be tried, and a KDMError listing
+ *  the cinemas which failed will then be thrown.
  *  @param cinema_kdms KDMS to email.
  *  @param container_name_format Format of folder / ZIP to use.
  *  @param filename_format Format of filenames to use.
  *  @param name_values Values to substitute into \p container_name_format and \p filename_format.
  *  @param cpl_name Name of the CPL that the KDMs are for.
+ *  @param set_progress Function to call with progress from 0 to 1; may be called from any thread.
  */
 void
 CinemaKDMs::email (
@@ -195,7 +247,8 @@ CinemaKDMs::email (
 	dcp::NameFormat container_name_format,
 	dcp::NameFormat filename_format,
 	dcp::NameFormat::Map name_values,
-	string cpl_name
+	string cpl_name,
+	function<void (float)> set_progress
 	)
 {
 	Config* config = Config::instance ();
@@ -207,6 +260,16 @@ CinemaKDMs::email (
 	/* No specific screen */
 	name_values['s'] = "";
 
+	int total = 0;
+	BOOST_FOREACH (CinemaKDMs const & i, cinema_kdms) {
+		if (!i.cinema->emails.empty()) {
+			++total;
+		}
+	}
+
+	CinemaEmailResults results (total, set_progress);
+	EmailQueue queue (config->mail_server(), config->mail_port(), config->mail_protocol(), config->mail_user(), config->mail_password());
+
 	BOOST_FOREACH (CinemaKDMs const & i, cinema_kdms) {
 
 		if (i.cinema->emails.empty()) {
@@ -238,35 +301,28 @@ CinemaKDMs::email (
 		}
 		boost::algorithm::replace_all (body, "$SCREENS", screens.substr (0, screens.length() - 2));
 
-		Emailer email (config->kdm_from(), i.cinema->emails, subject, body);
+		shared_ptr<Emailer> email (new Emailer (config->kdm_from(), i.cinema->emails, subject, body));
 
 		BOOST_FOREACH (string i, config->kdm_cc()) {
-			email.add_cc (i);
+			email->add_cc (i);
 		}
 		if (!config->kdm_bcc().empty ()) {
-			email.add_bcc (config->kdm_bcc ());
+			email->add_bcc (config->kdm_bcc ());
 		}
 
-		email.add_attachment (zip_file, container_name_format.get(name_values, ".zip"), "application/zip");
-
-		Config* c = Config::instance ();
+		email->add_attachment (zip_file, container_name_format.get(name_values, ".zip"), "application/zip");
 
-		try {
-			email.send (c->mail_server(), c->mail_port(), c->mail_protocol(), c->mail_user(), c->mail_password());
-		} catch (...) {
-			boost::filesystem::remove (zip_file);
-			dcpomatic_log->log ("Email content follows", LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log (email.email(), LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log ("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log (email.notes(), LogEntry::TYPE_DEBUG_EMAIL);
-			throw;
-		}
+		queue.add (email, boost::bind (&CinemaEmailResults::done, &results, i.cinema->name, email, zip_file, _1));
+	}
 
-		boost::filesystem::remove (zip_file);
+	queue.send ();
 
-		dcpomatic_log->log ("Email content follows", LogEntry::TYPE_DEBUG_EMAIL);
-		dcpomatic_log->log (email.email(), LogEntry::TYPE_DEBUG_EMAIL);
-		dcpomatic_log->log ("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
-		dcpomatic_log->log (email.notes(), LogEntry::TYPE_DEBUG_EMAIL);
+	list<string> failures = results.failures ();
+	if (!failures.empty ()) {
+		string detail;
+		BOOST_FOREACH (string i, failures) {
+			detail += i + "\n";
+		}
+		throw KDMError (String::compose (_("Failed to send KDMs to %1 of %2 cinemas"), failures.size(), total), detail);
 	}
 }
@@ -19,6 +19,7 @@
 */
 
 #include "screen_kdm.h"
+#include <boost/function.hpp>
 
 class Cinema;
 class Job;
@@ -54,7 +55,8 @@ public:
 		dcp::NameFormat container_name_format,
 		dcp::NameFormat filename_format,
 		dcp::NameFormat::Map name_values,
-		std::string cpl_name
+		std::string cpl_name,
+		boost::function<void (float)> set_progress = boost::function<void (float)> ()
 		);
 
 	boost::shared_ptr<Cinema> cinema;
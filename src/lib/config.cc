@@ -27,6 +27,9 @@
 #include "cinema_sound_processor.h"
 #include "colour_conversion.h"
 #include "cinema.h"
+#include "screen.h"
+#include "exceptions.h"
+#include "dcpomatic_log.h"
 #include "util.h"
 #include "cross.h"
 #include "film.h"
@@ -45,6 +48,7 @@
 #include <boost/thread.hpp>
 #include <cstdlib>
 #include <fstream>
+#include <inttypes.h>
 #include <iostream>
 
 #include "i18n.h"
@@ -57,6 +61,7 @@ using std::list;
 using std::max;
 using std::remove;
 using std::exception;
+using std::make_pair;
 using std::cerr;
 using boost::shared_ptr;
 using boost::optional;
@@ -75,6 +80,8 @@ boost::signals2::signal<bool (void)> Config::BadSignerChain;
 Config::Config ()
         /* DKDMs are not considered a thing to reset on set_defaults() */
 	: _dkdms (new DKDMGroup ("root"))
+	, _cinema_journal_records (0)
+	, _cinemas_need_rewrite (false)
 {
 	set_defaults ();
 }
@@ -122,6 +129,7 @@ Config::set_defaults ()
 	_check_for_test_updates = false;
 	_maximum_j2k_bandwidth = 250000000;
 	_log_types = LogEntry::TYPE_GENERAL | LogEntry::TYPE_WARNING | LogEntry::TYPE_ERROR;
+	_trace = false;
 	_analyse_ebur128 = true;
 	_automatic_audio_analysis = false;
 #ifdef DCPOMATIC_WINDOWS
@@ -397,6 +405,7 @@ try
 	_allow_any_container = f.optional_bool_child ("AllowAnyContainer").get_value_or (false);
 
 	_log_types = f.optional_number_child<int> ("LogTypes").get_value_or (LogEntry::TYPE_GENERAL | LogEntry::TYPE_WARNING | LogEntry::TYPE_ERROR);
+	_trace = f.optional_bool_child("Trace").get_value_or (false);
 	_analyse_ebur128 = f.optional_bool_child("AnalyseEBUR128").get_value_or (true);
 	_automatic_audio_analysis = f.optional_bool_child ("AutomaticAudioAnalysis").get_value_or (false);
 #ifdef DCPOMATIC_WINDOWS
@@ -588,11 +597,7 @@ try
 #endif
 
 	/* Replace any cinemas from config.xml with those from the configured file */
-	if (boost::filesystem::exists (_cinemas_file)) {
-		cxml::Document f ("Cinemas");
-		f.read_file (_cinemas_file);
-		read_cinemas (f);
-	}
+	read_cinemas_file ();
 }
 catch (...) {
 	if (have_existing ("config.xml")) {
@@ -799,6 +804,8 @@ Config::write_config () const
 	   to sending email.
 	*/
 	root->add_child("LogTypes")->add_child_text (raw_convert<string> (_log_types));
+	/* [XML] Trace 1 to write a Chrome trace-event file (trace.json) to the film directory for each transcode, otherwise 0. */
+	root->add_child("Trace")->add_child_text (_trace ? "1" : "0");
 	/* [XML] AnalyseEBUR128 1 to do EBUR128 analyses when analysing audio, otherwise 0. */
 	root->add_child("AnalyseEBUR128")->add_child_text (_analyse_ebur128 ? "1" : "0");
 	/* [XML] AutomaticAudioAnalysis 1 to run audio analysis automatically when audio content is added to the film, otherwise 0. */
@@ -1052,8 +1059,27 @@ Config::write_config () const
 	}
 }
 
+/** Write any changes to cinemas to disk.  Changes made through add_cinema(), remove_cinema()
+ *  and cinema_changed() are appended to a journal next to the cinemas file; every so often
+ *  (or if we don't know what has changed) the whole cinemas file is re-written instead.
+ *  This means that the cinemas file on its own can be out of date until compact_cinemas()
+ *  is called.
+ */
 void
 Config::write_cinemas () const
+{
+	/* Number of journal records after which we re-write the whole cinemas file */
+	int const max_journal_records = 256;
+
+	if (_cinemas_need_rewrite || _cinema_changes.empty() || (_cinema_journal_records + int(_cinema_changes.size())) > max_journal_records) {
+		write_all_cinemas ();
+	} else {
+		write_cinemas_journal ();
+	}
+}
+
+void
+Config::write_all_cinemas () const
 {
 	xmlpp::Document doc;
 	xmlpp::Element* root = doc.create_root_node ("Cinemas");
@@ -1072,6 +1098,70 @@ Config::write_cinemas () const
 		trim (s);
 		throw FileError (s, _cinemas_file);
 	}
+
+	/* Everything in the journal is now in the main file */
+	boost::system::error_code ec;
+	boost::filesystem::remove (cinemas_journal_file(), ec);
+	_cinema_journal_records = 0;
+	_cinema_changes.clear ();
+	_cinemas_need_rewrite = false;
+}
+
+/** Write the whole cinemas file if there is a journal, so that the file is complete on
+ *  its own.  This should be done before anything other than this Config reads the file
+ *  (an export, an older DCP-o-matic or another machine sharing the file).
+ */
+void
+Config::compact_cinemas () const
+{
+	if (_cinema_journal_records > 0 || !_cinema_changes.empty()) {
+		write_all_cinemas ();
+	}
+}
+
+/** Append records of changed cinemas to the journal.  Each record is either
+ *  U <id> <length>\n<length bytes of Cinema XML>\n
+ *  for a cinema which was added or changed, or
+ *  R <id>\n
+ *  for one which was removed.
+ */
+void
+Config::write_cinemas_journal () const
+{
+	boost::filesystem::path const file = cinemas_journal_file ();
+	FILE* f = fopen_boost (file, "ab");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+
+	typedef std::pair<string, shared_ptr<Cinema> > Change;
+	BOOST_FOREACH (Change const & i, _cinema_changes) {
+		if (i.second) {
+			xmlpp::Document doc;
+			i.second->as_xml (doc.create_root_node ("Cinema"));
+			string const xml = doc.write_to_string ();
+			fprintf (f, "U %s %" PRIu64 "\n", i.first.c_str(), static_cast<uint64_t> (xml.length()));
+			fwrite (xml.c_str(), 1, xml.length(), f);
+			fprintf (f, "\n");
+		} else {
+			fprintf (f, "R %s\n", i.first.c_str());
+		}
+		++_cinema_journal_records;
+	}
+
+	bool const ok = !ferror (f);
+	fclose (f);
+	if (!ok) {
+		throw FileError (_("Could not write to cinemas journal"), file);
+	}
+
+	_cinema_changes.clear ();
+}
+
+boost::filesystem::path
+Config::cinemas_journal_file () const
+{
+	return _cinemas_file.string() + ".journal";
 }
 
 boost::filesystem::path
@@ -1243,7 +1333,153 @@ Config::read_cinemas (cxml::Document const & f)
 		shared_ptr<Cinema> cinema (new Cinema (i));
 		cinema->read_screens (i);
 		_cinemas.push_back (cinema);
+		if (!i->optional_string_child("Id")) {
+			/* This cinema has just been given a new ID, so journal records
+			   would not refer to it after the next load; write everything
+			   next time so that the IDs are stored.
+			*/
+			_cinemas_need_rewrite = true;
+		}
+	}
+
+	setup_cinema_index ();
+}
+
+/** Read _cinemas_file, if it exists, and apply any changes from its journal */
+void
+Config::read_cinemas_file ()
+{
+	_cinema_changes.clear ();
+	_cinema_journal_records = 0;
+	_cinemas_need_rewrite = false;
+
+	if (boost::filesystem::exists (_cinemas_file)) {
+		cxml::Document f ("Cinemas");
+		f.read_file (_cinemas_file);
+		read_cinemas (f);
+	} else {
+		/* Any cinemas that we have (e.g. from config.xml) are not in the file yet */
+		_cinemas_need_rewrite = true;
+	}
+
+	if (boost::filesystem::exists (cinemas_journal_file())) {
+		read_cinemas_journal ();
+	}
+}
+
+void
+Config::read_cinemas_journal ()
+{
+	boost::filesystem::path const file = cinemas_journal_file ();
+	FILE* f = fopen_boost (file, "rb");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::READ);
+	}
+
+	char header[256];
+	while (fgets (header, sizeof (header), f)) {
+		char type = 0;
+		char id[128];
+		uint64_t length = 0;
+		int const n = sscanf (header, "%c %127s %" SCNu64, &type, id, &length);
+
+		if (n == 2 && type == 'R') {
+			for (list<shared_ptr<Cinema> >::iterator i = _cinemas.begin(); i != _cinemas.end(); ++i) {
+				if ((*i)->id() == id) {
+					_cinemas.erase (i);
+					break;
+				}
+			}
+		} else if (n == 3 && type == 'U') {
+			string xml (length, '\0');
+			if (fread (&xml[0], 1, length, f) != length) {
+				/* Incomplete record, probably because we were interrupted while writing it */
+				LOG_WARNING ("Ignoring incomplete record at the end of %1", file.string());
+				break;
+			}
+			fgetc (f);
+
+			shared_ptr<cxml::Document> doc (new cxml::Document ("Cinema"));
+			doc->read_string (xml);
+			shared_ptr<Cinema> cinema (new Cinema (doc));
+			cinema->read_screens (doc);
+
+			list<shared_ptr<Cinema> >::iterator i = _cinemas.begin();
+			while (i != _cinemas.end() && (*i)->id() != cinema->id()) {
+				++i;
+			}
+
+			if (i != _cinemas.end()) {
+				*i = cinema;
+			} else {
+				_cinemas.push_back (cinema);
+			}
+		} else {
+			LOG_WARNING ("Ignoring unrecognised record in %1", file.string());
+			break;
+		}
+
+		++_cinema_journal_records;
 	}
+
+	fclose (f);
+	setup_cinema_index ();
+}
+
+void
+Config::add_cinema (shared_ptr<Cinema> c)
+{
+	_cinemas.push_back (c);
+	cinema_changed (c);
+}
+
+void
+Config::remove_cinema (shared_ptr<Cinema> c)
+{
+	_cinemas.remove (c);
+	_cinema_changes.push_back (make_pair (c->id(), shared_ptr<Cinema>()));
+	setup_cinema_index ();
+	changed (CINEMAS);
+}
+
+/** Call this when a cinema, or any of its screens, has been modified */
+void
+Config::cinema_changed (shared_ptr<Cinema> c)
+{
+	_cinema_changes.push_back (make_pair (c->id(), c));
+	setup_cinema_index ();
+	changed (CINEMAS);
+}
+
+/** Rebuild _cinemas_by_name_or_email; this is done whenever _cinemas changes, rather than when
+ *  the index is used, so that find_cinema() does not modify anything.
+ */
+void
+Config::setup_cinema_index ()
+{
+	_cinemas_by_name_or_email.clear ();
+
+	BOOST_FOREACH (shared_ptr<Cinema> i, _cinemas) {
+		/* Earlier cinemas win if there are duplicates, as they would with a search of the list */
+		_cinemas_by_name_or_email.insert (make_pair (i->name, i));
+		BOOST_FOREACH (string j, i->emails) {
+			_cinemas_by_name_or_email.insert (make_pair (j, i));
+		}
+	}
+}
+
+/** @param name_or_email Name of a cinema, or one of its email addresses.
+ *  @return Matching cinema, or 0.
+ */
+shared_ptr<Cinema>
+Config::find_cinema (string name_or_email) const
+{
+	std::map<string, shared_ptr<Cinema> >::const_iterator i = _cinemas_by_name_or_email.find (name_or_email);
+	if (i == _cinemas_by_name_or_email.end()) {
+		return shared_ptr<Cinema> ();
+	}
+
+	return i->second;
 }
 
 void
@@ -1253,13 +1489,21 @@ Config::set_cinemas_file (boost::filesystem::path file)
 		return;
 	}
 
+	/* Leave the old file complete for anybody else who reads it */
+	try {
+		compact_cinemas ();
+	} catch (FileError& e) {
+		LOG_WARNING ("Could not compact cinemas file %1 (%2)", _cinemas_file.string(), e.what());
+	}
+
 	_cinemas_file = file;
 
-	if (boost::filesystem::exists (_cinemas_file)) {
+	if (boost::filesystem::exists (_cinemas_file) || boost::filesystem::exists (cinemas_journal_file())) {
 		/* Existing file; read it in */
-		cxml::Document f ("Cinemas");
-		f.read_file (_cinemas_file);
-		read_cinemas (f);
+		read_cinemas_file ();
+	} else {
+		/* New file; the first write must include all our cinemas, not just changes */
+		_cinemas_need_rewrite = true;
 	}
 
 	changed (OTHER);
@@ -36,11 +36,13 @@
 #include <boost/signals2.hpp>
 #include <boost/filesystem.hpp>
 #include <vector>
+#include <map>
 
 class CinemaSoundProcessor;
 class DCPContentType;
 class Ratio;
 class Cinema;
+class Screen;
 class Film;
 class DKDMGroup;
 
@@ -310,6 +312,10 @@ public:
 		return _log_types;
 	}
 
+	bool trace () const {
+		return _trace;
+	}
+
 	bool analyse_ebur128 () const {
 		return _analyse_ebur128;
 	}
@@ -592,15 +598,11 @@ public:
 		maybe_set (_tms_password, p);
 	}
 
-	void add_cinema (boost::shared_ptr<Cinema> c) {
-		_cinemas.push_back (c);
-		changed (CINEMAS);
-	}
+	void add_cinema (boost::shared_ptr<Cinema> c);
+	void remove_cinema (boost::shared_ptr<Cinema> c);
+	void cinema_changed (boost::shared_ptr<Cinema> c);
 
-	void remove_cinema (boost::shared_ptr<Cinema> c) {
-		_cinemas.remove (c);
-		changed (CINEMAS);
-	}
+	boost::shared_ptr<Cinema> find_cinema (std::string name_or_email) const;
 
 	void set_allowed_dcp_frame_rates (std::list<int> const & r) {
 		maybe_set (_allowed_dcp_frame_rates, r);
@@ -774,6 +776,10 @@ public:
 		maybe_set (_log_types, t);
 	}
 
+	void set_trace (bool t) {
+		maybe_set (_trace, t);
+	}
+
 	void set_analyse_ebur128 (bool a) {
 		maybe_set (_analyse_ebur128, a);
 	}
@@ -1079,6 +1085,7 @@ public:
 	void write () const;
 	void write_config () const;
 	void write_cinemas () const;
+	void compact_cinemas () const;
 	void link (boost::filesystem::path new_file) const;
 	void copy_and_link (boost::filesystem::path new_file) const;
 	bool have_write_permission () const;
@@ -1104,6 +1111,12 @@ private:
 	void set_notification_email_to_default ();
 	void set_cover_sheet_to_default ();
 	void read_cinemas (cxml::Document const & f);
+	void read_cinemas_file ();
+	void read_cinemas_journal ();
+	void write_cinemas_journal () const;
+	void write_all_cinemas () const;
+	boost::filesystem::path cinemas_journal_file () const;
+	void setup_cinema_index ();
 	boost::shared_ptr<dcp::CertificateChain> create_certificate_chain ();
 	boost::filesystem::path directory_or (boost::optional<boost::filesystem::path> dir, boost::filesystem::path a) const;
 	void add_to_history_internal (std::vector<boost::filesystem::path>& h, boost::filesystem::path p);
@@ -1183,6 +1196,18 @@ private:
 	boost::optional<boost::filesystem::path> _default_kdm_directory;
 	bool _default_upload_after_make_dcp;
 	std::list<boost::shared_ptr<Cinema> > _cinemas;
+	/** Cinemas which have been added, changed or removed since the cinemas file was last written,
+	 *  identified by Cinema::id(); the Cinema is null if it was removed.
+	 */
+	mutable std::list<std::pair<std::string, boost::shared_ptr<Cinema> > > _cinema_changes;
+	/** number of records in the cinemas journal file */
+	mutable int _cinema_journal_records;
+	/** true if the next write_cinemas() must write the whole cinemas file */
+	mutable bool _cinemas_need_rewrite;
+	/** Cinemas by their names and their email addresses; where more than one cinema
+	 *  matches a key the first in _cinemas is used, as a search of the list would find.
+	 */
+	std::map<std::string, boost::shared_ptr<Cinema> > _cinemas_by_name_or_email;
 	std::string _mail_server;
 	int _mail_port;
 	EmailProtocol _mail_protocol;
@@ -1216,6 +1241,8 @@ private:
 	/** maximum allowed J2K bandwidth in bits per second */
 	int _maximum_j2k_bandwidth;
 	int _log_types;
+	/** true to write a trace of each transcode job's encoding pipeline to the film directory */
+	bool _trace;
 	bool _analyse_ebur128;
 	bool _automatic_audio_analysis;
 #ifdef DCPOMATIC_WINDOWS
@@ -38,6 +38,7 @@
 #include <libcxml/cxml.h>
 #include <libxml++/libxml++.h>
 #include <boost/thread/mutex.hpp>
+#include <boost/foreach.hpp>
 #include <iostream>
 
 #include "i18n.h"
@@ -65,6 +66,7 @@ Content::Content ()
 	, _trim_start (0)
 	, _trim_end (0)
 	, _change_signals_frequent (false)
+	, _xml_cache_generation (0)
 {
 
 }
@@ -74,6 +76,7 @@ Content::Content (DCPTime p)
 	, _trim_start (0)
 	, _trim_end (0)
 	, _change_signals_frequent (false)
+	, _xml_cache_generation (0)
 {
 
 }
@@ -83,12 +86,14 @@ Content::Content (boost::filesystem::path p)
 	, _trim_start (0)
 	, _trim_end (0)
 	, _change_signals_frequent (false)
+	, _xml_cache_generation (0)
 {
 	add_path (p);
 }
 
 Content::Content (cxml::ConstNodePtr node)
 	: _change_signals_frequent (false)
+	, _xml_cache_generation (0)
 {
 	list<cxml::NodePtr> path_children = node->node_children ("Path");
 	BOOST_FOREACH (cxml::NodePtr i, path_children) {
@@ -115,6 +120,7 @@ Content::Content (vector<shared_ptr<Content> > c)
 	, _trim_end (c.back()->trim_end ())
 	, _video_frame_rate (c.front()->video_frame_rate())
 	, _change_signals_frequent (false)
+	, _xml_cache_generation (0)
 {
 	for (size_t i = 0; i < c.size(); ++i) {
 		if (i > 0 && c[i]->trim_start() > ContentTime ()) {
@@ -187,6 +193,8 @@ Content::examine (shared_ptr<const Film>, shared_ptr<Job> job)
 
 	string const d = calculate_digest ();
 
+	invalidate_xml_cache ();
+
 	boost::mutex::scoped_lock lm (_mutex);
 	_digest = d;
 
@@ -196,9 +204,52 @@ Content::examine (shared_ptr<const Film>, shared_ptr<Job> job)
 	}
 }
 
+/** Add the same XML to node as as_xml() would, re-using what was made last time
+ *  if nothing has changed since.
+ */
+void
+Content::as_xml_cached (xmlpp::Node* node, bool with_paths) const
+{
+	shared_ptr<xmlpp::Document> doc;
+	int generation;
+	{
+		boost::mutex::scoped_lock lm (_xml_cache_mutex);
+		doc = _xml_cache[with_paths ? 1 : 0];
+		generation = _xml_cache_generation;
+	}
+
+	if (!doc) {
+		doc.reset (new xmlpp::Document);
+		as_xml (doc->create_root_node ("Content"), with_paths);
+		boost::mutex::scoped_lock lm (_xml_cache_mutex);
+		if (_xml_cache_generation == generation) {
+			/* Nothing changed while we were making it, so it can be re-used */
+			_xml_cache[with_paths ? 1 : 0] = doc;
+		}
+	}
+
+	BOOST_FOREACH (xmlpp::Node* i, doc->get_root_node()->get_children()) {
+		node->import_node (i);
+	}
+}
+
+/** Note that this content's state has changed in a way which as_xml() would reflect.
+ *  This happens automatically whenever a change is signalled.
+ */
+void
+Content::invalidate_xml_cache () const
+{
+	boost::mutex::scoped_lock lm (_xml_cache_mutex);
+	_xml_cache[0].reset ();
+	_xml_cache[1].reset ();
+	++_xml_cache_generation;
+}
+
 void
 Content::signal_change (ChangeType c, int p)
 {
+	invalidate_xml_cache ();
+
 	try {
 		if (c == CHANGE_TYPE_PENDING || c == CHANGE_TYPE_CANCELLED) {
 			Change (c, shared_from_this(), p, _change_signals_frequent);
@@ -475,6 +526,8 @@ Content::take_settings_from (shared_ptr<const Content> c)
 		++i;
 		++j;
  	}
+
+	invalidate_xml_cache ();
 }
 
 shared_ptr<TextContent>
@@ -502,7 +555,11 @@ Content::text_of_original_type (TextType type) const
 void
 Content::add_path (boost::filesystem::path p)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-	_paths.push_back (p);
-	_last_write_times.push_back (boost::filesystem::last_write_time(p));
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_paths.push_back (p);
+		_last_write_times.push_back (boost::filesystem::last_write_time(p));
+	}
+
+	invalidate_xml_cache ();
 }
@@ -38,6 +38,7 @@
 
 namespace xmlpp {
 	class Node;
+	class Document;
 }
 
 namespace cxml {
@@ -90,6 +91,8 @@ public:
 	virtual std::string technical_summary () const;
 
 	virtual void as_xml (xmlpp::Node *, bool with_paths) const;
+	void as_xml_cached (xmlpp::Node *, bool with_paths) const;
+	void invalidate_xml_cache () const;
 	virtual DCPTime full_length (boost::shared_ptr<const Film>) const = 0;
 	virtual DCPTime approximate_length () const = 0;
 	virtual std::string identifier () const;
@@ -228,6 +231,13 @@ private:
 	 */
 	boost::optional<double> _video_frame_rate;
 	bool _change_signals_frequent;
+
+	/** Mutex for _xml_cache and _xml_cache_generation */
+	mutable boost::mutex _xml_cache_mutex;
+	/** XML made by as_xml() without [0] and with [1] paths, or 0 if it must be made again */
+	mutable boost::shared_ptr<xmlpp::Document> _xml_cache[2];
+	/** Incremented each time _xml_cache is invalidated */
+	mutable int _xml_cache_generation;
 };
 
 #endif
@@ -36,6 +36,7 @@ extern "C" {
 #include <windows.h>
 #undef DATADIR
 #include <shlwapi.h>
+#include <psapi.h>
 #include <shellapi.h>
 #include <fcntl.h>
 #endif
@@ -46,6 +47,7 @@ extern "C" {
 #endif
 #ifdef DCPOMATIC_POSIX
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <ifaddrs.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -427,6 +429,31 @@ thread_id ()
 #endif
 }
 
+/** @return Peak amount of physical memory that this process has used, in bytes, or 0 if it is not known */
+uint64_t
+peak_memory_usage ()
+{
+#ifdef DCPOMATIC_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage (RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef DCPOMATIC_OSX
+	/* bytes on OS X */
+	return usage.ru_maxrss;
+#else
+	/* kilobytes on Linux */
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
 int
 avio_open_boost (AVIOContext** s, boost::filesystem::path file, int flags)
 {
@@ -54,6 +54,7 @@ extern int dcpomatic_fseek (FILE *, int64_t, int);
 extern void start_batch_converter (boost::filesystem::path dcpomatic);
 extern void start_player (boost::filesystem::path dcpomatic);
 extern uint64_t thread_id ();
+extern uint64_t peak_memory_usage ();
 extern int avio_open_boost (AVIOContext** s, boost::filesystem::path file, int flags);
 extern boost::filesystem::path home_directory ();
 extern std::string command_and_read (std::string cmd);
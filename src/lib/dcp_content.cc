@@ -399,6 +399,7 @@ void
 DCPContent::add_kdm (dcp::EncryptedKDM k)
 {
 	_kdm = k;
+	invalidate_xml_cache ();
 }
 
 void
@@ -715,6 +716,8 @@ DCPContent::take_settings_from (shared_ptr<const Content> c)
 	for (int i = 0; i < TEXT_COUNT; ++i) {
 		_reference_text[i] = dc->_reference_text[i];
 	}
+
+	invalidate_xml_cache ();
 }
 
 void
@@ -37,6 +37,11 @@
 #include "referenced_reel_asset.h"
 #include "text_content.h"
 #include "player_video.h"
+#include "trace.h"
+#include "metrics.h"
+#include "encode_report.h"
+#include "cross.h"
+#include "util.h"
 #include <boost/signals2.hpp>
 #include <boost/foreach.hpp>
 #include <iostream>
@@ -84,10 +89,12 @@ DCPEncoder::~DCPEncoder ()
 void
 DCPEncoder::go ()
 {
-	_writer.reset (new Writer (_film, _job));
+	_report.reset (new EncodeReport ());
+
+	_writer.reset (new Writer (_film, _job, _report));
 	_writer->start ();
 
-	_j2k_encoder.reset (new J2KEncoder (_film, _writer));
+	_j2k_encoder.reset (new J2KEncoder (_film, _writer, _report));
 	_j2k_encoder->begin ();
 
 	{
@@ -111,15 +118,41 @@ DCPEncoder::go ()
 		_writer->write (fonts);
 	}
 
-	while (!_player->pass ()) {}
+	struct timeval start;
+	gettimeofday (&start, 0);
+
+	while (true) {
+		TraceSpan span ("decode");
+		if (_player->pass ()) {
+			break;
+		}
+	}
 
 	BOOST_FOREACH (ReferencedReelAsset i, _player->get_reel_assets ()) {
 		_writer->write (i);
 	}
 
+	/* The phases overlap, as decoding, encoding and writing run in parallel; decode is
+	   the time taken to pass all the frames to the encoder, encode is the time then
+	   taken for the encoder to finish, and the writer adds write and digest phases.
+	*/
+	struct timeval decode_finish;
+	gettimeofday (&decode_finish, 0);
+	_report->add_phase ("decode", seconds(decode_finish) - seconds(start));
+
 	_finishing = true;
 	_j2k_encoder->end ();
+
+	struct timeval encode_finish;
+	gettimeofday (&encode_finish, 0);
+	_report->add_phase ("encode", seconds(encode_finish) - seconds(decode_finish));
+
 	_writer->finish ();
+
+	struct timeval finish;
+	gettimeofday (&finish, 0);
+	_report->add_phase ("total", seconds(finish) - seconds(start));
+	_report->add_count ("peak_memory", peak_memory_usage());
 }
 
 void
@@ -130,6 +163,7 @@ DCPEncoder::video (shared_ptr<PlayerVideo> data, DCPTime time)
 		data->set_eyes (EYES_BOTH);
 	}
 
+	Metrics::instance()->add ("decoded_frames_total");
 	_j2k_encoder->encode (data, time);
 }
 
@@ -31,6 +31,7 @@ class Writer;
 class Job;
 class PlayerVideo;
 class AudioBuffers;
+class EncodeReport;
 
 /** @class DCPEncoder */
 class DCPEncoder : public Encoder
@@ -49,6 +50,10 @@ public:
 		return _finishing;
 	}
 
+	boost::shared_ptr<const EncodeReport> report () const {
+		return _report;
+	}
+
 private:
 
 	void video (boost::shared_ptr<PlayerVideo>, DCPTime);
@@ -57,6 +62,7 @@ private:
 
 	boost::shared_ptr<Writer> _writer;
 	boost::shared_ptr<J2KEncoder> _j2k_encoder;
+	boost::shared_ptr<EncodeReport> _report;
 	bool _finishing;
 	bool _non_burnt_subtitles;
 
@@ -81,6 +81,8 @@ DCPSubtitleContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 	BOOST_FOREACH (shared_ptr<dcp::LoadFontNode> i, sc->load_font_nodes ()) {
 		only_text()->add_font (shared_ptr<Font> (new Font (i->id)));
 	}
+
+	invalidate_xml_cache ();
 }
 
 DCPTime
@@ -39,6 +39,7 @@
 #include "cross.h"
 #include "player_video.h"
 #include "compose.hpp"
+#include "trace.h"
 #include <libcxml/cxml.h>
 #include <dcp/raw_convert.h>
 #include <dcp/openjpeg_image.h>
@@ -175,15 +176,21 @@ DCPVideo::encode_remotely (EncodeServerDescription serv, int timeout)
 
 	/* Send binary data */
 	LOG_TIMING("start-remote-send thread=%1", thread_id ());
+	Trace::instance()->begin ("remote-send", _index);
 	_frame->send_binary (socket);
+	Trace::instance()->end ("remote-send", _index);
 
 	/* Read the response (JPEG2000-encoded data); this blocks until the data
 	   is ready and sent back.
 	*/
 	LOG_TIMING("start-remote-encode thread=%1", thread_id ());
+	Trace::instance()->begin ("remote-wait", _index);
 	Data e (socket->read_uint32 ());
+	Trace::instance()->end ("remote-wait", _index);
 	LOG_TIMING("start-remote-receive thread=%1", thread_id ());
+	Trace::instance()->begin ("remote-receive", _index);
 	socket->read (e.data().get(), e.size());
+	Trace::instance()->end ("remote-receive", _index);
 	LOG_TIMING("finish-remote-receive thread=%1", thread_id ());
 
 	LOG_DEBUG_ENCODE (N_("Finished remotely-encoded frame %1"), _index);
@@ -25,12 +25,16 @@
 /** The current log; set up by the front-ends when they have a Film to log into */
 extern boost::shared_ptr<Log> dcpomatic_log;
 
-#define LOG_GENERAL(...)      dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_GENERAL);
+/* These check that the type is enabled before composing the message, so
+   that disabled (e.g. timing or debug) logging costs next to nothing.  The
+   do/while makes each one a single statement, so it is safe in an unbraced if/else.
+*/
+#define LOG_GENERAL(...)      do { if (dcpomatic_log->enabled(LogEntry::TYPE_GENERAL)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_GENERAL); } } while (0)
 #define LOG_GENERAL_NC(...)   dcpomatic_log->log(__VA_ARGS__, LogEntry::TYPE_GENERAL);
-#define LOG_ERROR(...)        dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_ERROR);
+#define LOG_ERROR(...)        do { if (dcpomatic_log->enabled(LogEntry::TYPE_ERROR)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_ERROR); } } while (0)
 #define LOG_ERROR_NC(...)     dcpomatic_log->log(__VA_ARGS__, LogEntry::TYPE_ERROR);
-#define LOG_WARNING(...)      dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_WARNING);
+#define LOG_WARNING(...)      do { if (dcpomatic_log->enabled(LogEntry::TYPE_WARNING)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_WARNING); } } while (0)
 #define LOG_WARNING_NC(...)   dcpomatic_log->log(__VA_ARGS__, LogEntry::TYPE_WARNING);
-#define LOG_TIMING(...)       dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_TIMING);
-#define LOG_DEBUG_ENCODE(...) dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_DEBUG_ENCODE);
-#define LOG_DEBUG_PLAYER(...) dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_DEBUG_PLAYER);
+#define LOG_TIMING(...)       do { if (dcpomatic_log->enabled(LogEntry::TYPE_TIMING)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_TIMING); } } while (0)
+#define LOG_DEBUG_ENCODE(...) do { if (dcpomatic_log->enabled(LogEntry::TYPE_DEBUG_ENCODE)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_DEBUG_ENCODE); } } while (0)
+#define LOG_DEBUG_PLAYER(...) do { if (dcpomatic_log->enabled(LogEntry::TYPE_DEBUG_PLAYER)) { dcpomatic_log->log(String::compose(__VA_ARGS__), LogEntry::TYPE_DEBUG_PLAYER); } } while (0)
@@ -76,11 +76,21 @@ Socket::connect (boost::asio::ip::tcp::endpoint endpoint)
  */
 void
 Socket::write (uint8_t const * data, int size)
+{
+	write (std::vector<boost::asio::const_buffer> (1, boost::asio::buffer (data, size)));
+}
+
+/** Blocking write of several buffers in one operation; the timeout applies
+ *  to the whole transfer.
+ *  @param buffers Buffers to write, in order.
+ */
+void
+Socket::write (std::vector<boost::asio::const_buffer> const & buffers)
 {
 	_deadline.expires_from_now (boost::posix_time::seconds (_timeout));
 	boost::system::error_code ec = boost::asio::error::would_block;
 
-	boost::asio::async_write (_socket, boost::asio::buffer (data, size), boost::lambda::var(ec) = boost::lambda::_1);
+	boost::asio::async_write (_socket, buffers, boost::lambda::var(ec) = boost::lambda::_1);
 
 	do {
 		_io_service.run_one ();
@@ -104,11 +114,21 @@ Socket::write (uint32_t v)
  */
 void
 Socket::read (uint8_t* data, int size)
+{
+	read (std::vector<boost::asio::mutable_buffer> (1, boost::asio::buffer (data, size)));
+}
+
+/** Blocking read into several buffers in one operation; the timeout applies
+ *  to the whole transfer.
+ *  @param buffers Buffers to fill, in order.
+ */
+void
+Socket::read (std::vector<boost::asio::mutable_buffer> const & buffers)
 {
 	_deadline.expires_from_now (boost::posix_time::seconds (_timeout));
 	boost::system::error_code ec = boost::asio::error::would_block;
 
-	boost::asio::async_read (_socket, boost::asio::buffer (data, size), boost::lambda::var(ec) = boost::lambda::_1);
+	boost::asio::async_read (_socket, buffers, boost::lambda::var(ec) = boost::lambda::_1);
 
 	do {
 		_io_service.run_one ();
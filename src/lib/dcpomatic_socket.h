@@ -20,6 +20,7 @@
 
 #include <boost/asio.hpp>
 #include <boost/noncopyable.hpp>
+#include <vector>
 
 /** @class Socket
  *  @brief A class to wrap a boost::asio::ip::tcp::socket with some things
@@ -42,8 +43,10 @@ public:
 
 	void write (uint32_t n);
 	void write (uint8_t const * data, int size);
+	void write (std::vector<boost::asio::const_buffer> const & buffers);
 
 	void read (uint8_t* data, int size);
+	void read (std::vector<boost::asio::mutable_buffer> const & buffers);
 	uint32_t read_uint32 ();
 
 private:
@@ -76,3 +76,21 @@ decoder_factory (shared_ptr<const Film> film, shared_ptr<const Content> content,
 
 	return shared_ptr<Decoder> ();
 }
+
+/** @return true if decoder_factory() would give a decoder for this content which can
+ *  produce data, without actually making one (which may mean opening files).
+ */
+bool
+can_decode (shared_ptr<const Content> content)
+{
+	shared_ptr<const DCPContent> dc = dynamic_pointer_cast<const DCPContent> (content);
+	if (dc) {
+		return dc->can_be_played ();
+	}
+
+	return dynamic_pointer_cast<const FFmpegContent> (content)
+		|| dynamic_pointer_cast<const ImageContent> (content)
+		|| dynamic_pointer_cast<const StringTextFileContent> (content)
+		|| dynamic_pointer_cast<const DCPSubtitleContent> (content)
+		|| dynamic_pointer_cast<const VideoMXFContent> (content);
+}
@@ -25,3 +25,5 @@ extern boost::shared_ptr<Decoder> decoder_factory (
 	boost::shared_ptr<const Content> content,
 	bool fast
 	);
+
+extern bool can_decode (boost::shared_ptr<const Content> content);
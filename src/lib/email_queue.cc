@@ -0,0 +1,145 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "email_queue.h"
+#include "emailer.h"
+#include "exceptions.h"
+#include "cross.h"
+#include "dcpomatic_log.h"
+#include "dcpomatic_assert.h"
+#include <boost/thread.hpp>
+#include <boost/foreach.hpp>
+
+#include "i18n.h"
+
+using std::string;
+using std::min;
+using boost::shared_ptr;
+using boost::optional;
+
+/** @param connections Maximum number of connections to make to the server at once.
+ *  @param attempts Number of times to try to send each email before giving up.
+ */
+EmailQueue::EmailQueue (string server, int port, EmailProtocol protocol, string user, string password, int connections, int attempts)
+	: _server (server)
+	, _port (port)
+	, _protocol (protocol)
+	, _user (user)
+	, _password (password)
+	, _connections (connections)
+	, _attempts (attempts)
+{
+	DCPOMATIC_ASSERT (_connections > 0);
+	DCPOMATIC_ASSERT (_attempts > 0);
+}
+
+void
+EmailQueue::add (shared_ptr<Emailer> email, Done done)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_items.push_back (Item (email, done));
+}
+
+/** Send all the emails that have been added, returning when they have
+ *  all been sent or have failed.
+ */
+void
+EmailQueue::send ()
+{
+	int threads = 0;
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		threads = min (_connections, int (_items.size()));
+	}
+
+	/* This is not thread-safe, so do it once here rather than in each thread */
+	curl_global_init (CURL_GLOBAL_DEFAULT);
+
+	boost::thread_group pool;
+	for (int i = 0; i < threads; ++i) {
+		pool.create_thread (boost::bind (&EmailQueue::thread, this));
+	}
+
+	pool.join_all ();
+
+	curl_global_cleanup ();
+}
+
+void
+EmailQueue::thread ()
+{
+	/* Use one handle for all the emails that this thread sends, so that curl
+	   can keep its connection to the server open between them.
+	*/
+	CURL* curl = curl_easy_init ();
+
+	while (true) {
+		optional<Item> item;
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			if (_items.empty ()) {
+				break;
+			}
+			item = _items.front ();
+			_items.pop_front ();
+		}
+
+		if (!curl) {
+			item->done (string ("Could not initialise libcurl"));
+			continue;
+		}
+
+		send_one (curl, item->email, item->done);
+	}
+
+	if (curl) {
+		curl_easy_cleanup (curl);
+	}
+}
+
+void
+EmailQueue::send_one (CURL* curl, shared_ptr<Emailer> email, Done done)
+{
+	for (int i = 0; i < _attempts; ++i) {
+		string error;
+
+		try {
+			email->send (curl, _server, _port, _protocol, _user, _password);
+			done (optional<string> ());
+			return;
+		} catch (KDMError& e) {
+			error = e.summary() + " (" + e.detail() + ")";
+		} catch (std::exception& e) {
+			error = e.what ();
+		}
+
+		dcpomatic_log->log ("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log (email->notes(), LogEntry::TYPE_DEBUG_EMAIL);
+
+		if (i == (_attempts - 1)) {
+			done (error);
+			return;
+		}
+
+		/* Wait 1s, 2s, 4s... before trying again */
+		LOG_GENERAL ("Failed to send email (%1); trying again", error);
+		dcpomatic_sleep (1 << i);
+	}
+}
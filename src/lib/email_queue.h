@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DCPOMATIC_EMAIL_QUEUE_H
+#define DCPOMATIC_EMAIL_QUEUE_H
+
+#include "types.h"
+#include <curl/curl.h>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+#include <list>
+#include <string>
+
+class Emailer;
+
+/** @class EmailQueue
+ *  @brief Send a set of emails to one mail server using a few connections at once.
+ *
+ *  Each connection is kept open between emails where the server allows it, and
+ *  sends which fail are retried a few times, waiting longer each time.  A failure
+ *  to send one email does not stop the others.
+ */
+class EmailQueue : public boost::noncopyable
+{
+public:
+	EmailQueue (
+		std::string server,
+		int port,
+		EmailProtocol protocol,
+		std::string user,
+		std::string password,
+		int connections = 4,
+		int attempts = 3
+		);
+
+	/** Handler called when an email has been sent, or has failed for the last time;
+	 *  its parameter is the error, or empty on success.  It will be called from
+	 *  one of the queue's threads.
+	 */
+	typedef boost::function<void (boost::optional<std::string>)> Done;
+
+	void add (boost::shared_ptr<Emailer> email, Done done);
+	void send ();
+
+private:
+	void thread ();
+	void send_one (CURL* curl, boost::shared_ptr<Emailer> email, Done done);
+
+	std::string _server;
+	int _port;
+	EmailProtocol _protocol;
+	std::string _user;
+	std::string _password;
+	int _connections;
+	int _attempts;
+
+	struct Item {
+		Item (boost::shared_ptr<Emailer> e, Done d)
+			: email (e)
+			, done (d)
+		{}
+
+		boost::shared_ptr<Emailer> email;
+		Done done;
+	};
+
+	/** mutex to protect _items */
+	boost::mutex _mutex;
+	/** emails which have not yet been sent */
+	std::list<Item> _items;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "config.h"
 #include "emailer.h"
 #include "exceptions.h"
+#include <dcp/util.h>
 #include <curl/curl.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/c_local_time_adjustor.hpp>
@@ -99,11 +100,20 @@ Emailer::get_data (void* ptr, size_t size, size_t nmemb)
 }
 
 void
-Emailer::send (string server, int port, EmailProtocol protocol, string user, string password)
+Emailer::create ()
 {
+	/* This may be called from several threads at once, so we must not use
+	   anything with shared state (like localtime() or rand()).
+	*/
 	char date_buffer[128];
 	time_t now = time (0);
-	strftime (date_buffer, sizeof(date_buffer), "%a, %d %b %Y %H:%M:%S ", localtime (&now));
+	struct tm local;
+#ifdef DCPOMATIC_WINDOWS
+	localtime_s (&local, &now);
+#else
+	localtime_r (&now, &local);
+#endif
+	strftime (date_buffer, sizeof(date_buffer), "%a, %d %b %Y %H:%M:%S ", &local);
 
 	boost::posix_time::ptime const utc_now = boost::posix_time::second_clock::universal_time ();
 	boost::posix_time::ptime const local_now = boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local (utc_now);
@@ -122,11 +132,8 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 		_email += "Bcc: " + address_list (_bcc) + "\r\n";
 	}
 
-	string const chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890";
-	string boundary;
-	for (int i = 0; i < 32; ++i) {
-		boundary += chars[rand() % chars.length()];
-	}
+	string boundary = dcp::make_uuid ();
+	boost::algorithm::erase_all (boundary, "-");
 
 	if (!_attachments.empty ()) {
 		_email += "MIME-Version: 1.0\r\n"
@@ -169,6 +176,13 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 	if (!_attachments.empty ()) {
 		_email += "\r\n--" + boundary + "--\r\n";
 	}
+}
+
+void
+Emailer::send (string server, int port, EmailProtocol protocol, string user, string password)
+{
+	create ();
+	_offset = 0;
 
 	curl_global_init (CURL_GLOBAL_DEFAULT);
 
@@ -177,6 +191,34 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 		throw NetworkError ("Could not initialise libcurl");
 	}
 
+	try {
+		perform (curl, server, port, protocol, user, password);
+	} catch (...) {
+		curl_easy_cleanup (curl);
+		curl_global_cleanup ();
+		throw;
+	}
+
+	curl_easy_cleanup (curl);
+	curl_global_cleanup ();
+}
+
+/** Send the email using an existing libcurl handle.  The handle's options are reset, but
+ *  any connection that it has open to the server will be re-used if possible.
+ *  curl_global_init() must have been called by the caller.
+ */
+void
+Emailer::send (CURL* curl, string server, int port, EmailProtocol protocol, string user, string password)
+{
+	create ();
+	_offset = 0;
+	curl_easy_reset (curl);
+	perform (curl, server, port, protocol, user, password);
+}
+
+void
+Emailer::perform (CURL* curl, string server, int port, EmailProtocol protocol, string user, string password)
+{
 	if ((protocol == EMAIL_PROTOCOL_AUTO && port == 465) || protocol == EMAIL_PROTOCOL_SSL) {
 		/* "SSL" or "Implicit TLS"; I think curl wants us to use smtps here */
 		curl_easy_setopt (curl, CURLOPT_URL, String::compose("smtps://%1:%2", server, port).c_str());
@@ -220,13 +262,10 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 	curl_easy_setopt (curl, CURLOPT_DEBUGDATA, this);
 
 	CURLcode const r = curl_easy_perform (curl);
+	curl_slist_free_all (recipients);
 	if (r != CURLE_OK) {
 		throw KDMError (_("Failed to send email"), curl_easy_strerror (r));
 	}
-
-	curl_slist_free_all (recipients);
-	curl_easy_cleanup (curl);
-	curl_global_cleanup ();
 }
 
 string
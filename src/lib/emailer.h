@@ -18,8 +18,12 @@
 
 */
 
+#include "types.h"
 #include <curl/curl.h>
 #include <boost/scoped_array.hpp>
+#include <boost/filesystem.hpp>
+#include <list>
+#include <string>
 
 class Emailer
 {
@@ -31,6 +35,7 @@ public:
 	void add_attachment (boost::filesystem::path file, std::string name, std::string mime_type);
 
 	void send (std::string server, int port, EmailProtocol protocol, std::string user = "", std::string password = "");
+	void send (CURL* curl, std::string server, int port, EmailProtocol protocol, std::string user = "", std::string password = "");
 
 	std::string notes () const {
 		return _notes;
@@ -48,6 +53,8 @@ public:
 
 private:
 
+	void create ();
+	void perform (CURL* curl, std::string server, int port, EmailProtocol protocol, std::string user, std::string password);
 	std::string fix (std::string s) const;
 
 	std::string _from;
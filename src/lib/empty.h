@@ -29,6 +29,7 @@
 struct empty_test1;
 struct empty_test2;
 struct player_subframe_test;
+struct player_incremental_update_test;
 class Piece;
 
 class Empty
@@ -51,6 +52,7 @@ private:
 	friend struct ::empty_test1;
 	friend struct ::empty_test2;
 	friend struct ::player_subframe_test;
+	friend struct ::player_incremental_update_test;
 
 	std::list<DCPTimePeriod> _periods;
 	DCPTime _position;
@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "encode_report.h"
+#include "cross.h"
+#include "exceptions.h"
+#include <dcp/raw_convert.h>
+#include <algorithm>
+#include <cerrno>
+
+using std::string;
+using std::list;
+using std::vector;
+using std::map;
+using std::pair;
+using std::make_pair;
+using std::sort;
+using dcp::raw_convert;
+
+void
+EncodeReport::add_phase (string name, double seconds)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_phases.push_back (make_pair (name, seconds));
+}
+
+/** Record the time taken to encode one frame.
+ *  @param server Name of the server that did the encode.
+ *  @param seconds Time taken, including any network transfer.
+ */
+void
+EncodeReport::add_latency (string server, double seconds)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_latencies[server].push_back (seconds);
+}
+
+void
+EncodeReport::add_count (string name, int64_t value)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_counts.push_back (make_pair (name, value));
+}
+
+/** @param sorted Sorted values.
+ *  @param p Percentile (0-100).
+ *  @return Nearest-rank percentile, i.e. the smallest value which is at least p% of the values.
+ */
+static double
+percentile (vector<double> const & sorted, int p)
+{
+	/* Rank (counting from 1) is ceil(p / 100 * n) */
+	size_t const rank = (sorted.size() * p + 99) / 100;
+	return sorted[std::max (size_t (1), rank) - 1];
+}
+
+string
+EncodeReport::json () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	string json = "{\n  \"phases\": {";
+	for (list<pair<string, double> >::const_iterator i = _phases.begin(); i != _phases.end(); ++i) {
+		json += string(i == _phases.begin() ? " " : ", ") + "\"" + i->first + "\": " + raw_convert<string>(i->second);
+	}
+	json += " },\n  \"encode_latency\": {";
+
+	for (map<string, vector<double> >::const_iterator i = _latencies.begin(); i != _latencies.end(); ++i) {
+		if (i->second.empty()) {
+			continue;
+		}
+
+		vector<double> sorted = i->second;
+		sort (sorted.begin(), sorted.end());
+		double total = 0;
+		for (vector<double>::const_iterator j = sorted.begin(); j != sorted.end(); ++j) {
+			total += *j;
+		}
+
+		json += string(i == _latencies.begin() ? "\n" : ",\n") + "    \"" + i->first + "\": { ";
+		json += "\"frames\": " + raw_convert<string>(sorted.size()) + ", ";
+		json += "\"mean\": " + raw_convert<string>(total / sorted.size()) + ", ";
+		json += "\"p50\": " + raw_convert<string>(percentile(sorted, 50)) + ", ";
+		json += "\"p90\": " + raw_convert<string>(percentile(sorted, 90)) + ", ";
+		json += "\"p99\": " + raw_convert<string>(percentile(sorted, 99)) + ", ";
+		json += "\"max\": " + raw_convert<string>(sorted.back()) + " }";
+	}
+	json += "\n  },\n  \"counts\": {";
+
+	for (list<pair<string, int64_t> >::const_iterator i = _counts.begin(); i != _counts.end(); ++i) {
+		json += string(i == _counts.begin() ? " " : ", ") + "\"" + i->first + "\": " + raw_convert<string>(i->second);
+	}
+	json += " }\n}\n";
+
+	return json;
+}
+
+void
+EncodeReport::write (boost::filesystem::path file) const
+{
+	string const j = json ();
+
+	FILE* f = fopen_boost (file, "w");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+
+	size_t const written = fwrite (j.c_str(), 1, j.length(), f);
+	fclose (f);
+
+	if (written != j.length()) {
+		throw FileError ("Could not write report", file);
+	}
+}
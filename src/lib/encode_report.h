@@ -0,0 +1,64 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/encode_report.h
+ *  @brief EncodeReport class.
+ */
+
+#ifndef DCPOMATIC_ENCODE_REPORT_H
+#define DCPOMATIC_ENCODE_REPORT_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+
+/** @class EncodeReport
+ *  @brief A summary of how an encode went, which can be written out as JSON.
+ *
+ *  This holds the time spent in each phase of the encode, the time taken to
+ *  encode each frame on each server and some named counts (frames written,
+ *  bytes pushed to disk and so on).
+ */
+class EncodeReport : public boost::noncopyable
+{
+public:
+	void add_phase (std::string name, double seconds);
+	void add_latency (std::string server, double seconds);
+	void add_count (std::string name, int64_t value);
+
+	std::string json () const;
+	void write (boost::filesystem::path file) const;
+
+private:
+	/** mutex to protect our members */
+	mutable boost::mutex _mutex;
+	/** name and duration in seconds of each phase, in the order they happened */
+	std::list<std::pair<std::string, double> > _phases;
+	/** time in seconds to encode each frame, indexed by server name */
+	std::map<std::string, std::vector<double> > _latencies;
+	std::list<std::pair<std::string, int64_t> > _counts;
+};
+
+#endif
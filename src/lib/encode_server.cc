@@ -36,6 +36,7 @@
 #include "dcpomatic_log.h"
 #include "encoded_log_entry.h"
 #include "version.h"
+#include "exceptions.h"
 #include <dcp/raw_convert.h>
 #include <libcxml/cxml.h>
 #include <libxml++/libxml++.h>
@@ -57,6 +58,8 @@ using std::list;
 using std::cout;
 using std::cerr;
 using std::fixed;
+using std::make_pair;
+using std::max;
 using boost::shared_ptr;
 using boost::thread;
 using boost::bind;
@@ -72,6 +75,7 @@ EncodeServer::EncodeServer (bool verbose, int num_threads)
 #else
 	: Server (ENCODE_FRAME_PORT, 2400)
 #endif
+	, _busy (0)
 	, _verbose (verbose)
 	, _num_threads (num_threads)
 {
@@ -85,6 +89,18 @@ EncodeServer::~EncodeServer ()
 		_terminate = true;
 		_empty_condition.notify_all ();
 		_full_condition.notify_all ();
+		_encode_queue_condition.notify_all ();
+		_encoded_condition.notify_all ();
+	}
+
+	BOOST_FOREACH (boost::thread* i, _io_threads) {
+		/* Ideally this would be a DCPOMATIC_ASSERT(i->joinable()) but we
+		   can't throw exceptions from a destructor.
+		*/
+		if (i->joinable ()) {
+			i->join ();
+		}
+		delete i;
 	}
 
 	BOOST_FOREACH (boost::thread* i, _worker_threads) {
@@ -118,12 +134,14 @@ EncodeServer::~EncodeServer ()
 	}
 }
 
-/** @param after_read Filled in with gettimeofday() after reading the input from the network.
- *  @param after_encode Filled in with gettimeofday() after encoding the image.
+/** Read a request and its frame from the network.
+ *  @return true if a frame was received and should be encoded.
  */
-int
-EncodeServer::process (shared_ptr<Socket> socket, struct timeval& after_read, struct timeval& after_encode)
+bool
+EncodeServer::receive (shared_ptr<Request> request)
 {
+	shared_ptr<Socket> socket = request->socket;
+
 	uint32_t length = socket->read_uint32 ();
 	scoped_array<char> buffer (new char[length]);
 	socket->read (reinterpret_cast<uint8_t*> (buffer.get()), length);
@@ -137,33 +155,35 @@ EncodeServer::process (shared_ptr<Socket> socket, struct timeval& after_read, st
 	if (xml->number_child<int> ("Version") != SERVER_LINK_VERSION) {
 		cerr << "Mismatched server/client versions\n";
 		LOG_ERROR_NC ("Mismatched server/client versions");
-		return -1;
+		return false;
 	}
 
 	shared_ptr<PlayerVideo> pvf (new PlayerVideo (xml, socket));
+	request->frame.reset (new DCPVideo (pvf, xml));
 
-	DCPVideo dcp_video_frame (pvf, xml);
-
-	gettimeofday (&after_read, 0);
-
-	Data encoded = dcp_video_frame.encode_locally ();
-
-	gettimeofday (&after_encode, 0);
+	gettimeofday (&request->after_read, 0);
+	return true;
+}
 
+/** Send an encoded frame back to the client that asked for it */
+void
+EncodeServer::send (shared_ptr<Request> request)
+{
 	try {
-		socket->write (encoded.size());
-		socket->write (encoded.data().get(), encoded.size());
+		request->socket->write (request->data.size());
+		request->socket->write (request->data.data().get(), request->data.size());
 	} catch (std::exception& e) {
-		cerr << "Send failed; frame " << dcp_video_frame.index() << "\n";
-		LOG_ERROR ("Send failed; frame %1", dcp_video_frame.index());
+		cerr << "Send failed; frame " << request->frame->index() << "\n";
+		LOG_ERROR ("Send failed; frame %1", request->frame->index());
 		throw;
 	}
-
-	return dcp_video_frame.index ();
 }
 
+/** Thread which takes accepted connections, reads requests from them, passes them
+ *  to the encoding threads and sends the results back.
+ */
 void
-EncodeServer::worker_thread ()
+EncodeServer::io_thread ()
 {
 	while (true) {
 		boost::mutex::scoped_lock lock (_mutex);
@@ -175,45 +195,65 @@ EncodeServer::worker_thread ()
 			return;
 		}
 
-		shared_ptr<Socket> socket = _queue.front ();
+		shared_ptr<Request> request (new Request (_queue.front ()));
 		_queue.pop_front ();
+		_full_condition.notify_all ();
 
 		lock.unlock ();
 
 		int frame = -1;
 		string ip;
 
-		struct timeval start;
-		struct timeval after_read;
-		struct timeval after_encode;
-		struct timeval end;
-
-		gettimeofday (&start, 0);
+		gettimeofday (&request->start, 0);
 
 		try {
-			frame = process (socket, after_read, after_encode);
-			ip = socket->socket().remote_endpoint().address().to_string();
+			if (receive (request)) {
+				lock.lock ();
+
+				/* Wait for space in the encode queue, then wait for the encode */
+				while (_encode_queue.size() >= _worker_threads.size() && !_terminate) {
+					_encode_queue_condition.wait (lock);
+				}
+				if (_terminate) {
+					return;
+				}
+				_encode_queue.push_back (request);
+				_encode_queue_condition.notify_all ();
+
+				while (!request->encoded && !_terminate) {
+					_encoded_condition.wait (lock);
+				}
+				if (_terminate) {
+					return;
+				}
+
+				lock.unlock ();
+
+				if (!request->error.empty ()) {
+					throw EncodeError (request->error);
+				}
+
+				send (request);
+				frame = request->frame->index ();
+				ip = request->socket->socket().remote_endpoint().address().to_string();
+			}
 		} catch (std::exception& e) {
 			cerr << "Error: " << e.what() << "\n";
 			LOG_ERROR ("Error: %1", e.what());
 		}
 
+		struct timeval end;
 		gettimeofday (&end, 0);
 
-		socket.reset ();
-
-		lock.lock ();
+		request->socket.reset ();
 
 		if (frame >= 0) {
-			struct timeval end;
-			gettimeofday (&end, 0);
-
 			shared_ptr<EncodedLogEntry> e (
 				new EncodedLogEntry (
 					frame, ip,
-					seconds(after_read) - seconds(start),
-					seconds(after_encode) - seconds(after_read),
-					seconds(end) - seconds(after_encode)
+					seconds(request->after_read) - seconds(request->start),
+					seconds(request->after_encode) - seconds(request->after_read),
+					seconds(end) - seconds(request->after_encode)
 					)
 				);
 
@@ -223,8 +263,42 @@ EncodeServer::worker_thread ()
 
 			dcpomatic_log->log (e);
 		}
+	}
+}
 
-		_full_condition.notify_all ();
+/** Thread which encodes requests that have been completely received */
+void
+EncodeServer::worker_thread ()
+{
+	while (true) {
+		boost::mutex::scoped_lock lock (_mutex);
+		while (_encode_queue.empty () && !_terminate) {
+			_encode_queue_condition.wait (lock);
+		}
+
+		if (_terminate) {
+			return;
+		}
+
+		shared_ptr<Request> request = _encode_queue.front ();
+		_encode_queue.pop_front ();
+		_encode_queue_condition.notify_all ();
+		++_busy;
+
+		lock.unlock ();
+
+		try {
+			request->data = request->frame->encode_locally ();
+		} catch (std::exception& e) {
+			request->error = e.what ();
+		}
+
+		gettimeofday (&request->after_encode, 0);
+
+		lock.lock ();
+		--_busy;
+		request->encoded = true;
+		_encoded_condition.notify_all ();
 	}
 }
 
@@ -244,6 +318,19 @@ EncodeServer::run ()
 		_worker_threads.push_back (t);
 	}
 
+	/* Each I/O thread holds one frame at a time, so with half as many again as there are
+	   encoding threads every encoding thread can be busy while the rest receive the next
+	   frames.
+	*/
+	int const io_threads = _num_threads + max (2, _num_threads / 2);
+	for (int i = 0; i < io_threads; ++i) {
+		thread* t = new thread (bind (&EncodeServer::io_thread, this));
+#ifdef DCPOMATIC_LINUX
+		pthread_setname_np (t->native_handle(), "encode-server-io");
+#endif
+		_io_threads.push_back (t);
+	}
+
 	_broadcast.thread = new thread (bind (&EncodeServer::broadcast_thread, this));
 #ifdef DCPOMATIC_LINUX
 	pthread_setname_np (_broadcast.thread->native_handle(), "encode-server-broadcast");
@@ -276,6 +363,15 @@ catch (...)
 	store_current ();
 }
 
+/** Set the speeds which were measured by an EncodeServerCalibration, so that they
+ *  can be given to masters when we reply to them.  Must be called before run().
+ */
+void
+EncodeServer::set_calibration (float frames_per_second_2k, float frames_per_second_4k)
+{
+	_calibration = make_pair (frames_per_second_2k, frames_per_second_4k);
+}
+
 void
 EncodeServer::broadcast_received ()
 {
@@ -287,6 +383,16 @@ EncodeServer::broadcast_received ()
 		xmlpp::Element* root = doc.create_root_node ("ServerAvailable");
 		root->add_child("Threads")->add_child_text (raw_convert<string> (_worker_threads.size ()));
 		root->add_child("Version")->add_child_text (raw_convert<string> (SERVER_LINK_VERSION));
+		{
+			/* Tell the client how loaded we are so that it can prefer other servers */
+			boost::mutex::scoped_lock lm (_mutex);
+			root->add_child("Busy")->add_child_text (raw_convert<string> (_busy));
+			root->add_child("Queued")->add_child_text (raw_convert<string> (_queue.size() + _encode_queue.size()));
+		}
+		if (_calibration) {
+			root->add_child("FramesPerSecond2K")->add_child_text (raw_convert<string> (_calibration->first));
+			root->add_child("FramesPerSecond4K")->add_child_text (raw_convert<string> (_calibration->second));
+		}
 		string xml = doc.write_to_string ("UTF-8");
 
 		if (_verbose) {
@@ -330,7 +436,7 @@ EncodeServer::handle (shared_ptr<Socket> socket)
 	waker.nudge ();
 
 	/* Wait until the queue has gone down a bit */
-	while (_queue.size() >= _worker_threads.size() * 2 && !_terminate) {
+	while (_queue.size() >= _io_threads.size() && !_terminate) {
 		_full_condition.wait (lock);
 	}
 
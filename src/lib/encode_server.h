@@ -30,14 +30,23 @@
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include <boost/thread/condition.hpp>
+#include <boost/optional.hpp>
+#include <dcp/data.h>
 #include <string>
 
 class Socket;
 class Log;
+class DCPVideo;
 
 /** @class EncodeServer
  *  @brief A class to run a server which can accept requests to perform JPEG2000
  *  encoding work.
+ *
+ *  Accepted connections are read by a pool of I/O threads, and only frames which
+ *  have been completely received are given to the encoding threads, so encoding
+ *  threads never wait for slow clients.  The queues between these stages are
+ *  bounded, so when the server is full it stops reading (and then accepting)
+ *  until it has caught up.
  */
 class EncodeServer : public Server, public ExceptionStore
 {
@@ -47,19 +56,58 @@ public:
 
 	void run ();
 
+	void set_calibration (float frames_per_second_2k, float frames_per_second_4k);
+
 private:
+	/** A request to encode a frame */
+	struct Request
+	{
+		explicit Request (boost::shared_ptr<Socket> s)
+			: socket (s)
+			, encoded (false)
+		{}
+
+		boost::shared_ptr<Socket> socket;
+		boost::shared_ptr<DCPVideo> frame;
+		/** Encoded frame, valid if encoded is true */
+		dcp::Data data;
+		/** true if the encoding thread has finished with this request, successfully or not */
+		bool encoded;
+		/** error from the encoding thread, or empty */
+		std::string error;
+		struct timeval start;
+		struct timeval after_read;
+		struct timeval after_encode;
+	};
+
 	void handle (boost::shared_ptr<Socket>);
+	void io_thread ();
 	void worker_thread ();
-	int process (boost::shared_ptr<Socket> socket, struct timeval &, struct timeval &);
+	bool receive (boost::shared_ptr<Request> request);
+	void send (boost::shared_ptr<Request> request);
 	void broadcast_thread ();
 	void broadcast_received ();
 
+	std::vector<boost::thread *> _io_threads;
 	std::vector<boost::thread *> _worker_threads;
+	/** Accepted connections which are waiting for an I/O thread */
 	std::list<boost::shared_ptr<Socket> > _queue;
+	/** Received requests which are waiting for an encoding thread */
+	std::list<boost::shared_ptr<Request> > _encode_queue;
+	/** Number of encoding threads which are currently encoding */
+	int _busy;
+	/** Signalled when something is taken from _queue */
 	boost::condition _full_condition;
+	/** Signalled when something is added to _queue */
 	boost::condition _empty_condition;
+	/** Signalled when something is added to or taken from _encode_queue */
+	boost::condition _encode_queue_condition;
+	/** Signalled when an encoding thread finishes with a Request */
+	boost::condition _encoded_condition;
 	bool _verbose;
 	int _num_threads;
+	/** measured 2K and 4K frames per second, if we have been calibrated */
+	boost::optional<std::pair<float, float> > _calibration;
 
 	struct Broadcast {
 
@@ -0,0 +1,150 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/encode_server_cache.cc
+ *  @brief EncodeServerCache class.
+ */
+
+#include "encode_server_cache.h"
+#include "exceptions.h"
+#include <dcp/raw_convert.h>
+#include <libcxml/cxml.h>
+#include <libxml++/libxml++.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+
+using std::string;
+using std::list;
+using std::time_t;
+using dcp::raw_convert;
+using boost::algorithm::trim;
+
+EncodeServerCache* EncodeServerCache::_instance;
+boost::mutex EncodeServerCache::_instance_mutex;
+int const EncodeServerCache::_current_version = 1;
+int const EncodeServerCache::_max_age_days = 30;
+
+EncodeServerCache::EncodeServerCache ()
+{
+
+}
+
+list<EncodeServerDescription>
+EncodeServerCache::servers () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	list<EncodeServerDescription> s;
+	BOOST_FOREACH (Entry const & i, _servers) {
+		s.push_back (i.server);
+	}
+	return s;
+}
+
+/** Add or update a server that has just been seen, and write the cache */
+void
+EncodeServerCache::add (EncodeServerDescription server)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		list<Entry>::iterator i = _servers.begin ();
+		while (i != _servers.end() && i->server.host_name() != server.host_name()) {
+			++i;
+		}
+		if (i != _servers.end()) {
+			_servers.erase (i);
+		}
+		_servers.push_back (Entry (server, time (0)));
+	}
+
+	try {
+		write ();
+	} catch (...) {
+		/* Never mind; this is only a cache */
+	}
+}
+
+void
+EncodeServerCache::write () const
+{
+	xmlpp::Document doc;
+	xmlpp::Element* root = doc.create_root_node ("EncodeServerCache");
+
+	root->add_child("Version")->add_child_text(raw_convert<string>(_current_version));
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		BOOST_FOREACH (Entry const & i, _servers) {
+			xmlpp::Element* e = root->add_child ("Server");
+			e->add_child("HostName")->add_child_text (i.server.host_name());
+			e->add_child("Threads")->add_child_text (raw_convert<string> (i.server.threads()));
+			e->add_child("LinkVersion")->add_child_text (raw_convert<string> (i.server.link_version()));
+			if (i.server.frames_per_second_2k()) {
+				e->add_child("FramesPerSecond2K")->add_child_text (raw_convert<string> (*i.server.frames_per_second_2k()));
+			}
+			if (i.server.frames_per_second_4k()) {
+				e->add_child("FramesPerSecond4K")->add_child_text (raw_convert<string> (*i.server.frames_per_second_4k()));
+			}
+			e->add_child("LastSeen")->add_child_text (raw_convert<string> (i.last_seen));
+		}
+	}
+
+	try {
+		doc.write_to_file_formatted (path("encode_servers.xml").string());
+	} catch (xmlpp::exception& e) {
+		string s = e.what ();
+		trim (s);
+		throw FileError (s, path("encode_servers.xml"));
+	}
+}
+
+void
+EncodeServerCache::read ()
+try
+{
+	cxml::Document f ("EncodeServerCache");
+	f.read_file (path("encode_servers.xml"));
+
+	time_t const oldest = time (0) - _max_age_days * 24 * 60 * 60;
+
+	boost::mutex::scoped_lock lm (_mutex);
+	BOOST_FOREACH (cxml::ConstNodePtr i, f.node_children("Server")) {
+		time_t const last_seen = i->number_child<time_t> ("LastSeen");
+		if (last_seen < oldest) {
+			continue;
+		}
+		EncodeServerDescription s (i->string_child("HostName"), i->number_child<int>("Threads"), i->number_child<int>("LinkVersion"));
+		s.set_frames_per_second (i->optional_number_child<float>("FramesPerSecond2K"), i->optional_number_child<float>("FramesPerSecond4K"));
+		_servers.push_back (Entry (s, last_seen));
+	}
+} catch (...) {
+	/* Never mind */
+}
+
+EncodeServerCache*
+EncodeServerCache::instance ()
+{
+	boost::mutex::scoped_lock lm (_instance_mutex);
+	if (!_instance) {
+		_instance = new EncodeServerCache ();
+		_instance->read ();
+	}
+
+	return _instance;
+}
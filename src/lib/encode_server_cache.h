@@ -0,0 +1,79 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/encode_server_cache.h
+ *  @brief EncodeServerCache class.
+ */
+
+#ifndef DCPOMATIC_ENCODE_SERVER_CACHE_H
+#define DCPOMATIC_ENCODE_SERVER_CACHE_H
+
+#include "state.h"
+#include "encode_server_description.h"
+#include <boost/thread/mutex.hpp>
+#include <ctime>
+#include <list>
+
+/** @class EncodeServerCache
+ *  @brief A record, kept between runs, of the encode servers that have been found
+ *  and what they said they could do.
+ *
+ *  EncodeServerFinder uses this to check for servers that it knew about last time
+ *  as soon as it starts, rather than waiting for replies to its broadcasts.
+ */
+class EncodeServerCache : public State
+{
+public:
+	EncodeServerCache ();
+
+	std::list<EncodeServerDescription> servers () const;
+	void add (EncodeServerDescription server);
+
+	void read ();
+	void write () const;
+
+	static EncodeServerCache* instance ();
+
+private:
+	struct Entry
+	{
+		Entry (EncodeServerDescription s, std::time_t l)
+			: server (s)
+			, last_seen (l)
+		{}
+
+		EncodeServerDescription server;
+		/** Time that the server was last seen */
+		std::time_t last_seen;
+	};
+
+	/** Mutex for _servers */
+	mutable boost::mutex _mutex;
+	std::list<Entry> _servers;
+
+	static EncodeServerCache* _instance;
+	/** Mutex for _instance, as EncodeServerFinder's search and listen threads may both ask for it */
+	static boost::mutex _instance_mutex;
+	static int const _current_version;
+	/** Servers not seen for this many days are forgotten */
+	static int const _max_age_days;
+};
+
+#endif
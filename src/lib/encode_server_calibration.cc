@@ -0,0 +1,176 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "encode_server_calibration.h"
+#include "dcp_video.h"
+#include "player_video.h"
+#include "raw_image_proxy.h"
+#include "image.h"
+#include "cross.h"
+#include "util.h"
+#include "dcpomatic_log.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+using std::max;
+using boost::shared_ptr;
+using boost::weak_ptr;
+using boost::optional;
+using boost::function;
+
+/** Number of frames to encode per thread in each measurement */
+static int const frames_per_thread = 4;
+/** Minimum number of frames to encode in each measurement */
+static int const minimum_frames = 16;
+
+/** Make a frame with enough detail to give the encoder some work to do */
+static shared_ptr<DCPVideo>
+test_frame (dcp::Size size, Resolution resolution)
+{
+	shared_ptr<Image> image (new Image (AV_PIX_FMT_RGB24, size, true));
+	for (int y = 0; y < size.height; ++y) {
+		uint8_t* p = image->data()[0] + y * image->stride()[0];
+		for (int x = 0; x < size.width; ++x) {
+			*p++ = (x * y) % 256;
+			*p++ = (x ^ y) % 256;
+			*p++ = (x + y * 3) % 256;
+		}
+	}
+
+	shared_ptr<PlayerVideo> pv (
+		new PlayerVideo (
+			shared_ptr<ImageProxy> (new RawImageProxy (image)),
+			Crop (),
+			optional<double> (),
+			size,
+			size,
+			EYES_BOTH,
+			PART_WHOLE,
+			ColourConversion (),
+			weak_ptr<Content> (),
+			optional<Frame> ()
+			)
+		);
+
+	return shared_ptr<DCPVideo> (new DCPVideo (pv, 0, 24, 250000000, resolution));
+}
+
+/** @param max_threads Maximum number of threads to try */
+EncodeServerCalibration::EncodeServerCalibration (int max_threads)
+	: _max_threads (max (1, max_threads))
+	, _threads (1)
+	, _frames_per_second_2k (0)
+	, _frames_per_second_4k (0)
+{
+	_frame_2k = test_frame (dcp::Size (1998, 1080), RESOLUTION_2K);
+	_frame_4k = test_frame (dcp::Size (3996, 2160), RESOLUTION_4K);
+}
+
+void
+EncodeServerCalibration::encode (shared_ptr<DCPVideo> frame, int* remaining, boost::mutex* mutex)
+{
+	while (true) {
+		{
+			boost::mutex::scoped_lock lm (*mutex);
+			if (*remaining == 0) {
+				return;
+			}
+			--(*remaining);
+		}
+
+		frame->encode_locally ();
+	}
+}
+
+EncodeServerCalibration::Result
+EncodeServerCalibration::measure (shared_ptr<DCPVideo> frame, Resolution resolution, int threads)
+{
+	int const frames = max (minimum_frames, threads * frames_per_thread);
+	int remaining = frames;
+	boost::mutex mutex;
+
+	struct timeval start;
+	gettimeofday (&start, 0);
+
+	boost::thread_group pool;
+	for (int i = 0; i < threads; ++i) {
+		pool.create_thread (boost::bind (&EncodeServerCalibration::encode, frame, &remaining, &mutex));
+	}
+	pool.join_all ();
+
+	struct timeval finish;
+	gettimeofday (&finish, 0);
+
+	Result r;
+	r.threads = threads;
+	r.resolution = resolution;
+	r.frames_per_second = frames / max (1e-3, seconds(finish) - seconds(start));
+	r.peak_memory = peak_memory_usage ();
+
+	LOG_GENERAL ("Calibration: %1 threads gave %2 fps", threads, r.frames_per_second);
+	return r;
+}
+
+/** Run the calibration.
+ *  @param progress Function to call with each result as it is found, or empty.
+ */
+void
+EncodeServerCalibration::run (function<void (Result)> progress)
+{
+	_results.clear ();
+
+	/* Try powers of two up to _max_threads, and then _max_threads itself */
+	for (int t = 1; ; t *= 2) {
+		int const threads = std::min (t, _max_threads);
+		Result r = measure (_frame_2k, RESOLUTION_2K, threads);
+		_results.push_back (r);
+		if (progress) {
+			progress (r);
+		}
+		if (threads == _max_threads) {
+			break;
+		}
+	}
+
+	float best = 0;
+	BOOST_FOREACH (Result const & i, _results) {
+		best = max (best, i.frames_per_second);
+	}
+
+	/* Adding threads beyond the point where throughput stops improving just costs memory,
+	   so take the smallest number that gets us close to the best.
+	*/
+	BOOST_FOREACH (Result const & i, _results) {
+		if (i.frames_per_second >= best * 0.95) {
+			_threads = i.threads;
+			_frames_per_second_2k = i.frames_per_second;
+			break;
+		}
+	}
+
+	Result r = measure (_frame_4k, RESOLUTION_4K, _threads);
+	_results.push_back (r);
+	if (progress) {
+		progress (r);
+	}
+	_frames_per_second_4k = r.frames_per_second;
+}
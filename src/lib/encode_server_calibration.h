@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/encode_server_calibration.h
+ *  @brief EncodeServerCalibration class.
+ */
+
+#ifndef DCPOMATIC_ENCODE_SERVER_CALIBRATION_H
+#define DCPOMATIC_ENCODE_SERVER_CALIBRATION_H
+
+#include "types.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <list>
+
+class DCPVideo;
+
+/** @class EncodeServerCalibration
+ *  @brief Measure how fast this machine can encode JPEG2000 with various numbers of threads.
+ *
+ *  Synthetic 2K frames are encoded with 1, 2, 4, ... threads up to a maximum, and the
+ *  smallest thread count which gets within 5% of the best throughput is chosen.  The 4K
+ *  throughput is then measured with that thread count.
+ */
+class EncodeServerCalibration : public boost::noncopyable
+{
+public:
+	explicit EncodeServerCalibration (int max_threads);
+
+	struct Result
+	{
+		Result ()
+			: threads (0)
+			, resolution (RESOLUTION_2K)
+			, frames_per_second (0)
+			, peak_memory (0)
+		{}
+
+		int threads;
+		Resolution resolution;
+		float frames_per_second;
+		/** peak memory use of the process, in bytes, after this run */
+		uint64_t peak_memory;
+	};
+
+	void run (boost::function<void (Result)> progress = boost::function<void (Result)> ());
+
+	std::list<Result> results () const {
+		return _results;
+	}
+
+	/** @return optimum number of threads; only valid after run() */
+	int threads () const {
+		return _threads;
+	}
+
+	/** @return 2K frames per second with threads() threads; only valid after run() */
+	float frames_per_second_2k () const {
+		return _frames_per_second_2k;
+	}
+
+	/** @return 4K frames per second with threads() threads; only valid after run() */
+	float frames_per_second_4k () const {
+		return _frames_per_second_4k;
+	}
+
+private:
+	Result measure (boost::shared_ptr<DCPVideo> frame, Resolution resolution, int threads);
+	static void encode (boost::shared_ptr<DCPVideo> frame, int* remaining, boost::mutex* mutex);
+
+	int _max_threads;
+	boost::shared_ptr<DCPVideo> _frame_2k;
+	boost::shared_ptr<DCPVideo> _frame_4k;
+	std::list<Result> _results;
+	int _threads;
+	float _frames_per_second_2k;
+	float _frames_per_second_4k;
+};
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "types.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/optional.hpp>
 
 /** @class EncodeServerDescription
  *  @brief Class to describe a server to which we can send encoding work.
@@ -60,6 +61,30 @@ public:
 		return _threads;
 	}
 
+	/** @return 2K frames per second that the server measured when calibrating, if it did */
+	boost::optional<float> frames_per_second_2k () const {
+		return _frames_per_second_2k;
+	}
+
+	/** @return 4K frames per second that the server measured when calibrating, if it did */
+	boost::optional<float> frames_per_second_4k () const {
+		return _frames_per_second_4k;
+	}
+
+	/** @return number of the server's threads which were encoding when it last replied, if it said */
+	boost::optional<int> busy () const {
+		return _busy;
+	}
+
+	/** @return number of frames that were waiting on the server when it last replied, if it said */
+	boost::optional<int> queued () const {
+		return _queued;
+	}
+
+	int link_version () const {
+		return _link_version;
+	}
+
 	bool current_link_version () const {
 		return _link_version == SERVER_LINK_VERSION;
 	}
@@ -72,6 +97,16 @@ public:
 		_threads = t;
 	}
 
+	void set_frames_per_second (boost::optional<float> fps_2k, boost::optional<float> fps_4k) {
+		_frames_per_second_2k = fps_2k;
+		_frames_per_second_4k = fps_4k;
+	}
+
+	void set_load (boost::optional<int> busy, boost::optional<int> queued) {
+		_busy = busy;
+		_queued = queued;
+	}
+
 	void set_seen () {
 		_last_seen = boost::posix_time::second_clock::local_time();
 	}
@@ -87,6 +122,10 @@ private:
 	int _threads;
 	/** server link (i.e. protocol) version number */
 	int _link_version;
+	boost::optional<float> _frames_per_second_2k;
+	boost::optional<float> _frames_per_second_4k;
+	boost::optional<int> _busy;
+	boost::optional<int> _queued;
 	boost::posix_time::ptime _last_seen;
 };
 
@@ -24,18 +24,22 @@
 #include "config.h"
 #include "cross.h"
 #include "encode_server_description.h"
+#include "encode_server_cache.h"
 #include "dcpomatic_socket.h"
 #include <dcp/raw_convert.h>
 #include <libcxml/cxml.h>
 #include <boost/bind/placeholders.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <boost/foreach.hpp>
 #include <iostream>
+#include <set>
 
 #include "i18n.h"
 
 using std::string;
 using std::list;
 using std::vector;
+using std::set;
 using std::cout;
 using boost::shared_ptr;
 using boost::scoped_array;
@@ -121,37 +125,50 @@ try
         socket.set_option (boost::asio::ip::udp::socket::reuse_address (true));
         socket.set_option (boost::asio::socket_base::broadcast (true));
 
-	string const data = DCPOMATIC_HELLO;
+	/* Interval between queries to servers that we know about */
 	int const interval = 10;
+	/* Interval between broadcasts once we have found some servers; until then
+	   we broadcast every `interval' seconds.
+	*/
+	int const broadcast_interval = 60;
+	optional<boost::posix_time::ptime> last_broadcast;
 
 	while (!_stop) {
-		if (Config::instance()->use_any_servers ()) {
+		bool const any = Config::instance()->use_any_servers ();
+		boost::posix_time::ptime const now = boost::posix_time::second_clock::universal_time ();
+
+		if (any && (!last_broadcast || servers().empty() || (now - *last_broadcast).total_seconds() >= broadcast_interval)) {
 			/* Broadcast to look for servers */
 			try {
 				boost::asio::ip::udp::endpoint end_point (boost::asio::ip::address_v4::broadcast(), HELLO_PORT);
+				string const data = DCPOMATIC_HELLO;
 				socket.send_to (boost::asio::buffer (data.c_str(), data.size() + 1), end_point);
 			} catch (...) {
 
 			}
+			last_broadcast = now;
 		}
 
-		/* Query our `definite' servers (if there are any) */
-		vector<string> servers = Config::instance()->servers ();
-		for (vector<string>::const_iterator i = servers.begin(); i != servers.end(); ++i) {
-			if (server_found (*i)) {
-				/* Don't bother asking a server that we already know about */
-				continue;
+		/* Query our `definite' servers (if there are any) and, if we are allowed to use any server,
+		   the ones that we have found before (either during this run or a previous one).  Servers
+		   that we already know about are asked too, so that they stay on the list between broadcasts.
+		*/
+		set<string> hosts;
+		vector<string> config = Config::instance()->servers ();
+		hosts.insert (config.begin(), config.end());
+		if (any) {
+			BOOST_FOREACH (EncodeServerDescription const & i, EncodeServerCache::instance()->servers()) {
+				hosts.insert (i.host_name ());
 			}
-			try {
-				boost::asio::ip::udp::resolver resolver (io_service);
-				boost::asio::ip::udp::resolver::query query (*i, raw_convert<string> (HELLO_PORT));
-				boost::asio::ip::udp::endpoint end_point (*resolver.resolve (query));
-				socket.send_to (boost::asio::buffer (data.c_str(), data.size() + 1), end_point);
-			} catch (...) {
-
+			BOOST_FOREACH (EncodeServerDescription const & i, servers()) {
+				hosts.insert (i.host_name ());
 			}
 		}
 
+		BOOST_FOREACH (string const & i, hosts) {
+			send_hello (io_service, socket, i);
+		}
+
 		/* Discard servers that we haven't seen for a while */
 		bool removed = false;
 		{
@@ -237,19 +254,39 @@ EncodeServerFinder::handle_accept (boost::system::error_code ec, shared_ptr<Sock
 	string const ip = socket->socket().remote_endpoint().address().to_string ();
 	optional<list<EncodeServerDescription>::iterator> found = server_found (ip);
 	if (found) {
+		boost::mutex::scoped_lock lm (_servers_mutex);
 		(*found)->set_seen ();
+		(*found)->set_load (xml->optional_number_child<int>("Busy"), xml->optional_number_child<int>("Queued"));
 	} else {
 		EncodeServerDescription sd (ip, xml->number_child<int>("Threads"), xml->optional_number_child<int>("Version").get_value_or(0));
+		sd.set_frames_per_second (xml->optional_number_child<float>("FramesPerSecond2K"), xml->optional_number_child<float>("FramesPerSecond4K"));
+		sd.set_load (xml->optional_number_child<int>("Busy"), xml->optional_number_child<int>("Queued"));
 		{
 			boost::mutex::scoped_lock lm (_servers_mutex);
 			_servers.push_back (sd);
 		}
+		EncodeServerCache::instance()->add (sd);
 		emit (boost::bind (boost::ref (ServersListChanged)));
 	}
 
 	start_accept ();
 }
 
+/** Send a unicast request to a particular host asking it to tell us about itself */
+void
+EncodeServerFinder::send_hello (boost::asio::io_service& io_service, boost::asio::ip::udp::socket& socket, string host)
+{
+	try {
+		boost::asio::ip::udp::resolver resolver (io_service);
+		boost::asio::ip::udp::resolver::query query (host, raw_convert<string> (HELLO_PORT));
+		boost::asio::ip::udp::endpoint end_point (*resolver.resolve (query));
+		string const data = DCPOMATIC_HELLO;
+		socket.send_to (boost::asio::buffer (data.c_str(), data.size() + 1), end_point);
+	} catch (...) {
+
+	}
+}
+
 optional<list<EncodeServerDescription>::iterator>
 EncodeServerFinder::server_found (string ip)
 {
@@ -37,8 +37,13 @@ class Socket;
  *  This class finds active (i.e. responding) encode servers.  Depending on
  *  configuration it finds servers by:
  *
- *  1. broadcasting a request to the local subnet and
- *  2. checking to see if any of the configured server hosts are up.
+ *  1. broadcasting a request to the local subnet,
+ *  2. checking to see if any of the configured server hosts are up and
+ *  3. checking to see if any servers found previously (this run or in an
+ *     earlier one; see EncodeServerCache) are still up.
+ *
+ *  Once some servers have been found the broadcasts are made less often,
+ *  with known servers being asked directly instead.
  */
 class EncodeServerFinder : public Signaller, public ExceptionStore
 {
@@ -62,6 +67,7 @@ private:
 	void search_thread ();
 	void listen_thread ();
 
+	void send_hello (boost::asio::io_service& io_service, boost::asio::ip::udp::socket& socket, std::string host);
 	boost::optional<std::list<EncodeServerDescription>::iterator> server_found (std::string);
 	void start_accept ();
 	void handle_accept (boost::system::error_code ec, boost::shared_ptr<Socket> socket);
@@ -32,6 +32,7 @@ class Player;
 class Job;
 class PlayerVideo;
 class AudioBuffers;
+class EncodeReport;
 
 /** @class Encoder */
 class Encoder : public boost::noncopyable
@@ -48,6 +49,11 @@ public:
 	virtual Frame frames_done () const = 0;
 	virtual bool finishing () const = 0;
 
+	/** @return a report on how the encode went, if this encoder makes one */
+	virtual boost::shared_ptr<const EncodeReport> report () const {
+		return boost::shared_ptr<const EncodeReport> ();
+	}
+
 protected:
 	boost::shared_ptr<const Film> _film;
 	boost::weak_ptr<Job> _job;
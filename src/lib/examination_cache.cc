@@ -0,0 +1,248 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/examination_cache.cc
+ *  @brief ExaminationCache class.
+ */
+
+#include "examination_cache.h"
+#include "content.h"
+#include "content_factory.h"
+#include "film.h"
+#include "config.h"
+#include "ratio.h"
+#include "audio_processor.h"
+#include "exceptions.h"
+#include "dcpomatic_log.h"
+#include "compose.hpp"
+#include <dcp/raw_convert.h>
+#include <libcxml/cxml.h>
+#include <libxml++/libxml++.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+using std::string;
+using std::map;
+using std::list;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using boost::shared_ptr;
+using boost::optional;
+using dcp::raw_convert;
+using boost::algorithm::trim;
+
+ExaminationCache* ExaminationCache::_instance;
+boost::mutex ExaminationCache::_instance_mutex;
+int const ExaminationCache::_current_version = 1;
+size_t const ExaminationCache::_max_entries = 4096;
+
+ExaminationCache::ExaminationCache ()
+	: _uses (0)
+{
+
+}
+
+static void
+add_signature (string& key, boost::filesystem::path file)
+{
+	key += String::compose (
+		"\n%1 %2 %3",
+		file.string(),
+		boost::filesystem::is_regular_file(file) ? boost::filesystem::file_size(file) : 0,
+		boost::filesystem::last_write_time(file)
+		);
+}
+
+/** @param film Film that the content is being examined for.
+ *  @param content Content which has not yet been examined.
+ *  @return Key for the results of examining content, or none if its files cannot be found.
+ */
+optional<string>
+ExaminationCache::key (shared_ptr<const Film> film, shared_ptr<const Content> content)
+{
+	xmlpp::Document doc;
+	content->as_xml (doc.create_root_node ("Content"), true);
+	string key = doc.write_to_string ();
+
+	/* Examination also sets things up using some details of the film and some defaults
+	   from the configuration (e.g. still image lengths, audio mappings and scales) so
+	   these must be the same for an entry to be used.
+	*/
+	Ratio const * scale_to = Config::instance()->default_scale_to ();
+	key += String::compose (
+		"\n%1 %2 %3 %4",
+		film ? film->video_frame_rate() : 0,
+		(film && film->audio_processor()) ? film->audio_processor()->id() : "none",
+		Config::instance()->default_still_length(),
+		scale_to ? scale_to->id() : "none"
+		);
+
+	try {
+		BOOST_FOREACH (boost::filesystem::path i, content->paths()) {
+			add_signature (key, i);
+			if (boost::filesystem::is_directory (i)) {
+				/* e.g. a DCP; the files inside matter too */
+				for (boost::filesystem::directory_iterator j = boost::filesystem::directory_iterator(i); j != boost::filesystem::directory_iterator(); ++j) {
+					add_signature (key, j->path());
+				}
+			}
+		}
+	} catch (boost::filesystem::filesystem_error& e) {
+		return optional<string> ();
+	}
+
+	return key;
+}
+
+/** @return Examined content for key, or 0 if there is none in the cache */
+shared_ptr<Content>
+ExaminationCache::get (string key)
+{
+	string xml;
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		map<string, Entry>::iterator i = _entries.find (key);
+		if (i == _entries.end()) {
+			return shared_ptr<Content> ();
+		}
+		i->second.last_used = ++_uses;
+		xml = i->second.content;
+	}
+
+	try {
+		shared_ptr<cxml::Document> doc (new cxml::Document ("Content"));
+		doc->read_string (xml);
+		list<string> notes;
+		return content_factory (doc, Film::current_state_version, notes);
+	} catch (std::exception& e) {
+		LOG_GENERAL ("Could not use cached examination (%1)", e.what());
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	_entries.erase (key);
+	return shared_ptr<Content> ();
+}
+
+/** Add the results of an examination to the cache.  The cache is not written to disk
+ *  until write() is called.
+ *  @param key Key obtained from key() before the content was examined.
+ *  @param examined Content after examination.
+ */
+void
+ExaminationCache::add (string key, shared_ptr<const Content> examined)
+{
+	xmlpp::Document doc;
+	examined->as_xml (doc.create_root_node ("Content"), true);
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	Entry& e = _entries[key];
+	e.content = doc.write_to_string ();
+	e.last_used = ++_uses;
+
+	if (_entries.size() > _max_entries) {
+		/* Throw away the least recently used entries */
+		vector<pair<int64_t, string> > by_use;
+		for (map<string, Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+			by_use.push_back (make_pair (i->second.last_used, i->first));
+		}
+		sort (by_use.begin(), by_use.end());
+		size_t const to_remove = _entries.size() - _max_entries + _max_entries / 8;
+		for (size_t i = 0; i < to_remove; ++i) {
+			_entries.erase (by_use[i].second);
+		}
+	}
+}
+
+/** Write the cache to disk.  This may be called from more than one thread at once. */
+void
+ExaminationCache::write () const
+{
+	/* Take a copy of the entries and write it out while holding _write_mutex, so that
+	   an older copy can never be written over a newer one.
+	*/
+	boost::mutex::scoped_lock wm (_write_mutex);
+
+	xmlpp::Document doc;
+	xmlpp::Element* root = doc.create_root_node ("ExaminationCache");
+
+	root->add_child("Version")->add_child_text(raw_convert<string>(_current_version));
+	root->add_child("StateVersion")->add_child_text(raw_convert<string>(Film::current_state_version));
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		for (map<string, Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+			xmlpp::Element* e = root->add_child ("Entry");
+			e->add_child("Key")->add_child_text (i->first);
+			e->add_child("Content")->add_child_text (i->second.content);
+			e->add_child("LastUsed")->add_child_text (raw_convert<string> (i->second.last_used));
+		}
+	}
+
+	boost::filesystem::path const file = path ("examination_cache.xml");
+	boost::filesystem::path tmp = file;
+	tmp += ".tmp";
+
+	try {
+		doc.write_to_file (tmp.string());
+		boost::filesystem::rename (tmp, file);
+	} catch (xmlpp::exception& e) {
+		string s = e.what ();
+		trim (s);
+		throw FileError (s, file);
+	}
+}
+
+void
+ExaminationCache::read ()
+try
+{
+	cxml::Document f ("ExaminationCache");
+	f.read_file (path("examination_cache.xml"));
+	if (f.number_child<int>("Version") != _current_version || f.number_child<int>("StateVersion") != Film::current_state_version) {
+		/* The cache's format or the content XML may have changed; start again */
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	BOOST_FOREACH (cxml::ConstNodePtr i, f.node_children("Entry")) {
+		Entry e;
+		e.content = i->string_child ("Content");
+		e.last_used = i->number_child<int64_t> ("LastUsed");
+		_uses = std::max (_uses, e.last_used);
+		_entries[i->string_child("Key")] = e;
+	}
+} catch (...) {
+	/* Never mind */
+}
+
+ExaminationCache*
+ExaminationCache::instance ()
+{
+	boost::mutex::scoped_lock lm (_instance_mutex);
+	if (!_instance) {
+		_instance = new ExaminationCache ();
+		_instance->read ();
+	}
+
+	return _instance;
+}
@@ -0,0 +1,90 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/examination_cache.h
+ *  @brief ExaminationCache class.
+ */
+
+#ifndef DCPOMATIC_EXAMINATION_CACHE_H
+#define DCPOMATIC_EXAMINATION_CACHE_H
+
+#include "state.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/optional.hpp>
+#include <map>
+#include <string>
+
+class Content;
+class Film;
+
+/** @class ExaminationCache
+ *  @brief A user-wide store of the results of examining content.
+ *
+ *  Entries are keyed on the state of a piece of content before it is examined
+ *  (which includes its paths), the sizes and modification times of its files and
+ *  the film and configuration settings that examination uses, so an entry is only
+ *  used when examining again would give the same answer.
+ */
+class ExaminationCache : public State
+{
+public:
+	ExaminationCache ();
+
+	static boost::optional<std::string> key (boost::shared_ptr<const Film> film, boost::shared_ptr<const Content> content);
+
+	boost::shared_ptr<Content> get (std::string key);
+	void add (std::string key, boost::shared_ptr<const Content> examined);
+
+	void read ();
+	void write () const;
+
+	static ExaminationCache* instance ();
+
+private:
+	struct Entry
+	{
+		Entry ()
+			: last_used (0)
+		{}
+
+		/** Content XML, as written by Content::as_xml */
+		std::string content;
+		/** Value of _uses when this entry was last used */
+		int64_t last_used;
+	};
+
+	/** Mutex for _entries and _uses */
+	mutable boost::mutex _mutex;
+	std::map<std::string, Entry> _entries;
+	/** Mutex held while writing the cache to disk */
+	mutable boost::mutex _write_mutex;
+	/** Number of gets and adds that have been made, used to find the least recently used entries */
+	int64_t _uses;
+
+	static ExaminationCache* _instance;
+	/** Mutex for _instance, as instance() may be called from more than one thread at once */
+	static boost::mutex _instance_mutex;
+	static int const _current_version;
+	/** Maximum number of entries to keep */
+	static size_t const _max_entries;
+};
+
+#endif
@@ -23,19 +23,61 @@
 #include "log.h"
 #include "content.h"
 #include "film.h"
+#include "dcpomatic_assert.h"
+#include "examination_cache.h"
+#include "exceptions.h"
+#include "dcpomatic_log.h"
+#include "compose.hpp"
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
+#include <set>
 
 #include "i18n.h"
 
 using std::string;
 using std::cout;
+using std::map;
+using std::min;
+using std::max;
+using std::list;
+using std::vector;
+using std::set;
 using boost::shared_ptr;
+using boost::optional;
+using boost::bind;
+
+/** Maximum number of pieces of content to examine at once.  Examination is mostly
+ *  reading from disk, so more threads than this tend to make the disk seek rather
+ *  than make things faster.
+ */
+static size_t const max_batch_threads = 4;
 
 ExamineContentJob::ExamineContentJob (shared_ptr<const Film> film, shared_ptr<Content> c)
 	: Job (film)
-	, _content (c)
+	, _batch (false)
+	, _cache (0)
+	, _next (0)
+	, _done (0)
+	, _failed (false)
 {
+	_content.push_back (c);
+}
 
+/** Construct a job to examine a batch of content, several pieces at a time.  Content
+ *  which has been examined before may be taken from the ExaminationCache rather than
+ *  being examined again.
+ */
+ExamineContentJob::ExamineContentJob (shared_ptr<const Film> film, ContentList c)
+	: Job (film)
+	, _content (c)
+	, _batch (true)
+	, _cache (0)
+	, _next (0)
+	, _done (0)
+	, _failed (false)
+{
+	DCPOMATIC_ASSERT (!_content.empty());
 }
 
 ExamineContentJob::~ExamineContentJob ()
@@ -58,7 +100,178 @@ ExamineContentJob::json_name () const
 void
 ExamineContentJob::run ()
 {
-	_content->examine (_film, shared_from_this());
+	if (_batch) {
+		examine_batch ();
+	} else {
+		_content.front()->examine (_film, shared_from_this());
+	}
+
 	set_progress (1);
 	set_state (FINISHED_OK);
 }
+
+void
+ExamineContentJob::examine_batch ()
+{
+	/* Only examine one of each set of identical pieces of content; followers maps
+	   the index of each of the others to the index of the one that is examined.
+	*/
+	map<string, size_t> keys;
+	map<size_t, size_t> followers;
+	for (size_t i = 0; i < _content.size(); ++i) {
+		optional<string> const k = ExaminationCache::key (_film, _content[i]);
+		map<string, size_t>::const_iterator j = k ? keys.find (*k) : keys.end();
+		if (j == keys.end()) {
+			if (k) {
+				keys[*k] = i;
+			}
+			_leaders.push_back (i);
+			_leader_keys.push_back (k);
+		} else {
+			followers[i] = j->second;
+		}
+	}
+
+	_cache = ExaminationCache::instance ();
+
+	size_t const threads = min (_leaders.size(), max (size_t (1), min (max_batch_threads, size_t (boost::thread::hardware_concurrency()))));
+
+	list<boost::thread*> workers;
+	for (size_t i = 0; i < threads; ++i) {
+		boost::thread* t = new boost::thread (bind (&ExamineContentJob::batch_thread, this));
+#ifdef DCPOMATIC_LINUX
+		pthread_setname_np (t->native_handle(), "examine-content");
+#endif
+		workers.push_back (t);
+	}
+
+	try {
+		BOOST_FOREACH (boost::thread* i, workers) {
+			i->join ();
+		}
+	} catch (boost::thread_interrupted &) {
+		/* We have been cancelled; stop the workers before we go away */
+		BOOST_FOREACH (boost::thread* i, workers) {
+			i->interrupt ();
+			i->join ();
+			delete i;
+		}
+		throw;
+	}
+
+	BOOST_FOREACH (boost::thread* i, workers) {
+		delete i;
+	}
+
+	if (_failed || _failures.size() == _leaders.size()) {
+		/* Something went badly wrong, or nothing could be examined; report the problem as the job's error */
+		rethrow ();
+	}
+
+	try {
+		_cache->write ();
+	} catch (FileError& e) {
+		LOG_WARNING ("Could not write examination cache (%1)", e.what());
+	}
+
+	/* Copy the results to duplicates of content that was examined successfully, and
+	   drop duplicates of content that failed.
+	*/
+	set<size_t> failed;
+	for (map<size_t, string>::const_iterator i = _failures.begin(); i != _failures.end(); ++i) {
+		failed.insert (i->first);
+	}
+
+	for (map<size_t, size_t>::const_iterator i = followers.begin(); i != followers.end(); ++i) {
+		if (failed.find(i->second) == failed.end()) {
+			_content[i->first] = _content[i->second]->clone ();
+		} else {
+			failed.insert (i->first);
+		}
+	}
+
+	if (!_failures.empty ()) {
+		/* Keep the content that could be examined and tell the user about the rest */
+		ContentList ok;
+		for (size_t i = 0; i < _content.size(); ++i) {
+			if (failed.find(i) == failed.end()) {
+				ok.push_back (_content[i]);
+			}
+		}
+		_content = ok;
+
+		string message = _("Some files could not be examined and have not been added:");
+		for (map<size_t, string>::const_iterator i = _failures.begin(); i != _failures.end(); ++i) {
+			message += "\n" + i->second;
+		}
+		set_message (message);
+	}
+}
+
+void
+ExamineContentJob::batch_thread ()
+try
+{
+	while (true) {
+		/* Examiners check for interruption too, so a cancel stops us part-way through a piece of content */
+		boost::this_thread::interruption_point ();
+
+		size_t index;
+		shared_ptr<Content> content;
+		optional<string> key;
+		{
+			boost::mutex::scoped_lock lm (_batch_mutex);
+			if (_failed || _next == _leaders.size()) {
+				return;
+			}
+			index = _leaders[_next];
+			content = _content[index];
+			key = _leader_keys[_next];
+			++_next;
+		}
+
+		shared_ptr<Content> cached;
+		if (key) {
+			cached = _cache->get (*key);
+		}
+
+		if (cached) {
+			boost::mutex::scoped_lock lm (_batch_mutex);
+			_content[index] = cached;
+		} else {
+			/* Each piece of content succeeds or fails on its own.  We don't pass this job
+			   to examine() as the examiners would report progress and sub-names from
+			   several threads at once; progress is reported per piece of content below.
+			*/
+			try {
+				content->examine (_film, shared_ptr<Job> ());
+				if (key) {
+					_cache->add (*key, content);
+				}
+			} catch (std::exception& e) {
+				string const path = content->paths().empty() ? content->summary() : content->path(0).string();
+				store_current ();
+				boost::mutex::scoped_lock lm (_batch_mutex);
+				_failures[index] = String::compose ("%1: %2", path, e.what());
+			}
+		}
+
+		size_t done;
+		{
+			boost::mutex::scoped_lock lm (_batch_mutex);
+			done = ++_done;
+		}
+
+		set_progress (float (done) / _leaders.size());
+	}
+}
+catch (boost::thread_interrupted &)
+{
+	/* The job was cancelled */
+}
+catch (...)
+{
+	store_current ();
+	boost::mutex::scoped_lock lm (_batch_mutex);
+	_failed = true;
+}
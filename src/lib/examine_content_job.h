@@ -19,24 +19,68 @@
 */
 
 #include "job.h"
+#include "types.h"
+#include "exception_store.h"
 #include <boost/shared_ptr.hpp>
+#include <boost/optional.hpp>
+#include <map>
 
 class Content;
+class ExaminationCache;
 
-class ExamineContentJob : public Job
+class ExamineContentJob : public Job, public ExceptionStore
 {
 public:
 	ExamineContentJob (boost::shared_ptr<const Film>, boost::shared_ptr<Content>);
+	ExamineContentJob (boost::shared_ptr<const Film>, ContentList);
 	~ExamineContentJob ();
 
 	std::string name () const;
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_DISK;
+	}
+
+	/** @return First (or only) piece of content that this job examines */
 	boost::shared_ptr<Content> content () const {
+		return _content.front ();
+	}
+
+	/** @return All the content that this job examines.  After a batch job has run,
+	 *  pieces of content which were found in the ExaminationCache, or which were
+	 *  duplicates of others in the batch, will have been replaced by copies.
+	 */
+	ContentList all_content () const {
 		return _content;
 	}
 
 private:
-	boost::shared_ptr<Content> _content;
+	void examine_batch ();
+	void batch_thread ();
+
+	ContentList _content;
+	/** true to examine _content using examine_batch() */
+	bool _batch;
+	ExaminationCache* _cache;
+
+	/** Mutex for _next, _done, _failures and _failed */
+	boost::mutex _batch_mutex;
+	/** Indices into _content of the content that must actually be examined */
+	std::vector<size_t> _leaders;
+	/** ExaminationCache keys for each of _leaders, if they could be found */
+	std::vector<boost::optional<std::string> > _leader_keys;
+	/** Next index into _leaders for a batch_thread to examine */
+	size_t _next;
+	/** Number of _leaders that have been examined */
+	size_t _done;
+	/** Descriptions of problems with content that could not be examined, indexed by
+	 *  their indices into _content.
+	 */
+	std::map<size_t, std::string> _failures;
+	/** true if a batch_thread has thrown an exception which was not to do with a
+	 *  particular piece of content.
+	 */
+	bool _failed;
 };
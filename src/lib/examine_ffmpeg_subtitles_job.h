@@ -34,6 +34,10 @@ public:
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_DISK;
+	}
+
 private:
 	boost::shared_ptr<FFmpegContent> _content;
 };
@@ -261,7 +261,9 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 	ChangeSignaller<Content> cc1 (this, FFmpegContentProperty::SUBTITLE_STREAMS);
 	ChangeSignaller<Content> cc2 (this, FFmpegContentProperty::SUBTITLE_STREAM);
 
-	job->set_progress_unknown ();
+	if (job) {
+		job->set_progress_unknown ();
+	}
 
 	Content::examine (film, job);
 
@@ -697,4 +699,5 @@ FFmpegContent::take_settings_from (shared_ptr<const Content> c)
 
 	Content::take_settings_from (c);
 	_filters = fc->_filters;
+	invalidate_xml_cache ();
 }
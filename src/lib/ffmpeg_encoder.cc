@@ -27,7 +27,9 @@
 #include "image.h"
 #include "cross.h"
 #include "butler.h"
+#include "audio_buffers.h"
 #include "compose.hpp"
+#include <boost/foreach.hpp>
 #include <iostream>
 
 #include "i18n.h"
@@ -38,6 +40,8 @@ using std::cout;
 using std::pair;
 using std::list;
 using std::map;
+using std::min;
+using std::max;
 using boost::shared_ptr;
 using boost::bind;
 using boost::weak_ptr;
@@ -55,6 +59,10 @@ FFmpegEncoder::FFmpegEncoder (
 	int x264_crf
 	)
 	: Encoder (film, job)
+	, _format (format)
+	, _max_segment_threads (max (1, int (boost::thread::hardware_concurrency() / 4)))
+	, _frames_done (0)
+	, _failed (false)
 	, _history (1000)
 {
 	_player->set_always_burn_open_subtitles ();
@@ -62,7 +70,7 @@ FFmpegEncoder::FFmpegEncoder (
 
 	int const ch = film->audio_channels ();
 
-	AudioMapping map;
+	AudioMapping& map = _audio_map;
 	if (mixdown_to_stereo) {
 		_output_audio_channels = 2;
 		map = AudioMapping (ch, 2);
@@ -93,10 +101,16 @@ FFmpegEncoder::FFmpegEncoder (
 		}
 	}
 
-	_butler.reset (new Butler(_player, map, _output_audio_channels, bind(&PlayerVideo::force, _1, FFmpegFileEncoder::pixel_format(format)), true, false));
+	list<DCPTimePeriod> periods;
+	if (split_reels) {
+		periods = film->reels ();
+	} else {
+		periods.push_back (DCPTimePeriod (DCPTime(), film->length()));
+	}
 
-	int const files = split_reels ? film->reels().size() : 1;
-	for (int i = 0; i < files; ++i) {
+	int const files = periods.size ();
+	int i = 0;
+	BOOST_FOREACH (DCPTimePeriod period, periods) {
 
 		boost::filesystem::path filename = output;
 		string extension = boost::filesystem::extension (filename);
@@ -108,22 +122,42 @@ FFmpegEncoder::FFmpegEncoder (
 			filename = filename.string() + String::compose(_("_reel%1"), i + 1);
 		}
 
-		_file_encoders.push_back (
-			FileEncoderSet (
-				_film->frame_size(),
-				_film->video_frame_rate(),
-				_film->audio_frame_rate(),
-				_output_audio_channels,
-				format,
-				x264_crf,
-				_film->three_d(),
-				filename,
-				extension
+		_segments.push_back (
+			Segment (
+				period,
+				FileEncoderSet (
+					_film->frame_size(),
+					_film->video_frame_rate(),
+					_film->audio_frame_rate(),
+					_output_audio_channels,
+					format,
+					x264_crf,
+					_film->three_d(),
+					filename,
+					extension
+					)
 				)
 			);
+
+		++i;
 	}
 }
 
+shared_ptr<Butler>
+FFmpegEncoder::make_butler (shared_ptr<Player> player) const
+{
+	return shared_ptr<Butler> (
+		new Butler(player, _audio_map, _output_audio_channels, bind(&PlayerVideo::force, _1, FFmpegFileEncoder::pixel_format(_format)), true, false)
+		);
+}
+
+/** @return Number of segments that we should encode at the same time */
+int
+FFmpegEncoder::segment_threads () const
+{
+	return max (1, min (int (_segments.size()), _max_segment_threads));
+}
+
 void
 FFmpegEncoder::go ()
 {
@@ -133,34 +167,120 @@ FFmpegEncoder::go ()
 		job->sub (_("Encoding"));
 	}
 
+	int const threads = segment_threads ();
+	if (threads > 1) {
+		go_parallel (threads);
+		return;
+	}
+
 	Waker waker;
 
-	list<DCPTimePeriod> reel_periods = _film->reels ();
-	list<DCPTimePeriod>::const_iterator reel = reel_periods.begin ();
-	list<FileEncoderSet>::iterator encoder = _file_encoders.begin ();
+	shared_ptr<Butler> butler = make_butler (_player);
+	BOOST_FOREACH (Segment& i, _segments) {
+		encode (butler, i);
+		waker.nudge ();
+	}
+
+	butler->rethrow ();
+}
+
+/** Encode each segment (reel) from its own player and butler, running up to
+ *  `threads' segments at once.
+ */
+void
+FFmpegEncoder::go_parallel (int threads)
+{
+	Waker waker;
+
+	_next_segment = _segments.begin ();
+
+	list<boost::thread*> workers;
+	for (int i = 0; i < threads; ++i) {
+		boost::thread* t = new boost::thread (bind (&FFmpegEncoder::segment_thread, this));
+#ifdef DCPOMATIC_LINUX
+		pthread_setname_np (t->native_handle(), "ffmpeg-segment");
+#endif
+		workers.push_back (t);
+	}
+
+	try {
+		BOOST_FOREACH (boost::thread* i, workers) {
+			while (!i->timed_join (boost::posix_time::seconds (1))) {
+				waker.nudge ();
+			}
+		}
+	} catch (boost::thread_interrupted &) {
+		/* We have been cancelled; stop the segment threads before we go away */
+		BOOST_FOREACH (boost::thread* i, workers) {
+			i->interrupt ();
+			i->join ();
+			delete i;
+		}
+		throw;
+	}
+
+	BOOST_FOREACH (boost::thread* i, workers) {
+		delete i;
+	}
+
+	rethrow ();
+}
 
+void
+FFmpegEncoder::segment_thread ()
+try
+{
+	while (true) {
+		list<Segment>::iterator segment;
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			if (_failed || _next_segment == _segments.end()) {
+				return;
+			}
+			segment = _next_segment++;
+		}
+
+		shared_ptr<Player> player (new Player (_film, _film->playlist ()));
+		player->set_always_burn_open_subtitles ();
+		player->set_play_referenced ();
+
+		shared_ptr<Butler> butler = make_butler (player);
+		butler->seek (segment->period.from, true);
+		encode (butler, *segment);
+		butler->rethrow ();
+	}
+}
+catch (boost::thread_interrupted &)
+{
+	/* The job was cancelled */
+}
+catch (...)
+{
+	store_current ();
+	boost::mutex::scoped_lock lm (_mutex);
+	_failed = true;
+}
+
+/** Pass the video and audio for segment's period from butler to the segment's
+ *  file encoders, then flush them.  butler must already be at the start of the period.
+ */
+void
+FFmpegEncoder::encode (shared_ptr<Butler> butler, Segment& segment)
+{
 	DCPTime const video_frame = DCPTime::from_frames (1, _film->video_frame_rate ());
 	int const audio_frames = video_frame.frames_round(_film->audio_frame_rate());
-	float* interleaved = new float[_output_audio_channels * audio_frames];
-	shared_ptr<AudioBuffers> deinterleaved (new AudioBuffers (_output_audio_channels, audio_frames));
 	int const gets_per_frame = _film->three_d() ? 2 : 1;
-	for (DCPTime i; i < _film->length(); i += video_frame) {
-
-		if (_file_encoders.size() > 1 && !reel->contains(i)) {
-			/* Next reel and file */
-			++reel;
-			++encoder;
-			DCPOMATIC_ASSERT (reel != reel_periods.end());
-			DCPOMATIC_ASSERT (encoder != _file_encoders.end());
-		}
+	Frame const total = _film->length().frames_round (_film->video_frame_rate ());
+
+	for (DCPTime i = segment.period.from; i < segment.period.to; i += video_frame) {
 
 		for (int j = 0; j < gets_per_frame; ++j) {
 			Butler::Error e;
-			pair<shared_ptr<PlayerVideo>, DCPTime> v = _butler->get_video (&e);
+			pair<shared_ptr<PlayerVideo>, DCPTime> v = butler->get_video (&e);
 			if (!v.first) {
 				throw ProgrammingError(__FILE__, __LINE__, String::compose("butler returned no video; error was %1", static_cast<int>(e)));
 			}
-			shared_ptr<FFmpegFileEncoder> fe = encoder->get (v.first->eyes());
+			shared_ptr<FFmpegFileEncoder> fe = segment.encoders.get (v.first->eyes());
 			if (fe) {
 				fe->video(v.first, v.second);
 			}
@@ -168,35 +288,24 @@ FFmpegEncoder::go ()
 
 		_history.event ();
 
+		Frame done;
 		{
 			boost::mutex::scoped_lock lm (_mutex);
-			_last_time = i;
+			done = ++_frames_done;
 		}
 
 		shared_ptr<Job> job = _job.lock ();
-		if (job) {
-			job->set_progress (float(i.get()) / _film->length().get());
+		if (job && total > 0) {
+			job->set_progress (float(done) / total);
 		}
 
-		waker.nudge ();
-
-		_butler->get_audio (interleaved, audio_frames);
-		/* XXX: inefficient; butler interleaves and we deinterleave again */
-		float* p = interleaved;
-		for (int j = 0; j < audio_frames; ++j) {
-			for (int k = 0; k < _output_audio_channels; ++k) {
-				deinterleaved->data(k)[j] = *p++;
-			}
-		}
-		encoder->audio (deinterleaved);
-	}
-	delete[] interleaved;
-
-	BOOST_FOREACH (FileEncoderSet i, _file_encoders) {
-		i.flush ();
+		/* The file encoders hang on to this until they have encoded it, so it must be a new one each time */
+		shared_ptr<AudioBuffers> audio (new AudioBuffers (_output_audio_channels, audio_frames));
+		butler->get_audio (audio);
+		segment.encoders.audio (audio);
 	}
 
-	_butler->rethrow ();
+	segment.encoders.flush ();
 }
 
 float
@@ -209,7 +318,7 @@ Frame
 FFmpegEncoder::frames_done () const
 {
 	boost::mutex::scoped_lock lm (_mutex);
-	return _last_time.frames_round (_film->video_frame_rate ());
+	return _frames_done;
 }
 
 FFmpegEncoder::FileEncoderSet::FileEncoderSet (
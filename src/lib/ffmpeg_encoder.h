@@ -25,10 +25,11 @@
 #include "event_history.h"
 #include "audio_mapping.h"
 #include "ffmpeg_file_encoder.h"
+#include "exception_store.h"
 
 class Butler;
 
-class FFmpegEncoder : public Encoder
+class FFmpegEncoder : public Encoder, public ExceptionStore
 {
 public:
 	FFmpegEncoder (
@@ -49,7 +50,13 @@ public:
 		return false;
 	}
 
+	/** Set the most segments (reels) that we will encode at the same time */
+	void set_max_segment_threads (int threads) {
+		_max_segment_threads = threads;
+	}
+
 private:
+	friend struct ffmpeg_encoder_h264_test8;
 
 	class FileEncoderSet
 	{
@@ -74,15 +81,44 @@ private:
 		std::map<Eyes, boost::shared_ptr<FFmpegFileEncoder> > _encoders;
 	};
 
-	std::list<FileEncoderSet> _file_encoders;
-	int _output_audio_channels;
+	/** A part of the film which is written to its own set of files */
+	struct Segment
+	{
+		Segment (DCPTimePeriod p, FileEncoderSet e)
+			: period (p)
+			, encoders (e)
+		{}
 
+		DCPTimePeriod period;
+		FileEncoderSet encoders;
+	};
+
+	boost::shared_ptr<Butler> make_butler (boost::shared_ptr<Player> player) const;
+	void encode (boost::shared_ptr<Butler> butler, Segment& segment);
+	void go_parallel (int threads);
+	void segment_thread ();
+	int segment_threads () const;
+
+	std::list<Segment> _segments;
+	int _output_audio_channels;
+	AudioMapping _audio_map;
+	ExportFormat _format;
+	/** Most segments to encode at the same time.  Each segment has its own player, butler
+	 *  and pair of FFmpeg encode/mux threads, and the FFmpeg codecs are themselves threaded,
+	 *  so by default we only give each one a share of the machine.
+	 */
+	int _max_segment_threads;
+
+	/** Mutex for _frames_done, _next_segment and _failed */
 	mutable boost::mutex _mutex;
-	DCPTime _last_time;
+	/** Number of video frames that have been passed to the file encoders */
+	Frame _frames_done;
+	/** Next segment for a segment_thread to take */
+	std::list<Segment>::iterator _next_segment;
+	/** true if a segment_thread has thrown an exception */
+	bool _failed;
 
 	EventHistory _history;
-
-	boost::shared_ptr<Butler> _butler;
 };
 
 #endif
@@ -34,6 +34,7 @@ extern "C" {
 #include "ffmpeg_subtitle_stream.h"
 #include "util.h"
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
 
 #include "i18n.h"
@@ -99,39 +100,36 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		_need_video_length = _format_context->duration == AV_NOPTS_VALUE;
 		if (!_need_video_length) {
 			_video_length = llrint ((double (_format_context->duration) / AV_TIME_BASE) * video_frame_rate().get());
+		} else {
+			/* Perhaps the container's index for the video stream knows */
+			optional<Frame> const index = index_video_length ();
+			if (index) {
+				_video_length = *index;
+				_need_video_length = false;
+			}
 		}
 	}
 
-	if (job && _need_video_length) {
-		job->sub (_("Finding length"));
-	}
-
 	/* Run through until we find:
 	 *   - the first video.
 	 *   - the first audio for each stream.
 	 *   - the top-field-first and repeat-first-frame values ("temporal_reference") for the first PULLDOWN_CHECK_FRAMES video frames.
 	 */
 
-	int64_t const len = _file_group.length ();
 	/* A string which we build up to describe the top-field-first and repeat-first-frame values for the first few frames.
 	 * It would be nicer to use something like vector<bool> here but we want to search the array for a pattern later,
 	 * and a string seems a reasonably neat way to do that.
 	 */
 	string temporal_reference;
 	while (true) {
+		/* We may be examining without a job, so check for cancellation ourselves */
+		boost::this_thread::interruption_point ();
+
 		int r = av_read_frame (_format_context, &_packet);
 		if (r < 0) {
 			break;
 		}
 
-		if (job) {
-			if (len > 0) {
-				job->set_progress (float (_format_context->pb->pos) / len);
-			} else {
-				job->set_progress_unknown ();
-			}
-		}
-
 		AVCodecContext* context = _format_context->streams[_packet.stream_index]->codec;
 
 		if (_video_stream && _packet.stream_index == _video_stream.get()) {
@@ -157,6 +155,19 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		}
 	}
 
+	if (_need_video_length) {
+		/* Try looking at the last few packets in the file, and only
+		   fall back to reading all of it if that doesn't work.
+		*/
+		optional<Frame> const end = end_video_length ();
+		if (end) {
+			_video_length = *end;
+		} else {
+			scan_video_length (job);
+		}
+		_need_video_length = false;
+	}
+
 	if (_video_stream) {
 		/* This code taken from get_rotation() in ffmpeg:cmdutils.c */
 		AVStream* stream = _format_context->streams[*_video_stream];
@@ -204,7 +215,7 @@ FFmpegExaminer::video_packet (AVCodecContext* context, string& temporal_referenc
 {
 	DCPOMATIC_ASSERT (_video_stream);
 
-	if (_first_video && !_need_video_length && temporal_reference.size() >= (PULLDOWN_CHECK_FRAMES * 2)) {
+	if (_first_video && temporal_reference.size() >= (PULLDOWN_CHECK_FRAMES * 2)) {
 		return;
 	}
 
@@ -213,11 +224,6 @@ FFmpegExaminer::video_packet (AVCodecContext* context, string& temporal_referenc
 		if (!_first_video) {
 			_first_video = frame_time (_format_context->streams[_video_stream.get()]);
 		}
-		if (_need_video_length) {
-			_video_length = frame_time (
-				_format_context->streams[_video_stream.get()]
-				).get_value_or (ContentTime ()).frames_round (video_frame_rate().get ());
-		}
 		if (temporal_reference.size() < (PULLDOWN_CHECK_FRAMES * 2)) {
 			temporal_reference += (_frame->top_field_first ? "T" : "B");
 			temporal_reference += (_frame->repeat_pict ? "3" : "2");
@@ -225,6 +231,121 @@ FFmpegExaminer::video_packet (AVCodecContext* context, string& temporal_referenc
 	}
 }
 
+/** @return Video length from the video stream's entry in the container's index, if it has one */
+optional<Frame>
+FFmpegExaminer::index_video_length () const
+{
+	DCPOMATIC_ASSERT (_video_stream);
+	AVStream* s = _format_context->streams[_video_stream.get()];
+
+	if (s->duration != AV_NOPTS_VALUE && s->duration > 0) {
+		return llrint (s->duration * av_q2d(s->time_base) * video_frame_rate().get());
+	}
+
+	if (s->nb_frames > 0) {
+		return s->nb_frames;
+	}
+
+	return optional<Frame> ();
+}
+
+/** Find the video length by seeking to near the end of the file and looking at the
+ *  timestamps of the video packets there.
+ *  @return Video length, or none if the file cannot be seeked by byte or has no
+ *  timestamped video packets near its end.
+ */
+optional<Frame>
+FFmpegExaminer::end_video_length ()
+{
+	DCPOMATIC_ASSERT (_video_stream);
+
+	/* Number of bytes at the end of the file to look at */
+	int64_t const window = 32 * 1024 * 1024;
+
+	int64_t const len = _file_group.length ();
+	if (len <= 0 || av_seek_frame (_format_context, -1, max (int64_t (0), len - window), AVSEEK_FLAG_BYTE) < 0) {
+		return optional<Frame> ();
+	}
+
+	optional<ContentTime> last;
+	while (av_read_frame (_format_context, &_packet) >= 0) {
+		if (_packet.stream_index == _video_stream.get()) {
+			optional<ContentTime> t = packet_time (_format_context->streams[_video_stream.get()]);
+			if (t && (!last || *t > *last)) {
+				last = t;
+			}
+		}
+		av_packet_unref (&_packet);
+	}
+
+	if (!last) {
+		return optional<Frame> ();
+	}
+
+	return length_to (*last);
+}
+
+/** Find the video length by reading every packet in the file; this does not decode anything,
+ *  but it is still slow for big files so it is only used if nothing else works.
+ */
+void
+FFmpegExaminer::scan_video_length (shared_ptr<Job> job)
+{
+	DCPOMATIC_ASSERT (_video_stream);
+
+	if (job) {
+		job->sub (_("Finding length"));
+	}
+
+	/* Go back to the start if we can; if not, we are still where the first scan left us */
+	av_seek_frame (_format_context, -1, 0, AVSEEK_FLAG_BYTE);
+
+	int64_t const len = _file_group.length ();
+	optional<ContentTime> last;
+	while (av_read_frame (_format_context, &_packet) >= 0) {
+		if (job) {
+			if (len > 0) {
+				job->set_progress (float (_format_context->pb->pos) / len);
+			} else {
+				job->set_progress_unknown ();
+			}
+		}
+
+		if (_packet.stream_index == _video_stream.get()) {
+			optional<ContentTime> t = packet_time (_format_context->streams[_video_stream.get()]);
+			if (t && (!last || *t > *last)) {
+				last = t;
+			}
+		}
+		av_packet_unref (&_packet);
+		boost::this_thread::interruption_point ();
+	}
+
+	_video_length = last ? length_to (*last) : 0;
+}
+
+/** @param last Time of the last video packet in the file.
+ *  @return Video length in frames, counting from the first video frame (which need not be at 0)
+ *  up to and including the frame at last.
+ */
+Frame
+FFmpegExaminer::length_to (ContentTime last) const
+{
+	DCPOMATIC_ASSERT (_video_stream);
+
+	ContentTime first;
+	if (_first_video) {
+		first = *_first_video;
+	} else {
+		AVStream* s = _format_context->streams[_video_stream.get()];
+		if (s->start_time != AV_NOPTS_VALUE) {
+			first = ContentTime::from_seconds (s->start_time * av_q2d (s->time_base));
+		}
+	}
+
+	return max (ContentTime(), last - first).frames_round (video_frame_rate().get()) + 1;
+}
+
 void
 FFmpegExaminer::audio_packet (AVCodecContext* context, shared_ptr<FFmpegAudioStream> stream)
 {
@@ -251,6 +372,18 @@ FFmpegExaminer::frame_time (AVStream* s) const
 	return t;
 }
 
+/** @return Presentation time of _packet, or its decode time if it has no presentation time */
+optional<ContentTime>
+FFmpegExaminer::packet_time (AVStream* s) const
+{
+	int64_t const t = _packet.pts != AV_NOPTS_VALUE ? _packet.pts : _packet.dts;
+	if (t == AV_NOPTS_VALUE) {
+		return optional<ContentTime> ();
+	}
+
+	return ContentTime::from_seconds (t * av_q2d (s->time_base));
+}
+
 optional<double>
 FFmpegExaminer::video_frame_rate () const
 {
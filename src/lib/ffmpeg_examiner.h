@@ -86,18 +86,26 @@ public:
 #endif
 
 private:
+	friend struct ffmpeg_examiner_length_test;
+
 	void video_packet (AVCodecContext *, std::string& temporal_reference);
 	void audio_packet (AVCodecContext *, boost::shared_ptr<FFmpegAudioStream>);
+	boost::optional<Frame> index_video_length () const;
+	boost::optional<Frame> end_video_length ();
+	void scan_video_length (boost::shared_ptr<Job> job);
+	Frame length_to (ContentTime last) const;
 
 	std::string stream_name (AVStream* s) const;
 	std::string subtitle_stream_name (AVStream* s) const;
 	boost::optional<ContentTime> frame_time (AVStream* s) const;
+	boost::optional<ContentTime> packet_time (AVStream* s) const;
 
 	std::vector<boost::shared_ptr<FFmpegSubtitleStream> > _subtitle_streams;
 	std::vector<boost::shared_ptr<FFmpegAudioStream> > _audio_streams;
 	boost::optional<ContentTime> _first_video;
-	/** Video length, either obtained from the header or derived by running
-	 *  through the whole file.
+	/** Video length, obtained from the header or the container's index, estimated
+	 *  from the timestamps at the end of the file or, failing all those, derived by
+	 *  running through the whole file.
 	 */
 	Frame _video_length;
 	bool _need_video_length;
@@ -27,6 +27,7 @@
 #include "image.h"
 #include "cross.h"
 #include "compose.hpp"
+#include <boost/foreach.hpp>
 #include <iostream>
 
 #include "i18n.h"
@@ -45,6 +46,9 @@ using namespace boost::placeholders;
 int FFmpegFileEncoder::_video_stream_index = 0;
 int FFmpegFileEncoder::_audio_stream_index = 1;
 
+/** Maximum number of video frames and audio blocks to queue up for the encode thread */
+static size_t const max_input = 16;
+
 FFmpegFileEncoder::FFmpegFileEncoder (
 	dcp::Size video_frame_size,
 	int video_frame_rate,
@@ -60,6 +64,9 @@ FFmpegFileEncoder::FFmpegFileEncoder (
 	, _video_frame_size (video_frame_size)
 	, _video_frame_rate (video_frame_rate)
 	, _audio_frame_rate (audio_frame_rate)
+	, _encode_finished (false)
+	, _encode_thread (0)
+	, _mux_thread (0)
 {
 	_pixel_format = pixel_format (format);
 
@@ -69,7 +76,6 @@ FFmpegFileEncoder::FFmpegFileEncoder (
 		_video_codec_name = "prores_ks";
 		_audio_codec_name = "pcm_s16le";
 		av_dict_set (&_video_options, "profile", "3", 0);
-		av_dict_set (&_video_options, "threads", "auto", 0);
 		break;
 	case EXPORT_FORMAT_H264:
 		_sample_format = AV_SAMPLE_FMT_FLTP;
@@ -79,6 +85,9 @@ FFmpegFileEncoder::FFmpegFileEncoder (
 		break;
 	}
 
+	/* Without this libx264 will only use one thread */
+	av_dict_set (&_video_options, "threads", "auto", 0);
+
 	setup_video ();
 	setup_audio ();
 
@@ -123,6 +132,53 @@ FFmpegFileEncoder::FFmpegFileEncoder (
 	}
 
 	_pending_audio.reset (new AudioBuffers(channels, 0));
+
+	_encode_thread = new boost::thread (bind (&FFmpegFileEncoder::encode_thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_encode_thread->native_handle(), "ffmpeg-encode");
+#endif
+	_mux_thread = new boost::thread (bind (&FFmpegFileEncoder::mux_thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_mux_thread->native_handle(), "ffmpeg-mux");
+#endif
+}
+
+FFmpegFileEncoder::~FFmpegFileEncoder ()
+{
+	stop_threads ();
+
+	BOOST_FOREACH (AVPacket* i, _packets) {
+		if (i) {
+			av_packet_free (&i);
+		}
+	}
+}
+
+/** Stop our threads without waiting for them to finish their work */
+void
+FFmpegFileEncoder::stop_threads ()
+{
+	if (_encode_thread) {
+		_encode_thread->interrupt ();
+		try {
+			_encode_thread->join ();
+		} catch (boost::thread_interrupted& e) {
+			/* No problem */
+		}
+		delete _encode_thread;
+		_encode_thread = 0;
+	}
+
+	if (_mux_thread) {
+		_mux_thread->interrupt ();
+		try {
+			_mux_thread->join ();
+		} catch (boost::thread_interrupted& e) {
+			/* No problem */
+		}
+		delete _mux_thread;
+		_mux_thread = 0;
+	}
 }
 
 AVPixelFormat
@@ -162,6 +218,8 @@ FFmpegFileEncoder::setup_video ()
 	_video_codec_context->time_base = (AVRational) { 1, _video_frame_rate };
 	_video_codec_context->pix_fmt = _pixel_format;
 	_video_codec_context->flags |= AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_GLOBAL_HEADER;
+	/* Allow whichever kind of threading the codec can do */
+	_video_codec_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 }
 
 void
@@ -187,8 +245,153 @@ FFmpegFileEncoder::setup_audio ()
 	_audio_codec_context->channels = _audio_channels;
 }
 
+/** Encode everything that has been given to us, finish writing the file and close it */
 void
 FFmpegFileEncoder::flush ()
+{
+	/* Empty input tells the encode thread to flush the encoders and finish */
+	push (shared_ptr<PlayerVideo>(), DCPTime(), shared_ptr<AudioBuffers>());
+
+	_encode_thread->join ();
+	delete _encode_thread;
+	_encode_thread = 0;
+
+	_mux_thread->join ();
+	delete _mux_thread;
+	_mux_thread = 0;
+
+	rethrow ();
+
+	av_write_trailer (_format_context);
+
+	avcodec_close (_video_codec_context);
+	avcodec_close (_audio_codec_context);
+	avio_close (_format_context->pb);
+	avformat_free_context (_format_context);
+}
+
+void
+FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
+{
+	push (video, time, shared_ptr<AudioBuffers>());
+}
+
+/** Called when the player gives us some audio; the caller must not change it after this call */
+void
+FFmpegFileEncoder::audio (shared_ptr<AudioBuffers> audio)
+{
+	push (shared_ptr<PlayerVideo>(), DCPTime(), audio);
+}
+
+/** Queue something for the encode thread, waiting if it has too much to do already */
+void
+FFmpegFileEncoder::push (shared_ptr<PlayerVideo> video, DCPTime time, shared_ptr<AudioBuffers> audio)
+{
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	while (_input.size() >= max_input && !_encode_finished) {
+		_queue_changed.wait (lm);
+	}
+
+	if (_encode_finished) {
+		/* Something went wrong in the encode thread */
+		lm.unlock ();
+		rethrow ();
+		return;
+	}
+
+	_input.push_back (Input (video, time, audio));
+	_queue_changed.notify_all ();
+}
+
+void
+FFmpegFileEncoder::encode_thread ()
+try
+{
+	while (true) {
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		while (_input.empty ()) {
+			_queue_changed.wait (lm);
+		}
+
+		Input input = _input.front ();
+		_input.pop_front ();
+		_queue_changed.notify_all ();
+		lm.unlock ();
+
+		if (input.video) {
+			encode_video (input.video, input.time);
+		} else if (input.audio) {
+			encode_audio (input.audio);
+		} else {
+			encode_flush ();
+			break;
+		}
+	}
+
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	_encode_finished = true;
+	_packets.push_back (0);
+	_queue_changed.notify_all ();
+}
+catch (boost::thread_interrupted &)
+{
+	/* The encode thread is being stopped */
+}
+catch (...)
+{
+	store_current ();
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	_encode_finished = true;
+	_packets.push_back (0);
+	_queue_changed.notify_all ();
+}
+
+/** Write encoded packets to the file */
+void
+FFmpegFileEncoder::mux_thread ()
+try
+{
+	while (true) {
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		while (_packets.empty ()) {
+			_queue_changed.wait (lm);
+		}
+
+		AVPacket* packet = _packets.front ();
+		_packets.pop_front ();
+		lm.unlock ();
+
+		if (!packet) {
+			break;
+		}
+
+		av_interleaved_write_frame (_format_context, packet);
+		av_packet_free (&packet);
+	}
+}
+catch (boost::thread_interrupted &)
+{
+	/* The mux thread is being stopped */
+}
+catch (...)
+{
+	store_current ();
+}
+
+/** Give a copy of an encoded packet to the mux thread */
+void
+FFmpegFileEncoder::mux (AVPacket* packet)
+{
+	AVPacket* copy = av_packet_clone (packet);
+	DCPOMATIC_ASSERT (copy);
+
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	_packets.push_back (copy);
+	_queue_changed.notify_all ();
+}
+
+void
+FFmpegFileEncoder::encode_flush ()
 {
 	if (_pending_audio->frames() > 0) {
 		audio_frame (_pending_audio->frames ());
@@ -207,7 +410,7 @@ FFmpegFileEncoder::flush ()
 		avcodec_encode_video2 (_video_codec_context, &packet, 0, &got_packet);
 		if (got_packet) {
 			packet.stream_index = 0;
-			av_interleaved_write_frame (_format_context, &packet);
+			mux (&packet);
 		} else {
 			flushed_video = true;
 		}
@@ -220,23 +423,16 @@ FFmpegFileEncoder::flush ()
 		avcodec_encode_audio2 (_audio_codec_context, &packet, 0, &got_packet);
 		if (got_packet) {
 			packet.stream_index = 0;
-			av_interleaved_write_frame (_format_context, &packet);
+			mux (&packet);
 		} else {
 			flushed_audio = true;
 		}
 		av_packet_unref (&packet);
 	}
-
-	av_write_trailer (_format_context);
-
-	avcodec_close (_video_codec_context);
-	avcodec_close (_audio_codec_context);
-	avio_close (_format_context->pb);
-	avformat_free_context (_format_context);
 }
 
 void
-FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
+FFmpegFileEncoder::encode_video (shared_ptr<PlayerVideo> video, DCPTime time)
 {
 	shared_ptr<Image> image = video->image (
 		bind (&PlayerVideo::force, _1, _pixel_format),
@@ -278,17 +474,15 @@ FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
 
 	if (got_packet && packet.size) {
 		packet.stream_index = _video_stream_index;
-		av_interleaved_write_frame (_format_context, &packet);
+		mux (&packet);
 		av_packet_unref (&packet);
 	}
 
 	av_frame_free (&frame);
-
 }
 
-/** Called when the player gives us some audio */
 void
-FFmpegFileEncoder::audio (shared_ptr<AudioBuffers> audio)
+FFmpegFileEncoder::encode_audio (shared_ptr<AudioBuffers> audio)
 {
 	_pending_audio->append (audio);
 
@@ -361,7 +555,7 @@ FFmpegFileEncoder::audio_frame (int size)
 
 	if (got_packet && packet.size) {
 		packet.stream_index = _audio_stream_index;
-		av_interleaved_write_frame (_format_context, &packet);
+		mux (&packet);
 		av_packet_unref (&packet);
 	}
 
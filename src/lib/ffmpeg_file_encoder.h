@@ -25,12 +25,21 @@
 #include "event_history.h"
 #include "audio_mapping.h"
 #include "log.h"
+#include "exception_store.h"
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 }
 
-class FFmpegFileEncoder
+/** @class FFmpegFileEncoder
+ *  @brief Encoder for one output file.
+ *
+ *  video() and audio() queue data which is then encoded by one thread and written
+ *  to the file by another.
+ */
+class FFmpegFileEncoder : public ExceptionStore, public boost::noncopyable
 {
 public:
 	FFmpegFileEncoder (
@@ -43,6 +52,8 @@ public:
 		boost::filesystem::path output
 		);
 
+	~FFmpegFileEncoder ();
+
 	void video (boost::shared_ptr<PlayerVideo>, DCPTime);
 	void audio (boost::shared_ptr<AudioBuffers>);
 	void subtitle (PlayerText, DCPTimePeriod);
@@ -55,7 +66,15 @@ private:
 	void setup_video ();
 	void setup_audio ();
 
+	void push (boost::shared_ptr<PlayerVideo> video, DCPTime time, boost::shared_ptr<AudioBuffers> audio);
+	void encode_thread ();
+	void mux_thread ();
+	void encode_video (boost::shared_ptr<PlayerVideo>, DCPTime);
+	void encode_audio (boost::shared_ptr<AudioBuffers>);
+	void encode_flush ();
+	void mux (AVPacket* packet);
 	void audio_frame (int size);
+	void stop_threads ();
 
 	static void buffer_free(void* opaque, uint8_t* data);
 	void buffer_free2(uint8_t* data);
@@ -87,6 +106,33 @@ private:
 	std::map<uint8_t*, boost::shared_ptr<const Image> > _pending_images;
 	boost::mutex _pending_images_mutex;
 
+	/** Something for the encode thread to do; if video and audio are both 0 it means
+	 *  that the encoders should be flushed.
+	 */
+	struct Input
+	{
+		Input (boost::shared_ptr<PlayerVideo> v, DCPTime t, boost::shared_ptr<AudioBuffers> a)
+			: video (v)
+			, time (t)
+			, audio (a)
+		{}
+
+		boost::shared_ptr<PlayerVideo> video;
+		DCPTime time;
+		boost::shared_ptr<AudioBuffers> audio;
+	};
+
+	/** Mutex for _input, _packets and _encode_finished */
+	boost::mutex _queue_mutex;
+	boost::condition _queue_changed;
+	std::list<Input> _input;
+	/** Encoded packets waiting to be written; a 0 means that there will be no more */
+	std::list<AVPacket*> _packets;
+	/** true when the encode thread has finished, either because it was flushed or because of an error */
+	bool _encode_finished;
+	boost::thread* _encode_thread;
+	boost::thread* _mux_thread;
+
 	static int _video_stream_index;
 	static int _audio_stream_index;
 };
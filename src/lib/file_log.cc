@@ -21,37 +21,119 @@
 #include "file_log.h"
 #include "cross.h"
 #include "config.h"
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <cstdio>
 #include <iostream>
 
 using std::cout;
 using std::string;
 using std::max;
+using std::list;
 using boost::shared_ptr;
 
 /** @param file Filename to write log to */
 FileLog::FileLog (boost::filesystem::path file)
 	: _file (file)
+	, _writing (false)
+	, _stop_thread (false)
 {
 	set_types (Config::instance()->log_types());
+	_thread = new boost::thread (boost::bind (&FileLog::thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_thread->native_handle(), "file-log");
+#endif
+}
+
+FileLog::~FileLog ()
+{
+	{
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		_stop_thread = true;
+	}
+
+	/* The thread will write anything that is still queued before it finishes */
+	_summon.notify_all ();
+	_thread->join ();
+	delete _thread;
 }
 
 void
 FileLog::do_log (shared_ptr<const LogEntry> entry)
 {
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	_queue.push_back (entry);
+	lm.unlock ();
+
+	_summon.notify_all ();
+}
+
+void
+FileLog::thread ()
+{
+	while (true) {
+		list<shared_ptr<const LogEntry> > entries;
+
+		{
+			boost::mutex::scoped_lock lm (_queue_mutex);
+			while (_queue.empty() && !_stop_thread) {
+				_summon.wait (lm);
+			}
+
+			if (_queue.empty()) {
+				/* We have been asked to stop and there is nothing left to write */
+				return;
+			}
+
+			entries.swap (_queue);
+			_writing = true;
+		}
+
+		write (entries);
+
+		{
+			boost::mutex::scoped_lock lm (_queue_mutex);
+			_writing = false;
+		}
+
+		_written.notify_all ();
+	}
+}
+
+/** Format some entries and append them to our file with a single write */
+void
+FileLog::write (list<shared_ptr<const LogEntry> > const & entries)
+{
+	string out;
+	BOOST_FOREACH (shared_ptr<const LogEntry> i, entries) {
+		out += i->get() + "\n";
+	}
+
 	FILE* f = fopen_boost (_file, "a");
 	if (!f) {
-		cout << "(could not log to " << _file.string() << "): " << entry.get() << "\n";
+		cout << "(could not log to " << _file.string() << "): " << out;
 		return;
 	}
 
-	fprintf (f, "%s\n", entry->get().c_str ());
+	fwrite (out.c_str(), 1, out.length(), f);
 	fclose (f);
 }
 
+/** Wait until everything that has been logged so far has been written to the file */
+void
+FileLog::flush () const
+{
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	while (!_queue.empty() || _writing) {
+		_written.wait (lm);
+	}
+}
+
 string
 FileLog::head_and_tail (int amount) const
 {
+	flush ();
+
 	boost::mutex::scoped_lock lm (_mutex);
 
 	uintmax_t head_amount = amount;
@@ -19,17 +19,44 @@
 */
 
 #include "log.h"
-
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <list>
+
+/** @class FileLog
+ *  @brief A Log which writes to a file.
+ *
+ *  Entries are queued by do_log() and then formatted and appended to the file
+ *  in batches by a background thread, so that logging does not block the caller
+ *  on file I/O.
+ */
 class FileLog : public Log
 {
 public:
 	explicit FileLog (boost::filesystem::path file);
+	~FileLog ();
 
 	std::string head_and_tail (int amount = 1024) const;
+	void flush () const;
 
 private:
 	void do_log (boost::shared_ptr<const LogEntry> entry);
+	void thread ();
+	void write (std::list<boost::shared_ptr<const LogEntry> > const & entries);
 
 	/** filename to write to */
 	boost::filesystem::path _file;
+
+	/** mutex to protect _queue, _writing and _stop_thread */
+	mutable boost::mutex _queue_mutex;
+	/** condition to tell the thread that there is something to do */
+	boost::condition _summon;
+	/** condition to tell flush() that something has been written */
+	mutable boost::condition _written;
+	/** entries waiting to be written */
+	std::list<boost::shared_ptr<const LogEntry> > _queue;
+	/** true if the thread is writing entries which it has taken from _queue */
+	bool _writing;
+	bool _stop_thread;
+	boost::thread* _thread;
 };
@@ -37,6 +37,7 @@
 #include "examine_content_job.h"
 #include "config.h"
 #include "playlist.h"
+#include "playlist_timeline.h"
 #include "dcp_content_type.h"
 #include "ratio.h"
 #include "cross.h"
@@ -51,6 +52,7 @@
 #include "ffmpeg_content.h"
 #include "dcp_content.h"
 #include "screen_kdm.h"
+#include "kdm_batch.h"
 #include "cinema.h"
 #include "change_signaller.h"
 #include "check_content_change_job.h"
@@ -160,6 +162,11 @@ Film::Film (optional<boost::filesystem::path> dir)
 	, _user_explicit_video_frame_rate (false)
 	, _state_version (current_state_version)
 	, _dirty (false)
+	, _metadata_writer (0)
+	, _pending_metadata_generation (0)
+	, _metadata_generation (0)
+	, _stop_metadata_writer (false)
+	, _written_metadata_generation (0)
 {
 	set_isdcf_date_today ();
 
@@ -202,6 +209,17 @@ Film::Film (optional<boost::filesystem::path> dir)
 
 Film::~Film ()
 {
+	if (_metadata_writer) {
+		/* Tell the writer to write anything that is pending and then finish */
+		{
+			boost::mutex::scoped_lock lm (_metadata_mutex);
+			_stop_metadata_writer = true;
+			_metadata_condition.notify_all ();
+		}
+		_metadata_writer->join ();
+		delete _metadata_writer;
+	}
+
 	BOOST_FOREACH (boost::signals2::connection& i, _job_connections) {
 		i.disconnect ();
 	}
@@ -420,17 +438,108 @@ Film::write_metadata (boost::filesystem::path path) const
 	doc->write_to_file_formatted (path.string());
 }
 
-/** Write state to our `metadata' file */
+/** Write state to our `metadata' file, returning when it has been written */
 void
 Film::write_metadata () const
 {
 	DCPOMATIC_ASSERT (directory());
-	boost::filesystem::create_directories (directory().get());
 	shared_ptr<xmlpp::Document> doc = metadata ();
-	doc->write_to_file_formatted (file(metadata_file).string ());
+
+	int generation;
+	{
+		boost::mutex::scoped_lock lm (_metadata_mutex);
+		generation = ++_metadata_generation;
+		/* Anything waiting to be written in the background is now out of date */
+		_pending_metadata.reset ();
+	}
+
+	write_metadata_atomically (doc, generation);
+	_dirty = false;
+}
+
+/** Take a copy of our state now and write it to our `metadata' file in the background.
+ *  Calls which come in quick succession are coalesced so that only the most recent state
+ *  is written.  Errors are logged rather than thrown.  Anything still to be written when
+ *  this Film is destroyed will be written then.
+ */
+void
+Film::write_metadata_in_background () const
+{
+	DCPOMATIC_ASSERT (directory());
+	shared_ptr<xmlpp::Document> doc = metadata ();
+
+	boost::mutex::scoped_lock lm (_metadata_mutex);
+	_pending_metadata = doc;
+	_pending_metadata_generation = ++_metadata_generation;
+	/* Wait a little while in case more changes are coming */
+	_pending_metadata_due = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds (500);
+
+	if (!_metadata_writer) {
+		_metadata_writer = new boost::thread (boost::bind (&Film::metadata_writer_thread, this));
+#ifdef DCPOMATIC_LINUX
+		pthread_setname_np (_metadata_writer->native_handle(), "film-metadata");
+#endif
+	}
+
+	_metadata_condition.notify_all ();
 	_dirty = false;
 }
 
+void
+Film::metadata_writer_thread () const
+{
+	while (true) {
+		shared_ptr<xmlpp::Document> doc;
+		int generation;
+		{
+			boost::mutex::scoped_lock lm (_metadata_mutex);
+			while (!_stop_metadata_writer && (!_pending_metadata || boost::posix_time::microsec_clock::universal_time() < _pending_metadata_due)) {
+				if (_pending_metadata) {
+					_metadata_condition.timed_wait (lm, _pending_metadata_due);
+				} else {
+					_metadata_condition.wait (lm);
+				}
+			}
+
+			if (!_pending_metadata) {
+				/* We have been asked to stop and there is nothing left to write */
+				return;
+			}
+
+			doc = _pending_metadata;
+			generation = _pending_metadata_generation;
+			_pending_metadata.reset ();
+		}
+
+		try {
+			write_metadata_atomically (doc, generation);
+		} catch (std::exception& e) {
+			LOG_ERROR ("Could not write film metadata (%1)", e.what());
+		}
+	}
+}
+
+/** Write doc to our metadata file via a temporary file, so that a crash part-way through
+ *  cannot leave a truncated file.  Nothing is written if the file already contains
+ *  metadata from a later generation.
+ */
+void
+Film::write_metadata_atomically (shared_ptr<xmlpp::Document> doc, int generation) const
+{
+	boost::mutex::scoped_lock lm (_metadata_file_mutex);
+	if (generation < _written_metadata_generation) {
+		return;
+	}
+
+	boost::filesystem::create_directories (directory().get());
+	boost::filesystem::path const final_file = file (metadata_file);
+	boost::filesystem::path temp_file = final_file;
+	temp_file += ".tmp";
+	doc->write_to_file_formatted (temp_file.string ());
+	boost::filesystem::rename (temp_file, final_file);
+	_written_metadata_generation = generation;
+}
+
 /** Write a template from this film */
 void
 Film::write_template (boost::filesystem::path path) const
@@ -1166,7 +1275,57 @@ Film::maybe_add_content (weak_ptr<Job> j, weak_ptr<Content> c, bool disable_audi
 	}
 
 	add_content (content);
+	maybe_analyse_audio (content, disable_audio_analysis);
+}
+
+/** Examine some content, several pieces at a time, and then add all of it to the
+ *  playlist with a single change.  Results may be taken from the ExaminationCache,
+ *  in which case the content that is added will be a copy of what was passed in;
+ *  use the other examine_and_add_content() if you need to keep hold of the content.
+ */
+void
+Film::examine_and_add_content (ContentList content, bool disable_audio_analysis)
+{
+	if (content.empty()) {
+		return;
+	}
 
+	if (_directory) {
+		BOOST_FOREACH (shared_ptr<Content> i, content) {
+			if (dynamic_pointer_cast<FFmpegContent> (i)) {
+				run_ffprobe (i->path(0), file("ffprobe.log"));
+			}
+		}
+	}
+
+	shared_ptr<Job> j (new ExamineContentJob (shared_from_this(), content));
+
+	_job_connections.push_back (
+		j->Finished.connect (bind (&Film::maybe_add_content_batch, this, weak_ptr<Job>(j), disable_audio_analysis))
+		);
+
+	JobManager::instance()->add (j);
+}
+
+void
+Film::maybe_add_content_batch (weak_ptr<Job> j, bool disable_audio_analysis)
+{
+	shared_ptr<ExamineContentJob> job = dynamic_pointer_cast<ExamineContentJob> (j.lock ());
+	if (!job || !job->finished_ok ()) {
+		return;
+	}
+
+	ContentList content = job->all_content ();
+	add_content (content);
+
+	BOOST_FOREACH (shared_ptr<Content> i, content) {
+		maybe_analyse_audio (i, disable_audio_analysis);
+	}
+}
+
+void
+Film::maybe_analyse_audio (shared_ptr<Content> content, bool disable_audio_analysis)
+{
 	if (Config::instance()->automatic_audio_analysis() && content->audio && !disable_audio_analysis) {
 		shared_ptr<Playlist> playlist (new Playlist);
 		playlist->add (shared_from_this(), content);
@@ -1198,6 +1357,40 @@ Film::add_content (shared_ptr<Content> c)
 	_playlist->add (shared_from_this(), c);
 }
 
+/** Add several pieces of content to the playlist with a single change */
+void
+Film::add_content (ContentList content)
+{
+	/* Add {video,subtitle} content after any existing {video,subtitle} content,
+	   and after each other in the order given.
+	*/
+	DCPTime video_end = _playlist->video_end (shared_from_this());
+	DCPTime text_end = _playlist->text_end (shared_from_this());
+
+	BOOST_FOREACH (shared_ptr<Content> i, content) {
+		if (i->video) {
+			i->set_position (shared_from_this(), video_end);
+		} else if (!i->text.empty()) {
+			i->set_position (shared_from_this(), text_end);
+		}
+
+		if (i->video) {
+			video_end = max (video_end, i->end(shared_from_this()));
+		}
+		if (!i->text.empty()) {
+			text_end = max (text_end, i->end(shared_from_this()));
+		}
+
+		if (_template_film) {
+			BOOST_FOREACH (shared_ptr<Content> j, _template_film->content()) {
+				i->take_settings_from (j);
+			}
+		}
+	}
+
+	_playlist->add (shared_from_this(), content);
+}
+
 void
 Film::remove_content (shared_ptr<Content> c)
 {
@@ -1360,16 +1553,30 @@ Film::make_kdm (
 	optional<int> disable_forensic_marking_audio
 	) const
 {
-	if (!_encrypted) {
-		throw runtime_error (_("Cannot make a KDM as this project is not encrypted."));
-	}
+	dcp::DecryptedKDM const kdm = make_decrypted_kdm (cpl_file, from, until);
 
-	shared_ptr<const dcp::CPL> cpl (new dcp::CPL (cpl_file));
 	shared_ptr<const dcp::CertificateChain> signer = Config::instance()->signer_chain ();
 	if (!signer->valid ()) {
 		throw InvalidSignerError ();
 	}
 
+	return kdm.encrypt (signer, recipient, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+}
+
+/** @param cpl_file CPL filename.
+ *  @param from KDM from time expressed as a local time with an offset from UTC.
+ *  @param until KDM to time expressed as a local time with an offset from UTC.
+ *  @return Decrypted KDM containing the keys needed to play cpl_file.
+ */
+dcp::DecryptedKDM
+Film::make_decrypted_kdm (boost::filesystem::path cpl_file, dcp::LocalTime from, dcp::LocalTime until) const
+{
+	if (!_encrypted) {
+		throw runtime_error (_("Cannot make a KDM as this project is not encrypted."));
+	}
+
+	shared_ptr<const dcp::CPL> cpl (new dcp::CPL (cpl_file));
+
 	/* Find keys that have been added to imported, encrypted DCP content */
 	list<dcp::DecryptedKDMKey> imported_keys;
 	BOOST_FOREACH (shared_ptr<Content> i, content()) {
@@ -1408,7 +1615,7 @@ Film::make_kdm (
 
 	return dcp::DecryptedKDM (
 		cpl->id(), keys, from, until, cpl->content_title_text(), cpl->content_title_text(), dcp::LocalTime().as_string()
-		).encrypt (signer, recipient, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+		);
 }
 
 /** @param screens Screens to make KDMs for.
@@ -1431,26 +1638,9 @@ Film::make_kdms (
 	optional<int> disable_forensic_marking_audio
 	) const
 {
-	list<ScreenKDM> kdms;
-
-	BOOST_FOREACH (shared_ptr<Screen> i, screens) {
-		if (i->recipient) {
-			dcp::EncryptedKDM const kdm = make_kdm (
-				i->recipient.get(),
-				i->trusted_device_thumbprints(),
-				cpl_file,
-				dcp::LocalTime (from,  i->cinema ? i->cinema->utc_offset_hour() : 0, i->cinema ? i->cinema->utc_offset_minute() : 0),
-				dcp::LocalTime (until, i->cinema ? i->cinema->utc_offset_hour() : 0, i->cinema ? i->cinema->utc_offset_minute() : 0),
-				formulation,
-				disable_forensic_marking_picture,
-				disable_forensic_marking_audio
-				);
-
-			kdms.push_back (ScreenKDM (i, kdm));
-		}
-	}
-
-	return kdms;
+	/* Read the CPL and find the keys once, then make each screen's KDM from those */
+	KDMBatch batch (make_decrypted_kdm(cpl_file, dcp::LocalTime(), dcp::LocalTime()), formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+	return batch.make (screens, from, until, Config::instance()->master_encoding_threads());
 }
 
 /** @return The approximate disk space required to encode a DCP of this film with the
@@ -1575,12 +1765,12 @@ Film::reels () const
 		list<DCPTime> split_points;
 		split_points.push_back (DCPTime());
 		split_points.push_back (len);
-		BOOST_FOREACH (shared_ptr<Content> c, content()) {
-			if (c->video) {
-				BOOST_FOREACH (DCPTime t, c->reel_split_points(shared_from_this())) {
+		BOOST_FOREACH (PlaylistTimeline::Entry const & i, _playlist->timeline(shared_from_this())->entries()) {
+			if (i.content->video) {
+				BOOST_FOREACH (DCPTime t, i.content->reel_split_points(shared_from_this())) {
 					split_points.push_back (t);
 				}
-				split_points.push_back (c->end(shared_from_this()));
+				split_points.push_back (i.period.to);
 			}
 		}
 
@@ -47,6 +47,10 @@ namespace xmlpp {
 	class Document;
 }
 
+namespace dcp {
+	class DecryptedKDM;
+}
+
 class DCPContentType;
 class Log;
 class Content;
@@ -120,6 +124,7 @@ public:
 	void use_template (std::string name);
 	std::list<std::string> read_metadata (boost::optional<boost::filesystem::path> path = boost::optional<boost::filesystem::path> ());
 	void write_metadata () const;
+	void write_metadata_in_background () const;
 	void write_metadata (boost::filesystem::path path) const;
 	void write_template (boost::filesystem::path path) const;
 	boost::shared_ptr<xmlpp::Document> metadata (bool with_content_paths = true) const;
@@ -329,7 +334,9 @@ public:
 	void set_name (std::string);
 	void set_use_isdcf_name (bool);
 	void examine_and_add_content (boost::shared_ptr<Content> content, bool disable_audio_analysis = false);
+	void examine_and_add_content (ContentList content, bool disable_audio_analysis = false);
 	void add_content (boost::shared_ptr<Content>);
+	void add_content (ContentList);
 	void remove_content (boost::shared_ptr<Content>);
 	void remove_content (ContentList);
 	void move_content_earlier (boost::shared_ptr<Content>);
@@ -368,6 +375,8 @@ public:
 
 private:
 
+	dcp::DecryptedKDM make_decrypted_kdm (boost::filesystem::path cpl_file, dcp::LocalTime from, dcp::LocalTime until) const;
+
 	friend struct ::isdcf_name_test;
 	template <typename> friend class ChangeSignaller;
 
@@ -380,7 +389,11 @@ private:
 	void playlist_order_changed ();
 	void playlist_content_change (ChangeType type, boost::weak_ptr<Content>, int, bool frequent);
 	void maybe_add_content (boost::weak_ptr<Job>, boost::weak_ptr<Content>, bool disable_audio_analysis);
+	void maybe_add_content_batch (boost::weak_ptr<Job>, bool disable_audio_analysis);
+	void maybe_analyse_audio (boost::shared_ptr<Content>, bool disable_audio_analysis);
 	void audio_analysis_finished ();
+	void write_metadata_atomically (boost::shared_ptr<xmlpp::Document> doc, int generation) const;
+	void metadata_writer_thread () const;
 
 	static std::string const metadata_file;
 
@@ -445,6 +458,26 @@ private:
 
 	mutable boost::mutex _info_file_mutex;
 
+	/** Mutex for _pending_metadata, _pending_metadata_generation, _pending_metadata_due,
+	 *  _metadata_generation and _stop_metadata_writer.
+	 */
+	mutable boost::mutex _metadata_mutex;
+	mutable boost::condition _metadata_condition;
+	/** Thread to write metadata given to write_metadata_in_background(), or 0 */
+	mutable boost::thread* _metadata_writer;
+	/** Metadata waiting to be written by _metadata_writer, or 0 */
+	mutable boost::shared_ptr<xmlpp::Document> _pending_metadata;
+	mutable int _pending_metadata_generation;
+	/** Time at which _pending_metadata should be written if nothing newer arrives before then */
+	mutable boost::posix_time::ptime _pending_metadata_due;
+	/** Incremented every time metadata is made for writing to our metadata file */
+	mutable int _metadata_generation;
+	mutable bool _stop_metadata_writer;
+	/** Mutex held while writing to our metadata file; also protects _written_metadata_generation */
+	mutable boost::mutex _metadata_file_mutex;
+	/** Generation of the metadata that is currently in our metadata file */
+	mutable int _written_metadata_generation;
+
 	boost::signals2::scoped_connection _playlist_change_connection;
 	boost::signals2::scoped_connection _playlist_order_changed_connection;
 	boost::signals2::scoped_connection _playlist_content_change_connection;
@@ -51,6 +51,7 @@ using std::max;
 using std::cout;
 using std::cerr;
 using std::list;
+using std::vector;
 using std::runtime_error;
 using boost::shared_ptr;
 using dcp::Size;
@@ -804,27 +805,43 @@ Image::copy (shared_ptr<const Image> other, Position<int> position)
 void
 Image::read_from_socket (shared_ptr<Socket> socket)
 {
+	vector<boost::asio::mutable_buffer> buffers;
 	for (int i = 0; i < planes(); ++i) {
 		uint8_t* p = data()[i];
 		int const lines = sample_size(i).height;
-		for (int y = 0; y < lines; ++y) {
-			socket->read (p, line_size()[i]);
-			p += stride()[i];
+		if (stride()[i] == line_size()[i]) {
+			/* No padding, so the whole plane can be one buffer */
+			buffers.push_back (boost::asio::buffer (p, line_size()[i] * lines));
+		} else {
+			for (int y = 0; y < lines; ++y) {
+				buffers.push_back (boost::asio::buffer (p, line_size()[i]));
+				p += stride()[i];
+			}
 		}
 	}
+
+	socket->read (buffers);
 }
 
 void
 Image::write_to_socket (shared_ptr<Socket> socket) const
 {
+	vector<boost::asio::const_buffer> buffers;
 	for (int i = 0; i < planes(); ++i) {
-		uint8_t* p = data()[i];
+		uint8_t const * p = data()[i];
 		int const lines = sample_size(i).height;
-		for (int y = 0; y < lines; ++y) {
-			socket->write (p, line_size()[i]);
-			p += stride()[i];
+		if (stride()[i] == line_size()[i]) {
+			/* No padding, so the whole plane can be one buffer */
+			buffers.push_back (boost::asio::buffer (p, line_size()[i] * lines));
+		} else {
+			for (int y = 0; y < lines; ++y) {
+				buffers.push_back (boost::asio::buffer (p, line_size()[i]));
+				p += stride()[i];
+			}
 		}
 	}
+
+	socket->write (buffers);
 }
 
 float
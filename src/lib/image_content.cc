@@ -30,6 +30,7 @@
 #include <libcxml/cxml.h>
 #include <libxml++/libxml++.h>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
 
 #include "i18n.h"
@@ -104,7 +105,9 @@ void
 ImageContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 {
 	if (_path_to_scan) {
-		job->sub (_("Scanning image files"));
+		if (job) {
+			job->sub (_("Scanning image files"));
+		}
 		vector<boost::filesystem::path> paths;
 		int n = 0;
 		for (boost::filesystem::directory_iterator i(*_path_to_scan); i != boost::filesystem::directory_iterator(); ++i) {
@@ -113,7 +116,11 @@ ImageContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 			}
 			++n;
 			if ((n % 1000) == 0) {
-				job->set_progress_unknown ();
+				if (job) {
+					job->set_progress_unknown ();
+				}
+				/* There may be no job to notice a cancel for us */
+				boost::this_thread::interruption_point ();
 			}
 		}
 
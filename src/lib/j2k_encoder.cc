@@ -36,6 +36,9 @@
 #include "player_video.h"
 #include "encode_server_description.h"
 #include "compose.hpp"
+#include "trace.h"
+#include "metrics.h"
+#include "encode_report.h"
 #include <libcxml/cxml.h>
 #include <boost/foreach.hpp>
 #include <iostream>
@@ -53,10 +56,11 @@ using dcp::Data;
 /** @param film Film that we are encoding.
  *  @param writer Writer that we are using.
  */
-J2KEncoder::J2KEncoder (shared_ptr<const Film> film, shared_ptr<Writer> writer)
+J2KEncoder::J2KEncoder (shared_ptr<const Film> film, shared_ptr<Writer> writer, shared_ptr<EncodeReport> report)
 	: _film (film)
 	, _history (200)
 	, _writer (writer)
+	, _report (report)
 {
 	servers_list_changed ();
 }
@@ -166,6 +170,7 @@ void
 J2KEncoder::frame_done ()
 {
 	_history.event ();
+	Metrics::instance()->set ("encoding_rate", _history.rate ());
 }
 
 /** Called to request encoding of the next video frame in the DCP.  This is called in order,
@@ -194,7 +199,9 @@ J2KEncoder::encode (shared_ptr<PlayerVideo> pv, DCPTime time)
 	*/
 	while (_queue.size() >= (threads * 2) + 1) {
 		LOG_TIMING ("decoder-sleep queue=%1 threads=%2", _queue.size(), threads);
+		Trace::instance()->begin ("decoder-sleep");
 		_full_condition.wait (queue_lock);
+		Trace::instance()->end ("decoder-sleep");
 		LOG_TIMING ("decoder-wake queue=%1 threads=%2", _queue.size(), threads);
 	}
 
@@ -232,6 +239,8 @@ J2KEncoder::encode (shared_ptr<PlayerVideo> pv, DCPTime time)
 						  _film->resolution()
 						  )
 					  ));
+		Trace::instance()->counter ("encoder-queue", _queue.size());
+		Metrics::instance()->set ("encoder_queue", _queue.size());
 
 		/* The queue might not be empty any more, so notify anything which is
 		   waiting on that.
@@ -292,10 +301,12 @@ try
 	while (true) {
 
 		LOG_TIMING ("encoder-sleep thread=%1", thread_id ());
+		Trace::instance()->begin ("encoder-sleep");
 		boost::mutex::scoped_lock lock (_queue_mutex);
 		while (_queue.empty ()) {
 			_empty_condition.wait (lock);
 		}
+		Trace::instance()->end ("encoder-sleep");
 
 		LOG_TIMING ("encoder-wake thread=%1 queue=%2", thread_id(), _queue.size());
 		shared_ptr<DCPVideo> vf = _queue.front ();
@@ -309,6 +320,8 @@ try
 
 			LOG_TIMING ("encoder-pop thread=%1 frame=%2 eyes=%3", thread_id(), vf->index(), (int) vf->eyes ());
 			_queue.pop_front ();
+			Trace::instance()->counter ("encoder-queue", _queue.size());
+			Metrics::instance()->set ("encoder_queue", _queue.size());
 
 			lock.unlock ();
 
@@ -317,7 +330,13 @@ try
 			/* We need to encode this input */
 			if (server) {
 				try {
+					TraceSpan span ("remote-encode", vf->index());
+					struct timeval start;
+					gettimeofday (&start, 0);
 					encoded = vf->encode_remotely (server.get ());
+					struct timeval finish;
+					gettimeofday (&finish, 0);
+					_report->add_latency (server->host_name(), seconds(finish) - seconds(start));
 
 					if (remote_backoff > 0) {
 						LOG_GENERAL ("%1 was lost, but now she is found; removing backoff", server->host_name ());
@@ -325,8 +344,10 @@ try
 
 					/* This job succeeded, so remove any backoff */
 					remote_backoff = 0;
+					Metrics::instance()->add ("encoded_frames_total", 1, server->host_name());
 
 				} catch (std::exception& e) {
+					Metrics::instance()->add ("encode_failures_total", 1, server->host_name());
 					if (remote_backoff < 60) {
 						/* back off more */
 						remote_backoff += 10;
@@ -340,7 +361,14 @@ try
 			} else {
 				try {
 					LOG_TIMING ("start-local-encode thread=%1 frame=%2", thread_id(), vf->index());
+					TraceSpan span ("local-encode", vf->index());
+					struct timeval start;
+					gettimeofday (&start, 0);
 					encoded = vf->encode_locally ();
+					struct timeval finish;
+					gettimeofday (&finish, 0);
+					_report->add_latency ("localhost", seconds(finish) - seconds(start));
+					Metrics::instance()->add ("encoded_frames_total", 1, "localhost");
 					LOG_TIMING ("finish-local-encode thread=%1 frame=%2", thread_id(), vf->index());
 				} catch (std::exception& e) {
 					/* This is very bad, so don't cope with it, just pass it on */
@@ -380,6 +408,57 @@ catch (...)
 	_full_condition.notify_all ();
 }
 
+/** @return Frames per second per thread that a server measured when calibrating at a given resolution, if it did */
+static optional<float>
+speed_per_thread (EncodeServerDescription const & server, Resolution resolution)
+{
+	optional<float> const fps = resolution == RESOLUTION_4K ? server.frames_per_second_4k() : server.frames_per_second_2k();
+	if (!fps || *fps <= 0 || server.threads() < 1) {
+		return optional<float> ();
+	}
+
+	return *fps / server.threads();
+}
+
+/** @param server Server that we are going to send frames to.
+ *  @param servers All the servers that we are using, including server.
+ *  @param resolution Resolution of the frames that we will send.
+ *  @return Number of our worker threads to send frames to server.
+ *
+ *  We start with the server's own thread count, and take off any frames that were
+ *  already queued on it when it last replied (as it has more work than it can start,
+ *  from somebody).  Each worker sends one frame at a time and frames are written in
+ *  order, so a frame sitting on a slow thread holds up the writer; if the server has
+ *  calibrated its speed we therefore also scale by how its speed per thread compares
+ *  with the fastest server's.  Every server gets at least one thread.
+ *
+ *  The server's count of busy threads is not used, as it includes any frames that we
+ *  are already sending it.
+ */
+int
+J2KEncoder::remote_threads (EncodeServerDescription const & server, list<EncodeServerDescription> const & servers, Resolution resolution)
+{
+	float threads = server.threads ();
+	if (server.queued()) {
+		threads -= *server.queued();
+	}
+
+	optional<float> fastest;
+	BOOST_FOREACH (EncodeServerDescription const & i, servers) {
+		optional<float> const s = speed_per_thread (i, resolution);
+		if (s && (!fastest || *s > *fastest)) {
+			fastest = s;
+		}
+	}
+
+	optional<float> const speed = speed_per_thread (server, resolution);
+	if (speed && fastest) {
+		threads *= *speed / *fastest;
+	}
+
+	return std::max (1, int (lrintf (threads)));
+}
+
 void
 J2KEncoder::servers_list_changed ()
 {
@@ -414,13 +493,15 @@ J2KEncoder::servers_list_changed ()
 		}
 	}
 
-	BOOST_FOREACH (EncodeServerDescription i, EncodeServerFinder::instance()->servers()) {
+	list<EncodeServerDescription> const servers = EncodeServerFinder::instance()->servers ();
+	BOOST_FOREACH (EncodeServerDescription i, servers) {
 		if (!i.current_link_version()) {
 			continue;
 		}
 
-		LOG_GENERAL (N_("Adding %1 worker threads for remote %2"), i.threads(), i.host_name ());
-		for (int j = 0; j < i.threads(); ++j) {
+		int const threads = remote_threads (i, servers, _film->resolution());
+		LOG_GENERAL (N_("Adding %1 worker threads for remote %2 (which has %3)"), threads, i.host_name(), i.threads());
+		for (int j = 0; j < threads; ++j) {
 			_threads.push_back (new boost::thread (boost::bind (&J2KEncoder::encoder_thread, this, i)));
 		}
 	}
@@ -45,6 +45,7 @@ class DCPVideo;
 class Writer;
 class Job;
 class PlayerVideo;
+class EncodeReport;
 
 /** @class J2KEncoder
  *  @brief Class to manage encoding to J2K.
@@ -56,7 +57,7 @@ class PlayerVideo;
 class J2KEncoder : public boost::noncopyable, public ExceptionStore, public boost::enable_shared_from_this<J2KEncoder>
 {
 public:
-	J2KEncoder (boost::shared_ptr<const Film> film, boost::shared_ptr<Writer> writer);
+	J2KEncoder (boost::shared_ptr<const Film> film, boost::shared_ptr<Writer> writer, boost::shared_ptr<EncodeReport> report);
 	~J2KEncoder ();
 
 	/** Called to indicate that a processing run is about to begin */
@@ -73,6 +74,10 @@ public:
 
 	void servers_list_changed ();
 
+	static int remote_threads (
+		EncodeServerDescription const & server, std::list<EncodeServerDescription> const & servers, Resolution resolution
+		);
+
 private:
 
 	static void call_servers_list_changed (boost::weak_ptr<J2KEncoder> encoder);
@@ -98,6 +103,8 @@ private:
 	boost::condition _full_condition;
 
 	boost::shared_ptr<Writer> _writer;
+	/** report to add per-frame encode times to */
+	boost::shared_ptr<EncodeReport> _report;
 	Waker _waker;
 
 	boost::shared_ptr<PlayerVideo> _last_player_video[EYES_COUNT];
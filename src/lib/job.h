@@ -49,6 +49,20 @@ public:
 	/** Run this job in the current thread. */
 	virtual void run () = 0;
 
+	/** The kind of resource that a job mostly uses; JobManager will run
+	 *  jobs which use different resources at the same time.
+	 */
+	enum Resource {
+		RESOURCE_CPU,     ///< CPU-heavy work, e.g. encoding
+		RESOURCE_DISK,    ///< mostly reading or writing files
+		RESOURCE_NETWORK  ///< mostly talking to other machines
+	};
+
+	/** @return the resource that this job mostly uses */
+	virtual Resource resource () const {
+		return RESOURCE_CPU;
+	}
+
 	void start ();
 	bool pause_by_user ();
 	void pause_by_priority ();
@@ -27,12 +27,16 @@
 #include "cross.h"
 #include "analyse_audio_job.h"
 #include "film.h"
+#include "dcpomatic_assert.h"
 #include <boost/thread.hpp>
 #include <boost/foreach.hpp>
 #include <iostream>
+#include <set>
 
 using std::string;
 using std::list;
+using std::map;
+using std::set;
 using std::cout;
 using boost::shared_ptr;
 using boost::weak_ptr;
@@ -48,7 +52,10 @@ JobManager::JobManager ()
 	, _paused (false)
 	, _scheduler (0)
 {
-
+	/* Encodes use all the CPU they can get, so only run one at once */
+	_resource_limits[Job::RESOURCE_CPU] = 1;
+	_resource_limits[Job::RESOURCE_DISK] = 2;
+	_resource_limits[Job::RESOURCE_NETWORK] = 4;
 }
 
 void
@@ -153,49 +160,90 @@ JobManager::scheduler ()
 
 		boost::mutex::scoped_lock lm (_mutex);
 
-		while (true) {
-			bool have_new = false;
-			bool have_running = false;
-			BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
-				if (i->running()) {
-					have_running = true;
-				}
-				if (i->is_new()) {
-					have_new = true;
+		if (_terminate) {
+			break;
+		}
+
+		/* Count the jobs which have been started and not yet finished, and note which
+		   films they are for.
+		*/
+		map<Job::Resource, int> used;
+		set<shared_ptr<const Film> > busy;
+		BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
+			if (!i->is_new() && !i->finished()) {
+				++used[i->resource()];
+				if (i->film()) {
+					busy.insert (i->film());
 				}
 			}
+		}
 
-			if ((!have_running && have_new) || _terminate) {
-				break;
+		/* Start any new jobs that we have room for, in order */
+		BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
+			if (!i->is_new()) {
+				continue;
 			}
 
-			_empty_condition.wait (lm);
-		}
+			shared_ptr<const Film> film = i->film ();
+			if (film && busy.find(film) != busy.end()) {
+				/* Jobs for the same film must run in order */
+				continue;
+			}
 
-		if (_terminate) {
-			break;
-		}
+			if (film) {
+				/* Even if we can't start this job now, later jobs for the same
+				   film must still wait for it.
+				*/
+				busy.insert (film);
+			}
 
-		BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
-			if (i->is_new()) {
-				_connections.push_back (i->FinishedImmediate.connect(bind(&JobManager::job_finished, this)));
-				i->start ();
-				emit (boost::bind (boost::ref (ActiveJobsChanged), _last_active_job, i->json_name()));
-				_last_active_job = i->json_name ();
-				/* Only start one job at once */
-				break;
+			if (used[i->resource()] < _resource_limits[i->resource()]) {
+				++used[i->resource()];
+				start_unlocked (i);
 			}
 		}
+
+		_empty_condition.wait (lm);
 	}
 }
 
+/** Start a job; must be called with _mutex held */
 void
-JobManager::job_finished ()
+JobManager::start_unlocked (shared_ptr<Job> job)
+{
+	_connections.push_back (job->FinishedImmediate.connect(bind(&JobManager::job_finished, this, weak_ptr<Job>(job))));
+	job->start ();
+	emit (boost::bind (boost::ref (ActiveJobsChanged), _last_active_job, job->json_name()));
+	_last_active_job = job->json_name ();
+}
+
+/** @return json_name() of a job which is still running, if there is one; must be called
+ *  with _mutex held.
+ */
+optional<string>
+JobManager::running_job_name_unlocked () const
+{
+	BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
+		if (i->running()) {
+			return i->json_name ();
+		}
+	}
+
+	return optional<string> ();
+}
+
+void
+JobManager::job_finished (weak_ptr<Job> job)
 {
 	{
 		boost::mutex::scoped_lock lm (_mutex);
-		emit (boost::bind (boost::ref (ActiveJobsChanged), _last_active_job, optional<string>()));
-		_last_active_job = optional<string>();
+		optional<string> finished;
+		shared_ptr<Job> j = job.lock ();
+		if (j) {
+			finished = j->json_name ();
+		}
+		_last_active_job = running_job_name_unlocked ();
+		emit (boost::bind (boost::ref (ActiveJobsChanged), finished, _last_active_job));
 	}
 
 	_empty_condition.notify_all ();
@@ -283,19 +331,31 @@ JobManager::priority_changed ()
 	{
 		boost::mutex::scoped_lock lm (_mutex);
 
-		bool first = true;
+		/* Go through the jobs in their new order, giving each one a chance to run if there is
+		   room for it, and pausing anything which no longer fits.
+		*/
+		map<Job::Resource, int> used;
+		set<shared_ptr<const Film> > busy;
 		BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
-			if (first) {
+			if (i->finished()) {
+				continue;
+			}
+
+			shared_ptr<const Film> film = i->film ();
+			bool const can_run = (!film || busy.find(film) == busy.end()) && used[i->resource()] < _resource_limits[i->resource()];
+			if (film) {
+				busy.insert (film);
+			}
+
+			if (can_run) {
+				++used[i->resource()];
 				if (i->is_new ()) {
-					i->start ();
+					start_unlocked (i);
 				} else if (i->paused_by_priority ()) {
 					i->resume ();
 				}
-				first = false;
-			} else {
-				if (i->running ()) {
-					i->pause_by_priority ();
-				}
+			} else if (i->running ()) {
+				i->pause_by_priority ();
 			}
 		}
 	}
@@ -337,7 +397,7 @@ JobManager::pause ()
 
 	BOOST_FOREACH (shared_ptr<Job> i, _jobs) {
 		if (i->pause_by_user()) {
-			_paused_job = i;
+			_paused_jobs.push_back (i);
 		}
 	}
 
@@ -352,10 +412,33 @@ JobManager::resume ()
 		return;
 	}
 
-	if (_paused_job) {
-		_paused_job->resume ();
+	BOOST_FOREACH (shared_ptr<Job> i, _paused_jobs) {
+		i->resume ();
 	}
 
-	_paused_job.reset ();
+	_paused_jobs.clear ();
 	_paused = false;
 }
+
+/** Set the maximum number of jobs using a given resource which may run at the same time */
+void
+JobManager::set_resource_limit (Job::Resource resource, int limit)
+{
+	DCPOMATIC_ASSERT (limit > 0);
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_resource_limits[resource] = limit;
+	}
+
+	_empty_condition.notify_all ();
+}
+
+int
+JobManager::resource_limit (Job::Resource resource) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	map<Job::Resource, int>::const_iterator i = _resource_limits.find (resource);
+	DCPOMATIC_ASSERT (i != _resource_limits.end());
+	return i->second;
+}
@@ -23,13 +23,14 @@
  */
 
 #include "signaller.h"
+#include "job.h"
 #include <boost/thread/mutex.hpp>
 #include <boost/thread.hpp>
 #include <boost/signals2.hpp>
 #include <boost/thread/condition.hpp>
 #include <list>
+#include <map>
 
-class Job;
 class Film;
 class Playlist;
 struct threed_test7;
@@ -38,6 +39,11 @@ extern bool wait_for_jobs ();
 
 /** @class JobManager
  *  @brief A simple scheduler for jobs.
+ *
+ *  Jobs are started in the order that they appear in the list.  Jobs which
+ *  use different resources (see Job::Resource) can run at the same time, up to
+ *  a limit for each resource.  Jobs for the same film are always run one
+ *  after the other.
  */
 class JobManager : public Signaller, public boost::noncopyable
 {
@@ -56,6 +62,9 @@ public:
 		return _paused;
 	}
 
+	void set_resource_limit (Job::Resource resource, int limit);
+	int resource_limit (Job::Resource resource) const;
+
 	void analyse_audio (
 		boost::shared_ptr<const Film> film,
 		boost::shared_ptr<const Playlist> playlist,
@@ -81,7 +90,9 @@ private:
 	void scheduler ();
 	void start ();
 	void priority_changed ();
-	void job_finished ();
+	void job_finished (boost::weak_ptr<Job> job);
+	void start_unlocked (boost::shared_ptr<Job> job);
+	boost::optional<std::string> running_job_name_unlocked () const;
 
 	mutable boost::mutex _mutex;
 	boost::condition _empty_condition;
@@ -90,7 +101,9 @@ private:
 	std::list<boost::signals2::connection> _connections;
 	bool _terminate;
 	bool _paused;
-	boost::shared_ptr<Job> _paused_job;
+	std::list<boost::shared_ptr<Job> > _paused_jobs;
+	/** maximum number of jobs using each resource which may run at once */
+	std::map<Job::Resource, int> _resource_limits;
 
 	boost::optional<std::string> _last_active_job;
 	boost::thread* _scheduler;
@@ -24,6 +24,7 @@
 #include "util.h"
 #include "film.h"
 #include "transcode_job.h"
+#include "metrics.h"
 #include <dcp/raw_convert.h>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
@@ -52,6 +53,9 @@ enum State {
 
 JSONServer::JSONServer (int port)
 {
+	/* Start recording metrics now that somebody may ask for them */
+	Metrics::instance()->set_enabled (true);
+
 	thread* t = new thread (boost::bind (&JSONServer::run, this, port));
 #ifdef DCPOMATIC_LINUX
 	pthread_setname_np (t->native_handle(), "json-server");
@@ -157,6 +161,7 @@ JSONServer::request (string url, shared_ptr<tcp::socket> socket)
 	}
 
 	string json;
+	string content_type = "application/json";
 	if (action == "status") {
 
 		list<shared_ptr<Job> > jobs = JobManager::instance()->get ();
@@ -186,11 +191,18 @@ JSONServer::request (string url, shared_ptr<tcp::socket> socket)
 			}
 		}
 		json += "] }";
+	} else if (action == "metrics") {
+		if (r.find ("format") != r.end() && r["format"] == "prometheus") {
+			json = Metrics::instance()->prometheus ();
+			content_type = "text/plain; version=0.0.4";
+		} else {
+			json = Metrics::instance()->json ();
+		}
 	}
 
 	string reply = "HTTP/1.1 200 OK\r\n"
 		"Content-Length: " + raw_convert<string>(json.length()) + "\r\n"
-		"Content-Type: application/json\r\n"
+		"Content-Type: " + content_type + "\r\n"
 		"\r\n"
 		+ json + "\r\n";
 	cout << "reply: " << json << "\n";
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "kdm_batch.h"
+#include "screen.h"
+#include "cinema.h"
+#include "config.h"
+#include "exceptions.h"
+#include "dcpomatic_assert.h"
+#include <dcp/certificate_chain.h>
+#include <dcp/encrypted_kdm.h>
+#include <dcp/local_time.h>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/foreach.hpp>
+
+using std::list;
+using std::vector;
+using std::max;
+using boost::shared_ptr;
+using boost::optional;
+
+/** @param keys KDM containing the keys which should be given to each screen; its validity period is ignored.
+ *  @param formulation KDM formulation to use.
+ *  @param disable_forensic_marking_picture true to disable forensic marking of picture.
+ *  @param disable_forensic_marking_audio if not set, don't disable forensic marking of audio.  If set to 0,
+ *  disable all forensic marking; if set above 0, disable forensic marking above that channel.
+ */
+KDMBatch::KDMBatch (
+	dcp::DecryptedKDM keys,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio
+	)
+	: _keys (keys)
+	, _signer (Config::instance()->signer_chain())
+	, _formulation (formulation)
+	, _disable_forensic_marking_picture (disable_forensic_marking_picture)
+	, _disable_forensic_marking_audio (disable_forensic_marking_audio)
+{
+	if (!_signer->valid ()) {
+		throw InvalidSignerError ();
+	}
+}
+
+/** Make KDMs for some screens; screens without a recipient certificate are skipped.
+ *  @param from KDM from time expressed as a local time in the time zone of the Screen's Cinema.
+ *  @param until KDM to time expressed as a local time in the time zone of the Screen's Cinema.
+ *  @param threads Number of threads to use to make the KDMs.
+ *  @return KDMs, in the same order as the screens.
+ */
+list<ScreenKDM>
+KDMBatch::make (list<shared_ptr<Screen> > screens, boost::posix_time::ptime from, boost::posix_time::ptime until, int threads)
+{
+	vector<shared_ptr<Screen> > recipients;
+	BOOST_FOREACH (shared_ptr<Screen> i, screens) {
+		if (i->recipient) {
+			recipients.push_back (i);
+		}
+	}
+
+	vector<optional<dcp::EncryptedKDM> > kdms (recipients.size());
+
+	boost::asio::io_service service;
+	boost::thread_group pool;
+
+	shared_ptr<boost::asio::io_service::work> work (new boost::asio::io_service::work (service));
+
+	for (int i = 0; i < max (1, threads); ++i) {
+		pool.create_thread (boost::bind (&boost::asio::io_service::run, &service));
+	}
+
+	for (size_t i = 0; i < recipients.size(); ++i) {
+		service.post (boost::bind (&KDMBatch::make_one, this, recipients[i], from, until, &kdms[i]));
+	}
+
+	work.reset ();
+	pool.join_all ();
+	service.stop ();
+
+	rethrow ();
+
+	list<ScreenKDM> out;
+	for (size_t i = 0; i < recipients.size(); ++i) {
+		DCPOMATIC_ASSERT (kdms[i]);
+		out.push_back (ScreenKDM (recipients[i], kdms[i].get()));
+	}
+
+	return out;
+}
+
+void
+KDMBatch::make_one (shared_ptr<Screen> screen, boost::posix_time::ptime from, boost::posix_time::ptime until, optional<dcp::EncryptedKDM>* kdm)
+try
+{
+	int const hour = screen->cinema ? screen->cinema->utc_offset_hour() : 0;
+	int const minute = screen->cinema ? screen->cinema->utc_offset_minute() : 0;
+
+	dcp::DecryptedKDM decrypted (
+		dcp::LocalTime (from, hour, minute),
+		dcp::LocalTime (until, hour, minute),
+		_keys.annotation_text().get_value_or(""),
+		_keys.content_title_text(),
+		dcp::LocalTime().as_string()
+		);
+
+	BOOST_FOREACH (dcp::DecryptedKDMKey const & i, _keys.keys()) {
+		decrypted.add_key (i);
+	}
+
+	*kdm = decrypted.encrypt (
+		_signer, screen->recipient.get(), screen->trusted_device_thumbprints(), _formulation,
+		_disable_forensic_marking_picture, _disable_forensic_marking_audio
+		);
+}
+catch (...)
+{
+	store_current ();
+}
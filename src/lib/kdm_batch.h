@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DCPOMATIC_KDM_BATCH_H
+#define DCPOMATIC_KDM_BATCH_H
+
+#include "screen_kdm.h"
+#include "exception_store.h"
+#include <dcp/decrypted_kdm.h>
+#include <dcp/types.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
+#include <list>
+
+class Screen;
+
+namespace dcp {
+	class CertificateChain;
+}
+
+/** @class KDMBatch
+ *  @brief Make KDMs for many screens from one set of keys.
+ *
+ *  The keys and signer are set up once, then the KDMs for each screen
+ *  are encrypted and signed in parallel.
+ */
+class KDMBatch : public ExceptionStore, public boost::noncopyable
+{
+public:
+	KDMBatch (
+		dcp::DecryptedKDM keys,
+		dcp::Formulation formulation,
+		bool disable_forensic_marking_picture,
+		boost::optional<int> disable_forensic_marking_audio
+		);
+
+	std::list<ScreenKDM> make (
+		std::list<boost::shared_ptr<Screen> > screens,
+		boost::posix_time::ptime from,
+		boost::posix_time::ptime until,
+		int threads
+		);
+
+private:
+	void make_one (
+		boost::shared_ptr<Screen> screen,
+		boost::posix_time::ptime from,
+		boost::posix_time::ptime until,
+		boost::optional<dcp::EncryptedKDM>* kdm
+		);
+
+	/** KDM holding the keys to put in each screen's KDM */
+	dcp::DecryptedKDM _keys;
+	boost::shared_ptr<const dcp::CertificateChain> _signer;
+	dcp::Formulation _formulation;
+	bool _disable_forensic_marking_picture;
+	boost::optional<int> _disable_forensic_marking_audio;
+};
+
+#endif
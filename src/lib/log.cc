@@ -44,12 +44,12 @@ Log::Log ()
 void
 Log::log (shared_ptr<const LogEntry> e)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
-	if ((_types & e->type()) == 0) {
+	if (!enabled (e->type())) {
 		return;
 	}
 
+	boost::mutex::scoped_lock lm (_mutex);
+
 	do_log (e);
 }
 
@@ -57,14 +57,14 @@ Log::log (shared_ptr<const LogEntry> e)
 void
 Log::log (string message, int type)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
-	if ((_types & type) == 0) {
+	if (!enabled (type)) {
 		return;
 	}
 
 	shared_ptr<StringLogEntry> e (new StringLogEntry (type, message));
 
+	boost::mutex::scoped_lock lm (_mutex);
+
 	do_log (e);
 }
 
@@ -87,6 +87,5 @@ Log::dcp_log (dcp::NoteType type, string m)
 void
 Log::set_types (int t)
 {
-	boost::mutex::scoped_lock lm (_mutex);
 	_types = t;
 }
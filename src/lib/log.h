@@ -30,6 +30,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/signals2.hpp>
+#include <boost/atomic.hpp>
 #include <string>
 
 /** @class Log
@@ -47,6 +48,14 @@ public:
 
 	void set_types (int types);
 
+	/** @return true if entries of the given type will be put into the log.
+	 *  This takes no lock, so it is cheap enough to call before building
+	 *  a message which might not be needed.
+	 */
+	bool enabled (int type) const {
+		return (_types & type) != 0;
+	}
+
 	/** @param amount Approximate number of bytes to return; the returned value
 	 *  may be shorter or longer than this.
 	 */
@@ -61,7 +70,7 @@ private:
 	virtual void do_log (boost::shared_ptr<const LogEntry> entry) = 0;
 
 	/** bit-field of log types which should be put into the log (others are ignored) */
-	int _types;
+	boost::atomic<int> _types;
 };
 
 #endif
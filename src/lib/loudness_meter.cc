@@ -0,0 +1,382 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/loudness_meter.cc
+ *  @brief LoudnessMeter class.
+ */
+
+#include "loudness_meter.h"
+#include "audio_buffers.h"
+#include "dcpomatic_assert.h"
+#include <dcp/types.h>
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+using std::min;
+using std::max;
+using std::sort;
+using boost::shared_ptr;
+using boost::optional;
+
+int const LoudnessMeter::_taps_per_phase = 12;
+
+/** Number of segments in a momentary block (400ms) */
+static int const momentary_segments = 4;
+/** Number of segments in a short-term block (3s) */
+static int const short_term_segments = 30;
+/** Absolute gate for both integrated loudness and loudness range, in LUFS */
+static double const absolute_gate = -70;
+/** Relative gate for integrated loudness, in LU */
+static double const integrated_relative_gate = -10;
+/** Relative gate for loudness range, in LU */
+static double const range_relative_gate = -20;
+
+/** @return Loudness in LUFS of a channel-weighted mean square value */
+static double
+loudness (double mean_square)
+{
+	return -0.691 + 10 * log10 (mean_square);
+}
+
+/** @return Loudness in LUFS of the energy mean of some mean square values
+ *  whose loudnesses are above a threshold, or none if there are no such values.
+ */
+static optional<double>
+gated_loudness (vector<double> const & blocks, double threshold)
+{
+	double sum = 0;
+	int n = 0;
+	BOOST_FOREACH (double i, blocks) {
+		if (loudness(i) > threshold) {
+			sum += i;
+			++n;
+		}
+	}
+
+	if (n == 0) {
+		return optional<double> ();
+	}
+
+	return loudness (sum / n);
+}
+
+/** @param sample_rate Sample rate of the audio that will be given to process().
+ *  @param channels Number of channels that will be given to process().
+ */
+LoudnessMeter::LoudnessMeter (int sample_rate, int channels)
+	: _sample_rate (sample_rate)
+	, _channels (channels)
+	, _segment_length (max (1, sample_rate / 10))
+	, _segment_done (0)
+{
+	/* K-weighting filters for this sample rate; these give the coefficients
+	   in BS.1770 at 48kHz.
+	*/
+	{
+		double const f0 = 1681.974450955533;
+		double const G = 3.999843853973347;
+		double const Q = 0.7071752369554196;
+		double const K = tan (M_PI * f0 / sample_rate);
+		double const Vh = pow (10, G / 20);
+		double const Vb = pow (Vh, 0.4996667741545416);
+		double const a0 = 1 + K / Q + K * K;
+		_shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+		_shelf.b1 = 2 * (K * K - Vh) / a0;
+		_shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+		_shelf.a1 = 2 * (K * K - 1) / a0;
+		_shelf.a2 = (1 - K / Q + K * K) / a0;
+	}
+
+	{
+		double const f0 = 38.13547087602444;
+		double const Q = 0.5003270373238773;
+		double const K = tan (M_PI * f0 / sample_rate);
+		double const a0 = 1 + K / Q + K * K;
+		_high_pass.b0 = 1;
+		_high_pass.b1 = -2;
+		_high_pass.b2 = 1;
+		_high_pass.a1 = 2 * (K * K - 1) / a0;
+		_high_pass.a2 = (1 - K / Q + K * K) / a0;
+	}
+
+	/* Channel weights from BS.1770; the LFE, the hearing/visually-impaired
+	   tracks and the channels after BSR (motion data, sync signal, sign language)
+	   are not part of the programme loudness.
+	*/
+	for (int i = 0; i < channels; ++i) {
+		if (i > dcp::BSR) {
+			_channels[i].weight = 0;
+			continue;
+		}
+
+		switch (static_cast<dcp::Channel>(i)) {
+		case dcp::LFE:
+		case dcp::HI:
+		case dcp::VI:
+			_channels[i].weight = 0;
+			break;
+		case dcp::LS:
+		case dcp::RS:
+		case dcp::BSL:
+		case dcp::BSR:
+			_channels[i].weight = 1.41;
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* Oversample to at least 192kHz to find true peaks, using a windowed-sinc
+	   interpolation filter split into one phase per output sample.
+	*/
+	_oversample = 1;
+	while (_sample_rate * _oversample < 192000 && _oversample < 4) {
+		_oversample *= 2;
+	}
+
+	int const taps = _taps_per_phase * _oversample;
+	_interpolation.resize (taps);
+	_interpolation_gain = 1;
+	for (int i = 0; i < _oversample; ++i) {
+		float* phase = &_interpolation[i * _taps_per_phase];
+		double sum = 0;
+		for (int j = 0; j < _taps_per_phase; ++j) {
+			/* Tap j applies to the sample j before the newest */
+			int const k = j * _oversample + i;
+			double const t = (k - (taps - 1) / 2.0) / _oversample;
+			double const sinc = fabs(t) < 1e-9 ? 1 : sin (M_PI * t) / (M_PI * t);
+			double const window = 0.5 - 0.5 * cos (2 * M_PI * (k + 1) / (taps + 1));
+			phase[_taps_per_phase - j - 1] = sinc * window;
+			sum += sinc * window;
+		}
+		/* Give each phase unity gain at DC */
+		double gain = 0;
+		for (int j = 0; j < _taps_per_phase; ++j) {
+			phase[j] /= sum;
+			gain += fabs (phase[j]);
+		}
+		_interpolation_gain = max (_interpolation_gain, static_cast<float> (gain));
+	}
+
+	BOOST_FOREACH (Channel& i, _channels) {
+		i.history.resize (_taps_per_phase * 2, 0);
+	}
+}
+
+void
+LoudnessMeter::process (shared_ptr<const AudioBuffers> buffers)
+{
+	int const channels = min (buffers->channels(), static_cast<int> (_channels.size()));
+
+	int done = 0;
+	while (done < buffers->frames()) {
+		int const this_time = min (buffers->frames() - done, _segment_length - _segment_done);
+		for (int i = 0; i < channels; ++i) {
+			process_channel (_channels[i], buffers->data(i) + done, this_time);
+		}
+
+		done += this_time;
+		_segment_done += this_time;
+		if (_segment_done == _segment_length) {
+			end_segment ();
+		}
+	}
+}
+
+/** Add a sample to a channel's true-peak history.
+ *  @return The last _taps_per_phase samples, oldest first.
+ */
+float const *
+LoudnessMeter::add_to_history (Channel& channel, float sample) const
+{
+	channel.history[channel.history_position] = sample;
+	channel.history[channel.history_position + _taps_per_phase] = sample;
+	channel.history_position = (channel.history_position + 1) % _taps_per_phase;
+	return &channel.history[channel.history_position];
+}
+
+/** Process some samples from one channel, all of which are in the current segment */
+void
+LoudnessMeter::process_channel (Channel& channel, float const * data, int frames)
+{
+	Biquad const & s = _shelf;
+	Biquad const & h = _high_pass;
+
+	double z1s = channel.z1[0];
+	double z2s = channel.z2[0];
+	double z1h = channel.z1[1];
+	double z2h = channel.z2[1];
+	double energy = 0;
+	float sample_peak = 0;
+
+	for (int i = 0; i < frames; ++i) {
+		double const x = data[i];
+
+		/* K-weighting */
+		double const y = s.b0 * x + z1s;
+		z1s = s.b1 * x - s.a1 * y + z2s;
+		z2s = s.b2 * x - s.a2 * y;
+
+		double const k = h.b0 * y + z1h;
+		z1h = h.b1 * y - h.a1 * k + z2h;
+		z2h = h.b2 * y - h.a2 * k;
+
+		energy += k * k;
+		sample_peak = max (sample_peak, fabsf (data[i]));
+	}
+
+	channel.z1[0] = z1s;
+	channel.z2[0] = z2s;
+	channel.z1[1] = z1h;
+	channel.z2[1] = z2h;
+	channel.energy += energy;
+	channel.true_peak = max (channel.true_peak, sample_peak);
+
+	if (_oversample == 1) {
+		return;
+	}
+
+	/* True peak.  Interpolation is expensive, so skip it if no interpolated
+	   sample in this block could be higher than the peak that we already have.
+	*/
+	float history_peak = 0;
+	BOOST_FOREACH (float i, channel.history) {
+		history_peak = max (history_peak, fabsf (i));
+	}
+
+	if (max (sample_peak, history_peak) * _interpolation_gain <= channel.true_peak) {
+		for (int i = max (0, frames - _taps_per_phase); i < frames; ++i) {
+			add_to_history (channel, data[i]);
+		}
+		return;
+	}
+
+	float peak = channel.true_peak;
+	for (int i = 0; i < frames; ++i) {
+		float const * window = add_to_history (channel, data[i]);
+		for (int j = 0; j < _oversample; ++j) {
+			float const * c = &_interpolation[j * _taps_per_phase];
+			float v = 0;
+			for (int m = 0; m < _taps_per_phase; ++m) {
+				v += c[m] * window[m];
+			}
+			peak = max (peak, fabsf (v));
+		}
+	}
+
+	channel.true_peak = peak;
+}
+
+/** Called when a segment (100ms) of audio has been processed; blocks overlap
+ *  by all but one segment, giving 75% overlap for momentary blocks as BS.1770
+ *  requires, and 10 short-term values per second as Tech 3342 requires.
+ */
+void
+LoudnessMeter::end_segment ()
+{
+	double energy = 0;
+	BOOST_FOREACH (Channel& i, _channels) {
+		energy += i.weight * i.energy;
+		i.energy = 0;
+	}
+
+	_segments.push_back (energy);
+	if (static_cast<int>(_segments.size()) > short_term_segments) {
+		_segments.pop_front ();
+	}
+
+	if (static_cast<int>(_segments.size()) >= momentary_segments) {
+		double sum = 0;
+		for (int i = 0; i < momentary_segments; ++i) {
+			sum += _segments[_segments.size() - i - 1];
+		}
+		_momentary.push_back (sum / (momentary_segments * _segment_length));
+	}
+
+	if (static_cast<int>(_segments.size()) == short_term_segments) {
+		double sum = 0;
+		BOOST_FOREACH (double i, _segments) {
+			sum += i;
+		}
+		_short_term.push_back (sum / (short_term_segments * _segment_length));
+	}
+
+	_segment_done = 0;
+}
+
+/** @return Integrated loudness in LUFS, or none if there has not been
+ *  any audio above the absolute gate.
+ */
+optional<float>
+LoudnessMeter::integrated_loudness () const
+{
+	optional<double> ungated = gated_loudness (_momentary, absolute_gate);
+	if (!ungated) {
+		return optional<float> ();
+	}
+
+	optional<double> gated = gated_loudness (_momentary, max (absolute_gate, *ungated + integrated_relative_gate));
+	if (!gated) {
+		return optional<float> ();
+	}
+
+	return *gated;
+}
+
+/** @return Loudness range in LU */
+float
+LoudnessMeter::loudness_range () const
+{
+	optional<double> ungated = gated_loudness (_short_term, absolute_gate);
+	if (!ungated) {
+		return 0;
+	}
+
+	double const threshold = max (absolute_gate, *ungated + range_relative_gate);
+
+	vector<double> values;
+	BOOST_FOREACH (double i, _short_term) {
+		double const l = loudness (i);
+		if (l > threshold) {
+			values.push_back (l);
+		}
+	}
+
+	if (values.size() < 2) {
+		return 0;
+	}
+
+	sort (values.begin(), values.end());
+	int const n = values.size ();
+	return values[lrint((n - 1) * 0.95)] - values[lrint((n - 1) * 0.1)];
+}
+
+/** @return Linear true peak of each channel */
+vector<float>
+LoudnessMeter::true_peaks () const
+{
+	vector<float> p;
+	BOOST_FOREACH (Channel const & i, _channels) {
+		p.push_back (i.true_peak);
+	}
+	return p;
+}
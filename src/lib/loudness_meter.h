@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/loudness_meter.h
+ *  @brief LoudnessMeter class.
+ */
+
+#ifndef DCPOMATIC_LOUDNESS_METER_H
+#define DCPOMATIC_LOUDNESS_METER_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
+#include <deque>
+#include <vector>
+
+class AudioBuffers;
+
+/** @class LoudnessMeter
+ *  @brief Measurer of integrated loudness, loudness range and true peak
+ *  as described by ITU-R BS.1770-4, EBU R128, EBU Tech 3341 and EBU Tech 3342.
+ *
+ *  Audio is passed in with process() and the results may be fetched at any time.
+ *  Channels are assumed to be in DCP order (L, R, C, LFE, Ls, Rs, ...) so that
+ *  they can be weighted correctly.
+ */
+class LoudnessMeter : public boost::noncopyable
+{
+public:
+	LoudnessMeter (int sample_rate, int channels);
+
+	void process (boost::shared_ptr<const AudioBuffers> buffers);
+
+	boost::optional<float> integrated_loudness () const;
+	float loudness_range () const;
+	std::vector<float> true_peaks () const;
+
+private:
+	/** Coefficients of a biquad filter, normalised so that a0 is 1 */
+	struct Biquad
+	{
+		double b0;
+		double b1;
+		double b2;
+		double a1;
+		double a2;
+	};
+
+	struct Channel
+	{
+		Channel ()
+			: weight (1)
+			, energy (0)
+			, history_position (0)
+			, true_peak (0)
+		{
+			for (int i = 0; i < 2; ++i) {
+				z1[i] = z2[i] = 0;
+			}
+		}
+
+		/** Weight given to this channel when summing loudness */
+		double weight;
+		/** State of each of the K-weighting filters (direct form II transposed) */
+		double z1[2];
+		double z2[2];
+		/** Sum of the squares of the K-weighted samples in the current segment */
+		double energy;
+		/** Most recent input samples for true-peak interpolation.  This holds two copies
+		 *  of the same _taps_per_phase samples so that the last _taps_per_phase samples,
+		 *  oldest first, can always be found contiguously at history_position.
+		 */
+		std::vector<float> history;
+		int history_position;
+		/** Highest linear true peak seen so far */
+		float true_peak;
+	};
+
+	void process_channel (Channel& channel, float const * data, int frames);
+	float const * add_to_history (Channel& channel, float sample) const;
+	void end_segment ();
+
+	int _sample_rate;
+	/** First K-weighting stage: a high shelf modelling the acoustic effect of the head */
+	Biquad _shelf;
+	/** Second K-weighting stage: the RLB high-pass */
+	Biquad _high_pass;
+	std::vector<Channel> _channels;
+
+	/** Length of a segment in samples; blocks are made up of whole segments */
+	int _segment_length;
+	/** Number of samples processed in the current segment */
+	int _segment_done;
+	/** Weighted energies of the most recent segments, newest last */
+	std::deque<double> _segments;
+	/** Mean square of each momentary (400ms) block */
+	std::vector<double> _momentary;
+	/** Mean square of each short-term (3s) block */
+	std::vector<double> _short_term;
+
+	/** Oversampling factor used to find true peaks */
+	int _oversample;
+	/** Interpolation filter coefficients; _taps_per_phase for each of the _oversample phases,
+	 *  in the order that they apply to samples from oldest to newest.
+	 */
+	std::vector<float> _interpolation;
+	/** Largest possible ratio of an interpolated sample to the input samples it was made from */
+	float _interpolation_gain;
+
+	static int const _taps_per_phase;
+};
+
+#endif
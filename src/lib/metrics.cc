@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "metrics.h"
+#include <dcp/raw_convert.h>
+
+using std::string;
+using std::map;
+using std::make_pair;
+using dcp::raw_convert;
+
+Metrics* Metrics::_instance = 0;
+
+Metrics *
+Metrics::instance ()
+{
+	if (!_instance) {
+		_instance = new Metrics ();
+	}
+
+	return _instance;
+}
+
+/** @param e true to start recording values, false to stop */
+void
+Metrics::set_enabled (bool e)
+{
+	_enabled = e;
+}
+
+/** Increase a counter, if we are enabled.
+ *  @param name Counter name.
+ *  @param n Amount to add.
+ *  @param server Encode server that this count is for, or empty.
+ */
+void
+Metrics::add (char const* name, int64_t n, string const & server)
+{
+	if (!_enabled) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	Value& v = _values[make_pair(name, server)];
+	v.counter = true;
+	v.value += n;
+}
+
+/** Set a gauge, if we are enabled.
+ *  @param name Gauge name.
+ *  @param value New value.
+ *  @param server Encode server that this value is for, or empty.
+ */
+void
+Metrics::set (char const* name, double value, string const & server)
+{
+	if (!_enabled) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	Value& v = _values[make_pair(name, server)];
+	v.counter = false;
+	v.value = value;
+}
+
+/** @return Current value of a counter or gauge, or 0 if nothing has been recorded for it */
+double
+Metrics::get (string name, string server) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	map<Key, Value>::const_iterator i = _values.find (make_pair(name, server));
+	if (i == _values.end()) {
+		return 0;
+	}
+	return i->second.value;
+}
+
+string
+Metrics::json () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	string json = "{ \"metrics\": [";
+	for (map<Key, Value>::const_iterator i = _values.begin(); i != _values.end(); ++i) {
+		if (i != _values.begin()) {
+			json += ", ";
+		}
+		json += "{ \"name\": \"" + i->first.first + "\", ";
+		json += string("\"type\": \"") + (i->second.counter ? "counter" : "gauge") + "\", ";
+		if (!i->first.second.empty()) {
+			json += "\"server\": \"" + i->first.second + "\", ";
+		}
+		json += "\"value\": " + raw_convert<string>(i->second.value) + " }";
+	}
+	json += "] }";
+
+	return json;
+}
+
+string
+Metrics::prometheus () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	string text;
+	string last_name;
+	for (map<Key, Value>::const_iterator i = _values.begin(); i != _values.end(); ++i) {
+		string const name = "dcpomatic_" + i->first.first;
+		/* Entries are sorted by name, so all the entries for a metric are together */
+		if (i->first.first != last_name) {
+			text += "# TYPE " + name + " " + (i->second.counter ? "counter" : "gauge") + "\n";
+			last_name = i->first.first;
+		}
+		text += name;
+		if (!i->first.second.empty()) {
+			text += "{server=\"" + i->first.second + "\"}";
+		}
+		text += " " + raw_convert<string>(i->second.value) + "\n";
+	}
+
+	return text;
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/metrics.h
+ *  @brief Metrics class.
+ */
+
+#ifndef DCPOMATIC_METRICS_H
+#define DCPOMATIC_METRICS_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+#include <string>
+#include <map>
+
+/** @class Metrics
+ *  @brief A store of counters and gauges describing what the encoding pipeline is doing.
+ *
+ *  Counters only ever increase (so that rates can be derived from them by whoever is
+ *  watching); gauges are set to a current value.  Either can optionally be qualified
+ *  by the name of an encode server.  The contents can be read out as JSON or in the
+ *  Prometheus text exposition format.  Nothing is recorded until set_enabled(true)
+ *  has been called, so that the encoding pipeline does not pay for metrics that
+ *  nobody is reading.
+ */
+class Metrics : public boost::noncopyable
+{
+public:
+	void set_enabled (bool e);
+
+	/** @return true if values are being recorded; this takes no lock */
+	bool enabled () const {
+		return _enabled;
+	}
+
+	void add (char const* name, int64_t n = 1, std::string const & server = "");
+	void set (char const* name, double value, std::string const & server = "");
+
+	double get (std::string name, std::string server = "") const;
+
+	std::string json () const;
+	std::string prometheus () const;
+
+	static Metrics* instance ();
+
+private:
+	Metrics ()
+		: _enabled (false)
+	{}
+
+	struct Value
+	{
+		Value ()
+			: counter (false)
+			, value (0)
+		{}
+
+		bool counter;
+		double value;
+	};
+
+	/** name, server */
+	typedef std::pair<std::string, std::string> Key;
+
+	boost::atomic<bool> _enabled;
+
+	/** mutex to protect _values */
+	mutable boost::mutex _mutex;
+	std::map<Key, Value> _values;
+
+	static Metrics* _instance;
+};
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "types.h"
 #include "frame_rate_change.h"
+#include "dcpomatic_time.h"
 
 class Content;
 class Decoder;
@@ -35,12 +36,27 @@ public:
 		, decoder (d)
 		, frc (f)
 		, done (false)
+		, seek_accurate (true)
+		, index (0)
+		, has_text (false)
 	{}
 
 	boost::shared_ptr<Content> content;
+	/** Our decoder, or 0 if it is not open at the moment */
 	boost::shared_ptr<Decoder> decoder;
 	FrameRateChange frc;
 	bool done;
+	/** Time of the last seek that was asked for; used to set up the decoder when it is opened */
+	ContentTime seek_time;
+	bool seek_accurate;
+	/** Cached value of content->end() */
+	DCPTime end;
+	/** Index of this piece in the Player's list */
+	int index;
+	/** DCP time of the next thing that this piece will emit; valid when it is in the Player's queue */
+	DCPTime next;
+	/** true if this piece has text; valid when it is in the Player's queue */
+	bool has_text;
 };
 
 #endif
@@ -41,6 +41,7 @@
 #include "video_decoder.h"
 #include "audio_decoder.h"
 #include "text_content.h"
+#include "video_content.h"
 #include "text_decoder.h"
 #include "ffmpeg_content.h"
 #include "audio_content.h"
@@ -68,6 +69,7 @@ using std::min;
 using std::vector;
 using std::pair;
 using std::map;
+using std::set;
 using std::make_pair;
 using std::copy;
 using boost::shared_ptr;
@@ -100,7 +102,7 @@ Player::Player (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist
 	   be first.
 	*/
 	_playlist_change_connection = _playlist->Change.connect (bind (&Player::playlist_change, this, _1), boost::signals2::at_front);
-	_playlist_content_change_connection = _playlist->ContentChange.connect (bind(&Player::playlist_content_change, this, _1, _3, _4));
+	_playlist_content_change_connection = _playlist->ContentChange.connect (bind(&Player::playlist_content_change, this, _1, _2, _3, _4));
 	set_video_container_size (_film->frame_size ());
 
 	film_change (CHANGE_TYPE_DONE, Film::AUDIO_PROCESSOR);
@@ -124,13 +126,37 @@ Player::setup_pieces ()
 bool
 have_video (shared_ptr<Piece> piece)
 {
-	return piece->decoder && piece->decoder->video;
+	return static_cast<bool> (piece->content->video);
 }
 
 bool
 have_audio (shared_ptr<Piece> piece)
 {
-	return piece->decoder && piece->decoder->audio;
+	return static_cast<bool> (piece->content->audio);
+}
+
+/** @return How far ahead of the current position we open decoders */
+static DCPTime
+decoder_window ()
+{
+	return DCPTime::from_seconds (1);
+}
+
+/** @return true if we should have a piece for some content */
+bool
+Player::wanted (shared_ptr<const Content> content) const
+{
+	if (!content->paths_valid ()) {
+		return false;
+	}
+
+	if (_ignore_video && _ignore_audio && content->text.empty()) {
+		/* We're only interested in text and this content has none */
+		return false;
+	}
+
+	/* Not something that we can decode; e.g. Atmos content */
+	return can_decode (content);
 }
 
 void
@@ -143,98 +169,285 @@ Player::setup_pieces_unlocked ()
 	_shuffler->Video.connect(bind(&Player::video, this, _1, _2));
 
 	BOOST_FOREACH (shared_ptr<Content> i, _playlist->content ()) {
+		if (wanted (i)) {
+			/* Decoders are opened by open_decoders() shortly before they are needed, so that
+			   we don't have every file in a big playlist open at once.
+			*/
+			_pieces.push_back (shared_ptr<Piece> (new Piece (i, shared_ptr<Decoder>(), FrameRateChange (_film, i))));
+		}
+	}
+
+	_stream_states.clear ();
+	setup_timeline_unlocked ();
 
-		if (!i->paths_valid ()) {
+	_last_video_time = DCPTime ();
+	_last_video_eyes = EYES_BOTH;
+	_last_audio_time = DCPTime ();
+}
+
+/** Make our pieces match the playlist again after some change, keeping any existing
+ *  pieces (with their decoders) that are still valid.
+ *  @param changed Content whose piece must be re-made, or 0.
+ */
+void
+Player::update_pieces_unlocked (shared_ptr<const Content> changed)
+{
+	map<shared_ptr<const Content>, shared_ptr<Piece> > old;
+	BOOST_FOREACH (shared_ptr<Piece> i, _pieces) {
+		old[i->content] = i;
+	}
+
+	_pieces.clear ();
+
+	BOOST_FOREACH (shared_ptr<Content> i, _playlist->content ()) {
+		if (!wanted (i)) {
 			continue;
 		}
 
-		if (_ignore_video && _ignore_audio && i->text.empty()) {
-			/* We're only interested in text and this content has none */
-			continue;
+		map<shared_ptr<const Content>, shared_ptr<Piece> >::const_iterator j = old.find (i);
+		if (j != old.end() && i != changed) {
+			/* The content's position or trim may have changed, so this may be different */
+			j->second->frc = FrameRateChange (_film, i);
+			_pieces.push_back (j->second);
+		} else {
+			_pieces.push_back (shared_ptr<Piece> (new Piece (i, shared_ptr<Decoder>(), FrameRateChange (_film, i))));
 		}
+	}
 
-		shared_ptr<Decoder> decoder = decoder_factory (_film, i, _fast);
-		FrameRateChange frc (_film, i);
+	DCPTime const black = _black.position ();
+	DCPTime const silent = _silent.position ();
+	setup_timeline_unlocked ();
+	_black.set_position (black);
+	_silent.set_position (silent);
+}
 
-		if (!decoder) {
-			/* Not something that we can decode; e.g. Atmos content */
-			continue;
-		}
+/** Set up the things that depend on where our pieces are in the timeline */
+void
+Player::setup_timeline_unlocked ()
+{
+	map<AudioStreamPtr, StreamState> old;
+	swap (old, _stream_states);
 
-		if (decoder->video && _ignore_video) {
-			decoder->video->set_ignore (true);
+	int index = 0;
+	BOOST_FOREACH (shared_ptr<Piece> i, _pieces) {
+		i->end = i->content->end (_film);
+		i->index = index++;
+		if (i->content->audio) {
+			BOOST_FOREACH (AudioStreamPtr j, i->content->audio->streams()) {
+				map<AudioStreamPtr, StreamState>::const_iterator k = old.find (j);
+				if (k != old.end() && k->second.piece == i) {
+					_stream_states[j] = k->second;
+				} else {
+					_stream_states[j] = StreamState (i, i->content->position ());
+				}
+			}
 		}
+	}
+
+	_black = Empty (_film, _pieces, bind(&have_video, _1));
+	_silent = Empty (_film, _pieces, bind(&have_audio, _1));
+
+	_playlist_length = _playlist->length (_film);
+	_film_length = _film->length ();
+
+	setup_queue ();
+}
+
+/** Make a decoder for a piece, connect it up and seek it to wherever the piece was last seeked to */
+void
+Player::open_decoder (shared_ptr<Piece> piece)
+{
+	DCPOMATIC_ASSERT (!piece->decoder);
+
+	shared_ptr<Decoder> decoder = decoder_factory (_film, piece->content, _fast);
+	if (!decoder) {
+		/* e.g. a DCP whose KDM we can't use */
+		piece->done = true;
+		return;
+	}
+
+	if (decoder->video && _ignore_video) {
+		decoder->video->set_ignore (true);
+	}
+
+	if (decoder->audio && _ignore_audio) {
+		decoder->audio->set_ignore (true);
+	}
 
-		if (decoder->audio && _ignore_audio) {
-			decoder->audio->set_ignore (true);
+	if (_ignore_text) {
+		BOOST_FOREACH (shared_ptr<TextDecoder> i, decoder->text) {
+			i->set_ignore (true);
 		}
+	}
 
-		if (_ignore_text) {
-			BOOST_FOREACH (shared_ptr<TextDecoder> i, decoder->text) {
-				i->set_ignore (true);
-			}
+	shared_ptr<DCPDecoder> dcp = dynamic_pointer_cast<DCPDecoder> (decoder);
+	if (dcp) {
+		dcp->set_decode_referenced (_play_referenced);
+		if (_play_referenced) {
+			dcp->set_forced_reduction (_dcp_decode_reduction);
 		}
+	}
 
-		shared_ptr<DCPDecoder> dcp = dynamic_pointer_cast<DCPDecoder> (decoder);
-		if (dcp) {
-			dcp->set_decode_referenced (_play_referenced);
-			if (_play_referenced) {
-				dcp->set_forced_reduction (_dcp_decode_reduction);
-			}
+	if (decoder->video) {
+		if (piece->content->video->frame_type() == VIDEO_FRAME_TYPE_3D_LEFT || piece->content->video->frame_type() == VIDEO_FRAME_TYPE_3D_RIGHT) {
+			/* We need a Shuffler to cope with 3D L/R video data arriving out of sequence */
+			decoder->video->Data.connect (bind (&Shuffler::video, _shuffler, weak_ptr<Piece>(piece), _1));
+		} else {
+			decoder->video->Data.connect (bind (&Player::video, this, weak_ptr<Piece>(piece), _1));
 		}
+	}
 
-		shared_ptr<Piece> piece (new Piece (i, decoder, frc));
-		_pieces.push_back (piece);
+	if (decoder->audio) {
+		decoder->audio->Data.connect (bind (&Player::audio, this, weak_ptr<Piece> (piece), _1, _2));
+	}
 
-		if (decoder->video) {
-			if (i->video->frame_type() == VIDEO_FRAME_TYPE_3D_LEFT || i->video->frame_type() == VIDEO_FRAME_TYPE_3D_RIGHT) {
-				/* We need a Shuffler to cope with 3D L/R video data arriving out of sequence */
-				decoder->video->Data.connect (bind (&Shuffler::video, _shuffler, weak_ptr<Piece>(piece), _1));
-			} else {
-				decoder->video->Data.connect (bind (&Player::video, this, weak_ptr<Piece>(piece), _1));
-			}
+	list<shared_ptr<TextDecoder> >::const_iterator j = decoder->text.begin();
+
+	while (j != decoder->text.end()) {
+		(*j)->BitmapStart.connect (
+			bind(&Player::bitmap_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
+			);
+		(*j)->PlainStart.connect (
+			bind(&Player::plain_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
+			);
+		(*j)->Stop.connect (
+			bind(&Player::subtitle_stop, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
+			);
+
+		++j;
+	}
+
+	piece->decoder = decoder;
+	decoder->seek (piece->seek_time, piece->seek_accurate);
+}
+
+/** Open decoders for any unfinished pieces which will be needed before time + decoder_window() */
+void
+Player::open_decoders (DCPTime time)
+{
+	list<shared_ptr<Piece> > opened;
+	for (set<shared_ptr<Piece>, QueueOrder>::const_iterator i = _queue.begin(); i != _queue.end() && (*i)->next <= (time + decoder_window()); ++i) {
+		if (!(*i)->decoder) {
+			opened.push_back (*i);
 		}
+	}
 
-		if (decoder->audio) {
-			decoder->audio->Data.connect (bind (&Player::audio, this, weak_ptr<Piece> (piece), _1, _2));
+	BOOST_FOREACH (shared_ptr<Piece> i, opened) {
+		/* Opening the decoder may move the piece in the queue */
+		_queue.erase (i);
+		open_decoder (i);
+		if (!i->done) {
+			queue_piece (i);
 		}
+	}
+}
 
-		list<shared_ptr<TextDecoder> >::const_iterator j = decoder->text.begin();
+/** Seek a piece's decoder, or remember where it should be seeked to if it is not open */
+void
+Player::seek_piece (shared_ptr<Piece> piece, ContentTime time, bool accurate)
+{
+	piece->seek_time = time;
+	piece->seek_accurate = accurate;
+	if (piece->decoder) {
+		piece->decoder->seek (time, accurate);
+	}
+}
 
-		while (j != decoder->text.end()) {
-			(*j)->BitmapStart.connect (
-				bind(&Player::bitmap_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
-				);
-			(*j)->PlainStart.connect (
-				bind(&Player::plain_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
-				);
-			(*j)->Stop.connect (
-				bind(&Player::subtitle_stop, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
-				);
+bool
+Player::QueueOrder::operator() (shared_ptr<const Piece> a, shared_ptr<const Piece> b) const
+{
+	if (a->next != b->next) {
+		return a->next < b->next;
+	}
 
-			++j;
-		}
+	if (a->has_text != b->has_text) {
+		return a->has_text;
 	}
 
-	_stream_states.clear ();
+	return a->index < b->index;
+}
+
+/** Put all unfinished pieces into _queue */
+void
+Player::setup_queue ()
+{
+	_queue.clear ();
 	BOOST_FOREACH (shared_ptr<Piece> i, _pieces) {
-		if (i->content->audio) {
-			BOOST_FOREACH (AudioStreamPtr j, i->content->audio->streams()) {
-				_stream_states[j] = StreamState (i, i->content->position ());
-			}
+		if (!i->done) {
+			queue_piece (i);
 		}
 	}
+}
 
-	_black = Empty (_film, _pieces, bind(&have_video, _1));
-	_silent = Empty (_film, _pieces, bind(&have_audio, _1));
+/** Add a piece which is not in _queue to it, or mark it as done if it has nothing more to emit */
+void
+Player::queue_piece (shared_ptr<Piece> piece)
+{
+	piece->next = piece_position (piece);
+	if (piece->next > piece->end) {
+		piece->done = true;
+		piece->decoder.reset ();
+		return;
+	}
 
-	_last_video_time = DCPTime ();
-	_last_video_eyes = EYES_BOTH;
-	_last_audio_time = DCPTime ();
+	piece->has_text = piece->decoder ? !piece->decoder->text.empty() : !piece->content->text.empty();
+	_queue.insert (piece);
+}
+
+/** @return DCP time of the next thing that this piece will emit */
+DCPTime
+Player::piece_position (shared_ptr<const Piece> piece) const
+{
+	ContentTime const t = piece->decoder ? piece->decoder->position() : piece->seek_time;
+	return content_time_to_dcp (piece, max(t, piece->content->trim_start()));
+}
+
+/** @return true if a change to the given content property will only affect the
+ *  way that data from the content's decoder is processed by the Player.  A change
+ *  of text type is not in this list as the piece's decoders must be re-made.
+ */
+static bool
+output_only (int property)
+{
+	return
+		property == VideoContentProperty::CROP ||
+		property == VideoContentProperty::SCALE ||
+		property == VideoContentProperty::COLOUR_CONVERSION ||
+		property == VideoContentProperty::FADE_IN ||
+		property == VideoContentProperty::FADE_OUT ||
+		property == AudioContentProperty::GAIN ||
+		(property >= TextContentProperty::X_OFFSET && property <= TextContentProperty::OUTLINE_WIDTH) ||
+		property == TextContentProperty::DCP_TRACK ||
+		property == DCPContentProperty::NAME;
+}
+
+/** @return true if a change to the given content property will only move the content
+ *  in the timeline, without changing what its decoder produces.
+ */
+static bool
+timing_only (int property)
+{
+	return
+		property == ContentProperty::POSITION ||
+		property == ContentProperty::LENGTH ||
+		property == ContentProperty::TRIM_START ||
+		property == ContentProperty::TRIM_END;
 }
 
 void
-Player::playlist_content_change (ChangeType type, int property, bool frequent)
+Player::update_pieces (shared_ptr<const Content> changed, int property)
+{
+	if (output_only (property)) {
+		/* Nothing to do here */
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	update_pieces_unlocked (timing_only(property) ? shared_ptr<const Content>() : changed);
+}
+
+void
+Player::playlist_content_change (ChangeType type, weak_ptr<Content> content, int property, bool frequent)
 {
 	if (type == CHANGE_TYPE_PENDING) {
 		/* The player content is probably about to change, so we can't carry on
@@ -243,8 +456,13 @@ Player::playlist_content_change (ChangeType type, int property, bool frequent)
 		*/
 		++_suspended;
 	} else if (type == CHANGE_TYPE_DONE) {
-		/* A change in our content has gone through.  Re-build our pieces. */
-		setup_pieces ();
+		/* A change in our content has gone through.  Re-build whichever of our pieces need it. */
+		shared_ptr<Content> c = content.lock ();
+		if (c) {
+			update_pieces (c, property);
+		} else {
+			setup_pieces ();
+		}
 		--_suspended;
 	} else if (type == CHANGE_TYPE_CANCELLED) {
 		--_suspended;
@@ -280,7 +498,9 @@ void
 Player::playlist_change (ChangeType type)
 {
 	if (type == CHANGE_TYPE_DONE) {
-		setup_pieces ();
+		/* Content has been added, removed or re-ordered; keep the pieces that we can */
+		boost::mutex::scoped_lock lm (_mutex);
+		update_pieces_unlocked (shared_ptr<const Content>());
 	}
 	Change (type, PlayerProperty::PLAYLIST, false);
 }
@@ -555,7 +775,7 @@ Player::pass ()
 		return false;
 	}
 
-	if (_playlist->length(_film) == DCPTime()) {
+	if (_playlist_length == DCPTime()) {
 		/* Special case of an empty Film; just give one black frame */
 		emit_video (black_player_video_frame(EYES_BOTH), DCPTime());
 		return true;
@@ -566,24 +786,9 @@ Player::pass ()
 	shared_ptr<Piece> earliest_content;
 	optional<DCPTime> earliest_time;
 
-	BOOST_FOREACH (shared_ptr<Piece> i, _pieces) {
-		if (i->done) {
-			continue;
-		}
-
-		DCPTime const t = content_time_to_dcp (i, max(i->decoder->position(), i->content->trim_start()));
-		if (t > i->content->end(_film)) {
-			i->done = true;
-		} else {
-
-			/* Given two choices at the same time, pick the one with texts so we see it before
-			   the video.
-			*/
-			if (!earliest_time || t < *earliest_time || (t == *earliest_time && !i->decoder->text.empty())) {
-				earliest_time = t;
-				earliest_content = i;
-			}
-		}
+	if (!_queue.empty ()) {
+		earliest_content = *_queue.begin ();
+		earliest_time = earliest_content->next;
 	}
 
 	bool done = false;
@@ -609,10 +814,26 @@ Player::pass ()
 		which = SILENT;
 	}
 
+	if (earliest_time) {
+		open_decoders (*earliest_time);
+	}
+
 	switch (which) {
 	case CONTENT:
 	{
+		if (!earliest_content->decoder) {
+			/* We failed to open it */
+			break;
+		}
+		/* Passing will change this piece's position, so take it out of the queue while we do it */
+		_queue.erase (earliest_content);
 		earliest_content->done = earliest_content->decoder->pass ();
+		if (earliest_content->done) {
+			/* Close the decoder now that we don't need it */
+			earliest_content->decoder.reset ();
+		} else {
+			queue_piece (earliest_content);
+		}
 		shared_ptr<DCPContent> dcp = dynamic_pointer_cast<DCPContent>(earliest_content->content);
 		if (dcp && !_play_referenced && dcp->reference_audio()) {
 			/* We are skipping some referenced DCP audio content, so we need to update _last_audio_time
@@ -662,7 +883,7 @@ Player::pass ()
 	/* Work out the time before which the audio is definitely all here.  This is the earliest last_push_end of one
 	   of our streams, or the position of the _silent.
 	*/
-	DCPTime pull_to = _film->length ();
+	DCPTime pull_to = _film_length;
 	for (map<AudioStreamPtr, StreamState>::const_iterator i = _stream_states.begin(); i != _stream_states.end(); ++i) {
 		if (!i->second.piece->done && i->second.last_push_end < pull_to) {
 			pull_to = i->second.last_push_end;
@@ -772,7 +993,7 @@ Player::video (weak_ptr<Piece> wp, ContentVideo video)
 	/* Fill gaps that we discover now that we have some video which needs to be emitted.
 	   This is where we need to fill to.
 	*/
-	DCPTime fill_to = min (time, piece->content->end(_film));
+	DCPTime fill_to = min (time, piece->end);
 
 	if (_last_video_time) {
 		DCPTime fill_from = max (*_last_video_time, piece->content->position());
@@ -785,7 +1006,7 @@ Player::video (weak_ptr<Piece> wp, ContentVideo video)
 				if (fill_to_eyes == EYES_BOTH) {
 					fill_to_eyes = EYES_LEFT;
 				}
-				if (fill_to == piece->content->end(_film)) {
+				if (fill_to == piece->end) {
 					/* Don't fill after the end of the content */
 					fill_to_eyes = EYES_LEFT;
 				}
@@ -838,7 +1059,7 @@ Player::video (weak_ptr<Piece> wp, ContentVideo video)
 
 	DCPTime t = time;
 	for (int i = 0; i < frc.repeat; ++i) {
-		if (t < piece->content->end(_film)) {
+		if (t < piece->end) {
 			emit_video (_last_video[wp], t);
 		}
 		t += one_video_frame ();
@@ -874,11 +1095,11 @@ Player::audio (weak_ptr<Piece> wp, AudioStreamPtr stream, ContentAudio content_a
 		}
 		content_audio.audio = cut.first;
 		time = cut.second;
-	} else if (time > piece->content->end(_film)) {
+	} else if (time > piece->end) {
 		/* Discard it all */
 		return;
-	} else if (end > piece->content->end(_film)) {
-		Frame const remaining_frames = DCPTime(piece->content->end(_film) - time).frames_round(rfr);
+	} else if (end > piece->end) {
+		Frame const remaining_frames = DCPTime(piece->end - time).frames_round(rfr);
 		if (remaining_frames == 0) {
 			return;
 		}
@@ -964,7 +1185,7 @@ Player::plain_text_start (weak_ptr<Piece> wp, weak_ptr<const TextContent> wc, Co
 	PlayerText ps;
 	DCPTime const from (content_time_to_dcp (piece, subtitle.from()));
 
-	if (from > piece->content->end(_film)) {
+	if (from > piece->end) {
 		return;
 	}
 
@@ -1015,7 +1236,7 @@ Player::subtitle_stop (weak_ptr<Piece> wp, weak_ptr<const TextContent> wc, Conte
 
 	DCPTime const dcp_to = content_time_to_dcp (piece, to);
 
-	if (dcp_to > piece->content->end(_film)) {
+	if (dcp_to > piece->end) {
 		return;
 	}
 
@@ -1054,19 +1275,27 @@ Player::seek (DCPTime time, bool accurate)
 
 	BOOST_FOREACH (shared_ptr<Piece> i, _pieces) {
 		if (time < i->content->position()) {
-			/* Before; seek to the start of the content */
-			i->decoder->seek (dcp_to_content_time (i, i->content->position()), accurate);
+			/* Before; seek to the start of the content, closing its decoder if
+			   we won't need it for a while.
+			*/
+			if (i->content->position() > (time + decoder_window())) {
+				i->decoder.reset ();
+			}
+			seek_piece (i, dcp_to_content_time (i, i->content->position()), accurate);
 			i->done = false;
-		} else if (i->content->position() <= time && time < i->content->end(_film)) {
+		} else if (i->content->position() <= time && time < i->end) {
 			/* During; seek to position */
-			i->decoder->seek (dcp_to_content_time (i, time), accurate);
+			seek_piece (i, dcp_to_content_time (i, time), accurate);
 			i->done = false;
 		} else {
 			/* After; this piece is done */
 			i->done = true;
+			i->decoder.reset ();
 		}
 	}
 
+	setup_queue ();
+
 	if (accurate) {
 		_last_video_time = time;
 		_last_video_eyes = EYES_LEFT;
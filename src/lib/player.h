@@ -37,6 +37,7 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/atomic.hpp>
 #include <list>
+#include <set>
 
 namespace dcp {
 	class ReelAsset;
@@ -108,13 +109,26 @@ private:
 	friend struct player_subframe_test;
 	friend struct empty_test1;
 	friend struct empty_test2;
+	friend struct player_decoder_lifetime_test;
+	friend struct player_incremental_update_test;
+	friend struct player_text_type_change_test;
 
 	void setup_pieces ();
 	void setup_pieces_unlocked ();
+	void update_pieces (boost::shared_ptr<const Content> changed, int property);
+	void update_pieces_unlocked (boost::shared_ptr<const Content> changed);
+	void setup_timeline_unlocked ();
+	bool wanted (boost::shared_ptr<const Content> content) const;
+	void open_decoder (boost::shared_ptr<Piece> piece);
+	void open_decoders (DCPTime time);
+	void seek_piece (boost::shared_ptr<Piece> piece, ContentTime time, bool accurate);
+	DCPTime piece_position (boost::shared_ptr<const Piece> piece) const;
+	void setup_queue ();
+	void queue_piece (boost::shared_ptr<Piece> piece);
 	void flush ();
 	void film_change (ChangeType, Film::Property);
 	void playlist_change (ChangeType);
-	void playlist_content_change (ChangeType, int, bool);
+	void playlist_content_change (ChangeType, boost::weak_ptr<Content>, int, bool);
 	Frame dcp_to_content_video (boost::shared_ptr<const Piece> piece, DCPTime t) const;
 	DCPTime content_video_to_dcp (boost::shared_ptr<const Piece> piece, Frame f) const;
 	Frame dcp_to_resampled_audio (boost::shared_ptr<const Piece> piece, DCPTime t) const;
@@ -150,6 +164,21 @@ private:
 	boost::atomic<int> _suspended;
 	std::list<boost::shared_ptr<Piece> > _pieces;
 
+	/** Orders pieces by the time of the next thing that they will emit.  When there is a tie
+	 *  pieces with text come first, so that we see the text before the video it goes with.
+	 */
+	struct QueueOrder
+	{
+		bool operator() (boost::shared_ptr<const Piece> a, boost::shared_ptr<const Piece> b) const;
+	};
+
+	/** Pieces which are not done, in the order that they should be passed */
+	std::set<boost::shared_ptr<Piece>, QueueOrder> _queue;
+	/** Cached result of _playlist->length() */
+	DCPTime _playlist_length;
+	/** Cached result of _film->length() */
+	DCPTime _film_length;
+
 	/** Size of the image in the DCP (e.g. 1990x1080 for flat) */
 	dcp::Size _video_container_size;
 	boost::shared_ptr<Image> _black_image;
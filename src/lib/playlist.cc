@@ -19,6 +19,7 @@
 */
 
 #include "playlist.h"
+#include "playlist_timeline.h"
 #include "video_content.h"
 #include "text_content.h"
 #include "ffmpeg_decoder.h"
@@ -37,6 +38,7 @@
 #include <boost/bind/placeholders.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <iostream>
 
 #include "i18n.h"
@@ -48,6 +50,9 @@ using std::min;
 using std::max;
 using std::string;
 using std::pair;
+using std::make_pair;
+using std::upper_bound;
+using std::stable_sort;
 using boost::optional;
 using boost::shared_ptr;
 using boost::weak_ptr;
@@ -57,7 +62,8 @@ using namespace boost::placeholders;
 #endif
 
 Playlist::Playlist ()
-	: _sequence (true)
+	: _timeline_version (0)
+	, _sequence (true)
 	, _sequencing (false)
 {
 
@@ -73,6 +79,12 @@ Playlist::~Playlist ()
 void
 Playlist::content_change (weak_ptr<const Film> weak_film, ChangeType type, weak_ptr<Content> content, int property, bool frequent)
 {
+	if (type == CHANGE_TYPE_DONE) {
+		/* This must happen before anybody hears about the change */
+		boost::mutex::scoped_lock lm (_mutex);
+		invalidate_timeline ();
+	}
+
 	/* Make sure we only hear about atomic changes (e.g. a PENDING always with the DONE/CANCELLED)
 	   Ignore any DONE/CANCELLED that arrives without a PENDING.
 	*/
@@ -111,6 +123,7 @@ Playlist::content_change (weak_ptr<const Film> weak_film, ChangeType type, weak_
 				ContentList old = _content;
 				sort (_content.begin(), _content.end(), ContentSorter ());
 				changed = _content != old;
+				invalidate_timeline ();
 			}
 
 			if (changed) {
@@ -256,6 +269,7 @@ Playlist::set_from_xml (shared_ptr<const Film> film, cxml::ConstNodePtr node, in
 
 	/* This shouldn't be necessary but better safe than sorry (there could be old files) */
 	sort (_content.begin(), _content.end(), ContentSorter ());
+	invalidate_timeline ();
 
 	reconnect (film);
 }
@@ -267,7 +281,7 @@ void
 Playlist::as_xml (xmlpp::Node* node, bool with_content_paths)
 {
 	BOOST_FOREACH (shared_ptr<Content> i, content()) {
-		i->as_xml (node->add_child ("Content"), with_content_paths);
+		i->as_xml_cached (node->add_child ("Content"), with_content_paths);
 	}
 }
 
@@ -280,6 +294,24 @@ Playlist::add (shared_ptr<const Film> film, shared_ptr<Content> c)
 		boost::mutex::scoped_lock lm (_mutex);
 		_content.push_back (c);
 		sort (_content.begin(), _content.end(), ContentSorter ());
+		invalidate_timeline ();
+		reconnect (film);
+	}
+
+	Change (CHANGE_TYPE_DONE);
+}
+
+/** Add several pieces of content with a single change */
+void
+Playlist::add (shared_ptr<const Film> film, ContentList c)
+{
+	Change (CHANGE_TYPE_PENDING);
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_content.insert (_content.end(), c.begin(), c.end());
+		sort (_content.begin(), _content.end(), ContentSorter ());
+		invalidate_timeline ();
 		reconnect (film);
 	}
 
@@ -303,6 +335,7 @@ Playlist::remove (shared_ptr<Content> c)
 
 		if (i != _content.end()) {
 			_content.erase (i);
+			invalidate_timeline ();
 		} else {
 			cancelled = true;
 		}
@@ -335,6 +368,8 @@ Playlist::remove (ContentList c)
 				_content.erase (j);
 			}
 		}
+
+		invalidate_timeline ();
 	}
 
 	/* This won't change order, so it does not need a sort */
@@ -415,29 +450,97 @@ Playlist::best_video_frame_rate () const
 DCPTime
 Playlist::length (shared_ptr<const Film> film) const
 {
-	DCPTime len;
-	BOOST_FOREACH (shared_ptr<const Content> i, content()) {
-		len = max (len, i->end(film));
-	}
-
-	return len;
+	return timeline(film)->length();
 }
 
 /** @return position of the first thing on the playlist, if it's not empty */
 optional<DCPTime>
 Playlist::start () const
 {
-	ContentList cont = content ();
-	if (cont.empty()) {
-		return optional<DCPTime> ();
+	return positions()->start;
+}
+
+/** Must be called with a lock held on _mutex */
+void
+Playlist::invalidate_timeline ()
+{
+	++_timeline_version;
+	boost::atomic_store (&_timeline, shared_ptr<const PlaylistTimeline>());
+	boost::atomic_store (&_positions, shared_ptr<const Positions>());
+}
+
+/** @return Snapshot of where our content is in the DCP.  This is made when it is first
+ *  asked for after a change, and shared until the next change.
+ */
+shared_ptr<const PlaylistTimeline>
+Playlist::timeline (shared_ptr<const Film> film) const
+{
+	shared_ptr<const PlaylistTimeline> t = boost::atomic_load (&_timeline);
+	if (t && t->valid_for (film)) {
+		return t;
+	}
+
+	int version;
+	ContentList cont;
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		version = _timeline_version;
+		cont = _content;
 	}
 
-	DCPTime start = DCPTime::max ();
+	/* This must be done without a lock on _mutex as it will end up calling
+	   active_frame_rate_change().
+	*/
+	t.reset (new PlaylistTimeline (film, cont));
+
+	boost::mutex::scoped_lock lm (_mutex);
+	if (version == _timeline_version) {
+		/* Nothing changed while we were working */
+		boost::atomic_store (&_timeline, t);
+	}
+
+	return t;
+}
+
+static bool
+earlier_position (pair<DCPTime, optional<double> > const & a, pair<DCPTime, optional<double> > const & b)
+{
+	return a.first < b.first;
+}
+
+shared_ptr<const Playlist::Positions>
+Playlist::positions () const
+{
+	shared_ptr<const Positions> p = boost::atomic_load (&_positions);
+	if (p) {
+		return p;
+	}
+
+	int version;
+	ContentList cont;
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		version = _timeline_version;
+		cont = _content;
+	}
+
+	shared_ptr<Positions> n (new Positions);
 	BOOST_FOREACH (shared_ptr<Content> i, cont) {
-		start = min (start, i->position ());
+		n->start = n->start ? min (*n->start, i->position()) : i->position();
+		if (i->video) {
+			n->video.push_back (make_pair (i->position(), i->video_frame_rate()));
+		}
+	}
+
+	/* _content should already be in position order, but it might not have been re-sorted yet after a change */
+	stable_sort (n->video.begin(), n->video.end(), earlier_position);
+
+	boost::mutex::scoped_lock lm (_mutex);
+	if (version == _timeline_version) {
+		boost::atomic_store (&_positions, shared_ptr<const Positions> (n));
 	}
 
-	return start;
+	return n;
 }
 
 /** Must be called with a lock held on _mutex */
@@ -465,52 +568,37 @@ Playlist::reconnect (shared_ptr<const Film> film)
 DCPTime
 Playlist::video_end (shared_ptr<const Film> film) const
 {
-	DCPTime end;
-	BOOST_FOREACH (shared_ptr<Content> i, content()) {
-		if (i->video) {
-			end = max (end, i->end(film));
-		}
-	}
-
-	return end;
+	return timeline(film)->video_end();
 }
 
 DCPTime
 Playlist::text_end (shared_ptr<const Film> film) const
 {
-	DCPTime end;
-	BOOST_FOREACH (shared_ptr<Content> i, content()) {
-		if (!i->text.empty ()) {
-			end = max (end, i->end(film));
-		}
-	}
+	return timeline(film)->text_end();
+}
 
-	return end;
+static bool
+position_after (DCPTime t, pair<DCPTime, optional<double> > const & v)
+{
+	return t < v.first;
 }
 
 FrameRateChange
 Playlist::active_frame_rate_change (DCPTime t, int dcp_video_frame_rate) const
 {
-	ContentList cont = content ();
-	for (ContentList::const_reverse_iterator i = cont.rbegin(); i != cont.rend(); ++i) {
-		if (!(*i)->video) {
-			continue;
-		}
-
-		if ((*i)->position() <= t) {
-			/* This is the first piece of content (going backwards...) that starts before t,
-			   so it's the active one.
-			*/
-			if ((*i)->video_frame_rate ()) {
-				/* This content specified a rate, so use it */
-				return FrameRateChange ((*i)->video_frame_rate().get(), dcp_video_frame_rate);
-			} else {
-				/* No specified rate so just use the DCP one */
-				return FrameRateChange (dcp_video_frame_rate, dcp_video_frame_rate);
-			}
+	shared_ptr<const Positions> pos = positions ();
+
+	/* Find the last piece of video content that starts at or before t; that's the active one */
+	vector<pair<DCPTime, optional<double> > >::const_iterator i = upper_bound (pos->video.begin(), pos->video.end(), t, position_after);
+	if (i != pos->video.begin()) {
+		--i;
+		if (i->second) {
+			/* This content specified a rate, so use it */
+			return FrameRateChange (i->second.get(), dcp_video_frame_rate);
 		}
 	}
 
+	/* No specified rate so just use the DCP one */
 	return FrameRateChange (dcp_video_frame_rate, dcp_video_frame_rate);
 }
 
@@ -573,6 +661,7 @@ Playlist::repeat (shared_ptr<const Film> film, ContentList c, int n)
 		}
 
 		sort (_content.begin(), _content.end(), ContentSorter ());
+		invalidate_timeline ();
 		reconnect (film);
 	}
 
@@ -653,19 +742,19 @@ Playlist::content_summary (shared_ptr<const Film> film, DCPTimePeriod period) co
 {
 	string best_summary;
 	int best_score = -1;
-	BOOST_FOREACH (shared_ptr<Content> i, content()) {
+	BOOST_FOREACH (PlaylistTimeline::Entry const & i, timeline(film)->entries()) {
 		int score = 0;
-		optional<DCPTimePeriod> const o = DCPTimePeriod(i->position(), i->end(film)).overlap (period);
+		optional<DCPTimePeriod> const o = i.period.overlap (period);
 		if (o) {
 			score += 100 * o.get().duration().get() / period.duration().get();
 		}
 
-		if (i->video) {
+		if (i.content->video) {
 			score += 100;
 		}
 
 		if (score > best_score) {
-			best_summary = i->path(0).leaf().string();
+			best_summary = i.content->path(0).leaf().string();
 			best_score = score;
 		}
 	}
@@ -30,6 +30,7 @@
 #include <list>
 
 class Film;
+class PlaylistTimeline;
 
 struct ContentSorter
 {
@@ -50,6 +51,7 @@ public:
 	void set_from_xml (boost::shared_ptr<const Film> film, cxml::ConstNodePtr node, int version, std::list<std::string>& notes);
 
 	void add (boost::shared_ptr<const Film> film, boost::shared_ptr<Content>);
+	void add (boost::shared_ptr<const Film> film, ContentList);
 	void remove (boost::shared_ptr<Content>);
 	void remove (ContentList);
 	void move_earlier (boost::shared_ptr<const Film> film, boost::shared_ptr<Content>);
@@ -75,6 +77,8 @@ public:
 
 	void repeat (boost::shared_ptr<const Film> film, ContentList, int);
 
+	boost::shared_ptr<const PlaylistTimeline> timeline (boost::shared_ptr<const Film> film) const;
+
 	/** Emitted when content has been added to or removed from the playlist; implies OrderChanged */
 	mutable boost::signals2::signal<void (ChangeType)> Change;
 	mutable boost::signals2::signal<void ()> OrderChanged;
@@ -85,10 +89,29 @@ private:
 	void content_change (boost::weak_ptr<const Film>, ChangeType, boost::weak_ptr<Content>, int, bool);
 	void disconnect ();
 	void reconnect (boost::shared_ptr<const Film> film);
+	void invalidate_timeline ();
+
+	/** Information about the positions of our content which does not depend on a Film */
+	struct Positions
+	{
+		/** Position and video frame rate of each piece of video content, in position order */
+		std::vector<std::pair<DCPTime, boost::optional<double> > > video;
+		boost::optional<DCPTime> start;
+	};
+
+	boost::shared_ptr<const Positions> positions () const;
 
 	mutable boost::mutex _mutex;
 	/** List of content.  Kept sorted in position order. */
 	ContentList _content;
+	/** Incremented (with _mutex held) whenever anything happens which might change our timeline */
+	int _timeline_version;
+	/** Our timeline, or 0 if it has not been made since the last change.  This is set with _mutex held
+	 *  but may be read at any time using boost::atomic_load.
+	 */
+	mutable boost::shared_ptr<const PlaylistTimeline> _timeline;
+	/** As for _timeline */
+	mutable boost::shared_ptr<const Positions> _positions;
 	bool _sequence;
 	bool _sequencing;
 	std::list<boost::signals2::connection> _content_connections;
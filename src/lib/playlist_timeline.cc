@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "playlist_timeline.h"
+#include "content.h"
+#include "film.h"
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+using std::max;
+using std::min;
+using boost::shared_ptr;
+using boost::optional;
+
+static bool
+earlier (PlaylistTimeline::Entry const & a, PlaylistTimeline::Entry const & b)
+{
+	return a.period.from < b.period.from;
+}
+
+PlaylistTimeline::PlaylistTimeline (shared_ptr<const Film> film, ContentList content)
+	: _film (film.get())
+	, _video_frame_rate (film->video_frame_rate())
+	, _audio_frame_rate (film->audio_frame_rate())
+{
+	BOOST_FOREACH (shared_ptr<Content> i, content) {
+		DCPTimePeriod const p (i->position(), i->end(film));
+		_entries.push_back (Entry (i, p));
+
+		_length = max (_length, p.to);
+		_start = _start ? min (*_start, p.from) : p.from;
+		if (i->video) {
+			_video_end = max (_video_end, p.to);
+		}
+		if (!i->text.empty()) {
+			_text_end = max (_text_end, p.to);
+		}
+	}
+
+	std::stable_sort (_entries.begin(), _entries.end(), earlier);
+}
+
+/** @return true if this timeline is still right for a given film, assuming that the playlist has not changed */
+bool
+PlaylistTimeline::valid_for (shared_ptr<const Film> film) const
+{
+	return film.get() == _film && film->video_frame_rate() == _video_frame_rate && film->audio_frame_rate() == _audio_frame_rate;
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DCPOMATIC_PLAYLIST_TIMELINE_H
+#define DCPOMATIC_PLAYLIST_TIMELINE_H
+
+#include "types.h"
+#include "dcpomatic_time.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <vector>
+
+class Film;
+
+/** @class PlaylistTimeline
+ *  @brief A snapshot of where each piece of a Playlist's content is in the DCP.
+ *
+ *  A snapshot is never changed once it has been made; Playlist makes a new one when it is
+ *  asked about its timeline after a change, and hands the same one out to any thread which
+ *  asks until the next change.
+ */
+class PlaylistTimeline : public boost::noncopyable
+{
+public:
+	PlaylistTimeline (boost::shared_ptr<const Film> film, ContentList content);
+
+	bool valid_for (boost::shared_ptr<const Film> film) const;
+
+	/** @return time of the end of the last thing on the playlist */
+	DCPTime length () const {
+		return _length;
+	}
+
+	/** @return position of the first thing on the playlist, if it's not empty */
+	boost::optional<DCPTime> start () const {
+		return _start;
+	}
+
+	/** @return time of the end of the last video content on the playlist */
+	DCPTime video_end () const {
+		return _video_end;
+	}
+
+	/** @return time of the end of the last text content on the playlist */
+	DCPTime text_end () const {
+		return _text_end;
+	}
+
+	class Entry
+	{
+	public:
+		Entry (boost::shared_ptr<Content> c, DCPTimePeriod p)
+			: content (c)
+			, period (p)
+		{}
+
+		boost::shared_ptr<Content> content;
+		DCPTimePeriod period;
+	};
+
+	/** @return entries in order of their start time */
+	std::vector<Entry> const & entries () const {
+		return _entries;
+	}
+
+private:
+	const Film* _film;
+	int _video_frame_rate;
+	int _audio_frame_rate;
+	std::vector<Entry> _entries;
+	DCPTime _length;
+	boost::optional<DCPTime> _start;
+	DCPTime _video_end;
+	DCPTime _text_end;
+};
+
+#endif
@@ -79,7 +79,10 @@ void
 SendKDMEmailJob::run ()
 {
 	set_progress_unknown ();
-	CinemaKDMs::email (_cinema_kdms, _container_name_format, _filename_format, _name_values, _cpl_name);
+	CinemaKDMs::email (
+		_cinema_kdms, _container_name_format, _filename_format, _name_values, _cpl_name,
+		boost::bind (&Job::set_progress, this, _1, false)
+		);
 	set_progress (1);
 	set_state (FINISHED_OK);
 }
@@ -44,6 +44,10 @@ public:
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_NETWORK;
+	}
+
 private:
 	dcp::NameFormat _container_name_format;
 	dcp::NameFormat _filename_format;
@@ -30,6 +30,10 @@ public:
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_NETWORK;
+	}
+
 private:
 	std::string _body;
 };
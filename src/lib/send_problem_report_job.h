@@ -37,6 +37,10 @@ public:
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_NETWORK;
+	}
+
 private:
 	void add_file (std::string& body, boost::filesystem::path file) const;
 
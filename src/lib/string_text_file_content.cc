@@ -61,6 +61,7 @@ StringTextFileContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job
 	boost::mutex::scoped_lock lm (_mutex);
 	_length = s.length ();
 	only_text()->add_font (shared_ptr<Font> (new Font (TEXT_FONT_ID)));
+	invalidate_xml_cache ();
 }
 
 string
@@ -421,6 +421,7 @@ TextContent::add_font (shared_ptr<Font> font)
 {
 	_fonts.push_back (font);
 	connect_to_fonts ();
+	_parent->invalidate_xml_cache ();
 }
 
 void
@@ -0,0 +1,170 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "trace.h"
+#include "cross.h"
+#include "exceptions.h"
+#include <sys/time.h>
+#include <map>
+#include <cstdio>
+#include <cerrno>
+#include <inttypes.h>
+
+using std::map;
+
+Trace* Trace::_instance = 0;
+/** Number of events that we keep; each is around 40 bytes */
+size_t const Trace::_size = 262144;
+
+Trace::Trace ()
+	: _enabled (false)
+	, _next (0)
+	, _full (false)
+{
+
+}
+
+Trace *
+Trace::instance ()
+{
+	if (!_instance) {
+		_instance = new Trace ();
+	}
+
+	return _instance;
+}
+
+void
+Trace::set_enabled (bool e)
+{
+	if (e) {
+		boost::mutex::scoped_lock lm (_mutex);
+		if (_events.empty()) {
+			_events.resize (_size);
+		}
+	}
+
+	_enabled = e;
+}
+
+void
+Trace::begin (char const* name, int64_t frame)
+{
+	if (_enabled) {
+		add (name, PHASE_BEGIN, frame);
+	}
+}
+
+void
+Trace::end (char const* name, int64_t frame)
+{
+	if (_enabled) {
+		add (name, PHASE_END, frame);
+	}
+}
+
+void
+Trace::counter (char const* name, int64_t value)
+{
+	if (_enabled) {
+		add (name, PHASE_COUNTER, value);
+	}
+}
+
+void
+Trace::add (char const* name, Phase phase, int64_t value)
+{
+	struct timeval tv;
+	gettimeofday (&tv, 0);
+	uint64_t const thread = thread_id ();
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	Event& e = _events[_next];
+	e.name = name;
+	e.phase = phase;
+	e.time = static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+	e.thread = thread;
+	e.value = value;
+
+	++_next;
+	if (_next == _events.size()) {
+		_next = 0;
+		_full = true;
+	}
+}
+
+void
+Trace::clear ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_next = 0;
+	_full = false;
+}
+
+/** Write the events that we have in Chrome's trace-event JSON format */
+void
+Trace::write (boost::filesystem::path file) const
+{
+	FILE* f = fopen_boost (file, "w");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	/* Give threads small numbers as their IDs, in the order that we first see them */
+	map<uint64_t, int> threads;
+
+	fprintf (f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	size_t const N = _full ? _events.size() : _next;
+	size_t const first = _full ? _next : 0;
+	for (size_t i = 0; i < N; ++i) {
+		Event const & e = _events[(first + i) % _events.size()];
+
+		map<uint64_t, int>::const_iterator t = threads.find (e.thread);
+		int tid;
+		if (t == threads.end()) {
+			tid = threads.size() + 1;
+			threads[e.thread] = tid;
+		} else {
+			tid = t->second;
+		}
+
+		fprintf (f, "%s{\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%" PRId64 ",", i == 0 ? "" : ",\n", e.name, tid, e.time);
+		switch (e.phase) {
+		case PHASE_BEGIN:
+		case PHASE_END:
+			fprintf (f, "\"ph\":\"%s\"", e.phase == PHASE_BEGIN ? "B" : "E");
+			if (e.value >= 0) {
+				fprintf (f, ",\"args\":{\"frame\":%" PRId64 "}", e.value);
+			}
+			break;
+		case PHASE_COUNTER:
+			fprintf (f, "\"ph\":\"C\",\"args\":{\"value\":%" PRId64 "}", e.value);
+			break;
+		}
+		fprintf (f, "}");
+	}
+
+	fprintf (f, "\n]}\n");
+	fclose (f);
+}
@@ -0,0 +1,121 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  src/lib/trace.h
+ *  @brief Trace and TraceSpan classes.
+ */
+
+#ifndef DCPOMATIC_TRACE_H
+#define DCPOMATIC_TRACE_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <stdint.h>
+#include <vector>
+
+/** @class Trace
+ *  @brief Recorder of timing events from the encoding pipeline.
+ *
+ *  Events are kept in a fixed-size ring buffer of small structs (the oldest
+ *  being overwritten when it is full) and can be written out in the Chrome
+ *  trace-event JSON format, to be viewed with chrome://tracing or Perfetto.
+ *  Event names must be string literals as only the pointer is stored.
+ */
+class Trace : public boost::noncopyable
+{
+public:
+	void set_enabled (bool e);
+
+	/** @return true if events are being recorded; this takes no lock */
+	bool enabled () const {
+		return _enabled;
+	}
+
+	void begin (char const* name, int64_t frame = -1);
+	void end (char const* name, int64_t frame = -1);
+	void counter (char const* name, int64_t value);
+
+	void clear ();
+	void write (boost::filesystem::path file) const;
+
+	static Trace* instance ();
+
+private:
+	Trace ();
+
+	enum Phase {
+		PHASE_BEGIN,
+		PHASE_END,
+		PHASE_COUNTER
+	};
+
+	struct Event
+	{
+		char const* name;
+		Phase phase;
+		/** time in microseconds since the epoch */
+		int64_t time;
+		uint64_t thread;
+		/** frame index for begin/end events (or -1), value for counters */
+		int64_t value;
+	};
+
+	void add (char const* name, Phase phase, int64_t value);
+
+	boost::atomic<bool> _enabled;
+
+	/** mutex to protect _events, _next and _full */
+	mutable boost::mutex _mutex;
+	std::vector<Event> _events;
+	/** index in _events of the next event to write */
+	size_t _next;
+	/** true if _events has wrapped round at least once */
+	bool _full;
+
+	static Trace* _instance;
+	static size_t const _size;
+};
+
+/** @class TraceSpan
+ *  @brief Helper to record the begin and end of a span over some scope.
+ */
+class TraceSpan : public boost::noncopyable
+{
+public:
+	explicit TraceSpan (char const* name, int64_t frame = -1)
+		: _name (name)
+		, _frame (frame)
+	{
+		Trace::instance()->begin (_name, _frame);
+	}
+
+	~TraceSpan ()
+	{
+		Trace::instance()->end (_name, _frame);
+	}
+
+private:
+	char const* _name;
+	int64_t _frame;
+};
+
+#endif
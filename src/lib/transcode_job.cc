@@ -32,6 +32,9 @@
 #include "dcpomatic_log.h"
 #include "compose.hpp"
 #include "analytics.h"
+#include "trace.h"
+#include "encode_report.h"
+#include "config.h"
 #include <iostream>
 #include <iomanip>
 
@@ -77,6 +80,12 @@ TranscodeJob::set_encoder (shared_ptr<Encoder> e)
 void
 TranscodeJob::run ()
 {
+	bool const trace = Config::instance()->trace ();
+	if (trace) {
+		Trace::instance()->clear ();
+		Trace::instance()->set_enabled (true);
+	}
+
 	try {
 		struct timeval start;
 		gettimeofday (&start, 0);
@@ -84,6 +93,11 @@ TranscodeJob::run ()
 
 		DCPOMATIC_ASSERT (_encoder);
 		_encoder->go ();
+
+		if (trace) {
+			write_trace ();
+		}
+
 		set_progress (1);
 		set_state (FINISHED_OK);
 
@@ -97,6 +111,15 @@ TranscodeJob::run ()
 
 		LOG_GENERAL (N_("Transcode job completed successfully: %1 fps"), fps);
 
+		shared_ptr<const EncodeReport> report = _encoder->report ();
+		if (report) {
+			try {
+				report->write (_film->file ("encode_report.json"));
+			} catch (std::exception& e) {
+				LOG_ERROR ("Could not write encode report (%1)", e.what());
+			}
+		}
+
 		if (dynamic_pointer_cast<DCPEncoder>(_encoder)) {
 			Analytics::instance()->successful_dcp_encode();
 		}
@@ -110,11 +133,28 @@ TranscodeJob::run ()
 		_encoder.reset ();
 
 	} catch (...) {
+		if (trace) {
+			write_trace ();
+		}
 		_encoder.reset ();
 		throw;
 	}
 }
 
+/** Stop tracing and write what we have to the film directory */
+void
+TranscodeJob::write_trace ()
+{
+	Trace::instance()->set_enabled (false);
+	boost::filesystem::path const file = _film->file ("trace.json");
+	try {
+		Trace::instance()->write (file);
+		LOG_GENERAL ("Wrote encoding trace to %1", file.string());
+	} catch (std::exception& e) {
+		LOG_ERROR ("Could not write encoding trace (%1)", e.what());
+	}
+}
+
 string
 TranscodeJob::status () const
 {
@@ -45,6 +45,7 @@ public:
 
 private:
 	int remaining_time () const;
+	void write_trace ();
 
 	boost::shared_ptr<Encoder> _encoder;
 };
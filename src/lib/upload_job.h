@@ -33,6 +33,10 @@ public:
 	std::string name () const;
 	std::string json_name () const;
 	void run ();
+
+	Resource resource () const {
+		return RESOURCE_NETWORK;
+	}
 	std::string status () const;
 
 private:
@@ -34,6 +34,10 @@ public:
 	std::string json_name () const;
 	void run ();
 
+	Resource resource () const {
+		return RESOURCE_DISK;
+	}
+
 	std::list<dcp::VerificationNote> notes () const {
 		return _notes;
 	}
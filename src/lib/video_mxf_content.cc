@@ -80,7 +80,9 @@ VideoMXFContent::valid_mxf (boost::filesystem::path path)
 void
 VideoMXFContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 {
-	job->set_progress_unknown ();
+	if (job) {
+		job->set_progress_unknown ();
+	}
 
 	Content::examine (film, job);
 
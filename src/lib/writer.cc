@@ -36,6 +36,9 @@
 #include "util.h"
 #include "reel_writer.h"
 #include "text_content.h"
+#include "trace.h"
+#include "metrics.h"
+#include "encode_report.h"
 #include <dcp/cpl.h>
 #include <dcp/locale_convert.h>
 #include <boost/foreach.hpp>
@@ -64,12 +67,15 @@ using boost::dynamic_pointer_cast;
 using boost::optional;
 using dcp::Data;
 
-Writer::Writer (shared_ptr<const Film> film, weak_ptr<Job> j)
+/** @param report Report to add timings and statistics to */
+Writer::Writer (shared_ptr<const Film> film, weak_ptr<Job> j, shared_ptr<EncodeReport> report)
 	: _film (film)
 	, _job (j)
+	, _report (report)
 	, _thread (0)
 	, _finish (false)
 	, _queued_full_in_memory (0)
+	, _queued_full_bytes_in_memory (0)
 	/* These will be reset to sensible values when J2KEncoder is created */
 	, _maximum_frames_in_memory (8)
 	, _maximum_queue_size (8)
@@ -77,6 +83,7 @@ Writer::Writer (shared_ptr<const Film> film, weak_ptr<Job> j)
 	, _fake_written (0)
 	, _repeat_written (0)
 	, _pushed_to_disk (0)
+	, _bytes_pushed_to_disk (0)
 {
 	shared_ptr<Job> job = _job.lock ();
 	DCPOMATIC_ASSERT (job);
@@ -149,12 +156,16 @@ Writer::write (Data encoded, Frame frame, Eyes eyes)
 		qi.eyes = EYES_RIGHT;
 		_queue.push_back (qi);
 		++_queued_full_in_memory;
+		_queued_full_bytes_in_memory += 2 * encoded.size();
 	} else {
 		qi.eyes = eyes;
 		_queue.push_back (qi);
 		++_queued_full_in_memory;
+		_queued_full_bytes_in_memory += encoded.size();
 	}
 
+	update_metrics ();
+
 	/* Now there's something to do: wake anything wait()ing on _empty_condition */
 	_empty_condition.notify_all ();
 }
@@ -336,6 +347,15 @@ Writer::have_sequenced_image_at_queue_head ()
 	return false;
 }
 
+/** Caller must hold a lock on _state_mutex */
+void
+Writer::update_metrics () const
+{
+	Metrics::instance()->set ("writer_queue", _queue.size());
+	Metrics::instance()->set ("writer_frames_in_memory", _queued_full_in_memory);
+	Metrics::instance()->set ("writer_bytes_in_memory", _queued_full_bytes_in_memory);
+}
+
 void
 Writer::thread ()
 try
@@ -353,7 +373,9 @@ try
 
 			/* Nothing to do: wait until something happens which may indicate that we do */
 			LOG_TIMING (N_("writer-sleep queue=%1"), _queue.size());
+			Trace::instance()->begin ("writer-sleep");
 			_empty_condition.wait (lock);
+			Trace::instance()->end ("writer-sleep");
 			LOG_TIMING (N_("writer-wake queue=%1"), _queue.size());
 		}
 
@@ -381,16 +403,22 @@ try
 			return;
 		}
 
+		Trace::instance()->counter ("writer-queue", _queue.size());
+		update_metrics ();
+
 		/* Write any frames that we can write; i.e. those that are in sequence. */
 		while (have_sequenced_image_at_queue_head ()) {
 			QueueItem qi = _queue.front ();
 			_queue.pop_front ();
 			if (qi.type == QueueItem::FULL && qi.encoded) {
 				--_queued_full_in_memory;
+				_queued_full_bytes_in_memory -= qi.encoded->size();
 			}
 
 			lock.unlock ();
 
+			TraceSpan span ("write", qi.frame);
+
 			ReelWriter& reel = _reels[qi.reel];
 
 			switch (qi.type) {
@@ -400,6 +428,7 @@ try
 					qi.encoded = Data (_film->j2c_path (qi.reel, qi.frame, qi.eyes, false));
 				}
 				reel.write (qi.encoded, qi.frame, qi.eyes);
+				Metrics::instance()->add ("writer_bytes_written_total", qi.encoded->size());
 				++_full_written;
 				break;
 			case QueueItem::FAKE:
@@ -432,6 +461,7 @@ try
 
 			DCPOMATIC_ASSERT (i != _queue.rend());
 			++_pushed_to_disk;
+			_bytes_pushed_to_disk += i->encoded->size();
 			/* For the log message below */
 			int const awaiting = _reels[_queue.front().reel].last_written_video_frame() + 1;
 			lock.unlock ();
@@ -442,15 +472,20 @@ try
 			*/
 
 			LOG_GENERAL ("Writer full; pushes %1 to disk while awaiting %2", i->frame, awaiting);
+			TraceSpan span ("push-to-disk", i->frame);
 
 			i->encoded->write_via_temp (
 				_film->j2c_path (i->reel, i->frame, i->eyes, true),
 				_film->j2c_path (i->reel, i->frame, i->eyes, false)
 				);
 
+			Metrics::instance()->add ("writer_pushed_to_disk_total");
+
 			lock.lock ();
+			_queued_full_bytes_in_memory -= i->encoded->size();
 			i->encoded.reset ();
 			--_queued_full_in_memory;
+			update_metrics ();
 			_full_condition.notify_all ();
 		}
 	}
@@ -492,6 +527,9 @@ Writer::finish ()
 		return;
 	}
 
+	struct timeval start;
+	gettimeofday (&start, 0);
+
 	LOG_GENERAL_NC ("Terminating writer thread");
 
 	terminate_thread (true);
@@ -515,6 +553,10 @@ Writer::finish ()
 
 	dcp.add (cpl);
 
+	struct timeval digest_start;
+	gettimeofday (&digest_start, 0);
+	_report->add_phase ("write", seconds(digest_start) - seconds(start));
+
 	/* Calculate digests for each reel in parallel */
 
 	shared_ptr<Job> job = _job.lock ();
@@ -540,6 +582,10 @@ Writer::finish ()
 	pool.join_all ();
 	service.stop ();
 
+	struct timeval digest_finish;
+	gettimeofday (&digest_finish, 0);
+	_report->add_phase ("digest", seconds(digest_finish) - seconds(digest_start));
+
 	/* Add reels to CPL */
 
 	BOOST_FOREACH (ReelWriter& i, _reels) {
@@ -576,6 +622,12 @@ Writer::finish ()
 		N_("Wrote %1 FULL, %2 FAKE, %3 REPEAT, %4 pushed to disk"), _full_written, _fake_written, _repeat_written, _pushed_to_disk
 		);
 
+	_report->add_count ("full_written", _full_written);
+	_report->add_count ("fake_written", _fake_written);
+	_report->add_count ("repeat_written", _repeat_written);
+	_report->add_count ("pushed_to_disk", _pushed_to_disk);
+	_report->add_count ("bytes_pushed_to_disk", _bytes_pushed_to_disk);
+
 	write_cover_sheet ();
 }
 
@@ -42,6 +42,7 @@ class Job;
 class Font;
 class ReferencedReelAsset;
 class ReelWriter;
+class EncodeReport;
 
 struct QueueItem
 {
@@ -93,7 +94,7 @@ bool operator== (QueueItem const & a, QueueItem const & b);
 class Writer : public ExceptionStore, public boost::noncopyable
 {
 public:
-	Writer (boost::shared_ptr<const Film>, boost::weak_ptr<Job>);
+	Writer (boost::shared_ptr<const Film>, boost::weak_ptr<Job>, boost::shared_ptr<EncodeReport> report);
 	~Writer ();
 
 	void start ();
@@ -116,6 +117,7 @@ private:
 	void thread ();
 	void terminate_thread (bool);
 	bool have_sequenced_image_at_queue_head ();
+	void update_metrics () const;
 	size_t video_reel (int frame) const;
 	void set_digest_progress (Job* job, float progress);
 	void write_cover_sheet ();
@@ -123,6 +125,8 @@ private:
 	/** our Film */
 	boost::shared_ptr<const Film> _film;
 	boost::weak_ptr<Job> _job;
+	/** report to add our timings and statistics to */
+	boost::shared_ptr<EncodeReport> _report;
 	std::vector<ReelWriter> _reels;
 	std::vector<ReelWriter>::iterator _audio_reel;
 	std::vector<ReelWriter>::iterator _subtitle_reel;
@@ -136,6 +140,8 @@ private:
 	std::list<QueueItem> _queue;
 	/** number of FULL frames whose JPEG200 data is currently held in RAM */
 	int _queued_full_in_memory;
+	/** total size of the JPEG2000 data of the frames counted by _queued_full_in_memory */
+	int64_t _queued_full_bytes_in_memory;
 	/** mutex for thread state */
 	mutable boost::mutex _state_mutex;
 	/** condition to manage thread wakeups when we have nothing to do  */
@@ -157,6 +163,8 @@ private:
 	    due to the limit of frames to be held in memory.
 	*/
 	int _pushed_to_disk;
+	/** total size of the frames counted by _pushed_to_disk */
+	int64_t _bytes_pushed_to_disk;
 
 	boost::mutex _digest_progresses_mutex;
 	std::map<boost::thread::id, float> _digest_progresses;
@@ -1554,9 +1554,8 @@ private:
 			if (!_film_to_create.empty ()) {
 				_frame->new_film (_film_to_create, optional<string> ());
 				if (!_content_to_add.empty ()) {
-					BOOST_FOREACH (shared_ptr<Content> i, content_factory(_content_to_add)) {
-						_frame->film()->examine_and_add_content (i);
-					}
+					list<shared_ptr<Content> > content = content_factory (_content_to_add);
+					_frame->film()->examine_and_add_content (ContentList (content.begin(), content.end()));
 				}
 				if (!_dcp_to_add.empty ()) {
 					_frame->film()->examine_and_add_content(shared_ptr<DCPContent>(new DCPContent(_dcp_to_add)));
@@ -1655,6 +1654,18 @@ private:
 		}
 	}
 
+	int OnExit ()
+	{
+		/* Leave the cinemas file complete on its own, without its journal, for anything else that reads it */
+		try {
+			Config::instance()->compact_cinemas ();
+		} catch (...) {
+
+		}
+
+		return wxApp::OnExit ();
+	}
+
 	/* An unhandled exception has occurred inside the main event loop */
 	bool OnExceptionInMainLoop ()
 	{
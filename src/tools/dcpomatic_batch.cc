@@ -462,6 +462,18 @@ class App : public wxApp
 		signal_manager->ui_idle ();
 	}
 
+	int OnExit ()
+	{
+		/* Leave the cinemas file complete on its own, without its journal, for anything else that reads it */
+		try {
+			Config::instance()->compact_cinemas ();
+		} catch (...) {
+
+		}
+
+		return wxApp::OnExit ();
+	}
+
 	void OnInitCmdLine (wxCmdLineParser& parser)
 	{
 		parser.SetDesc (command_line_description);
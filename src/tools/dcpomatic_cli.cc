@@ -68,10 +68,24 @@ help (string n)
 	     << "  -d, --dcp-path       echo DCP's path to stdout on successful completion (implies -n)\n"
 	     << "  -c, --config <dir>   directory containing config.xml and cinemas.xml\n"
 	     << "      --dump           just dump a summary of the film's settings; don't encode\n"
+	     << "      --trace          write a trace of the encoding pipeline to trace.json in the film directory\n"
 	     << "\n"
 	     << "<FILM> is the film directory.\n";
 }
 
+/** @return a frames-per-second figure from a server's calibration, or "-" if it has not calibrated */
+static string
+print_fps (optional<float> fps)
+{
+	if (!fps) {
+		return "-";
+	}
+
+	char buffer[64];
+	snprintf (buffer, sizeof(buffer), "%.1f", *fps);
+	return buffer;
+}
+
 static void
 print_dump (shared_ptr<Film> film)
 {
@@ -133,7 +147,7 @@ list_servers ()
 			cout << "No encoding servers found or configured.\n";
 			++N;
 		} else {
-			cout << std::left << setw(24) << "Host" << " Status Threads\n";
+			cout << std::left << setw(24) << "Host" << " Status Threads 2K fps\n";
 			++N;
 
 			/* Report the state of configured servers */
@@ -144,10 +158,12 @@ list_servers ()
 				   the number of threads it is offering.
 				*/
 				optional<int> threads;
+				optional<float> fps;
 				list<EncodeServerDescription>::iterator j = servers.begin ();
 				while (j != servers.end ()) {
 					if (i == j->host_name() && j->current_link_version()) {
 						threads = j->threads();
+						fps = j->frames_per_second_2k();
 						list<EncodeServerDescription>::iterator tmp = j;
 						++tmp;
 						servers.erase (j);
@@ -157,7 +173,7 @@ list_servers ()
 					}
 				}
 				if (static_cast<bool>(threads)) {
-					cout << "UP     " << threads.get() << "\n";
+					cout << "UP     " << setw(7) << threads.get() << " " << print_fps (fps) << "\n";
 				} else {
 					cout << "DOWN\n";
 				}
@@ -167,7 +183,7 @@ list_servers ()
 			/* Now report any left that have been found by broadcast */
 			BOOST_FOREACH (EncodeServerDescription const & i, servers) {
 				if (i.current_link_version()) {
-					cout << std::left << setw(24) << i.host_name() << " UP     " << i.threads() << "\n";
+					cout << std::left << setw(24) << i.host_name() << " UP     " << setw(7) << i.threads() << " " << print_fps (i.frames_per_second_2k()) << "\n";
 				} else {
 					cout << std::left << setw(24) << i.host_name() << " bad version\n";
 				}
@@ -198,6 +214,7 @@ main (int argc, char* argv[])
 	bool list_servers_ = false;
 	bool dcp_path = false;
 	optional<boost::filesystem::path> config;
+	bool trace = false;
 
 	int option_index = 0;
 	while (true) {
@@ -216,10 +233,11 @@ main (int argc, char* argv[])
 			{ "config", required_argument, 0, 'c' },
 			/* Just using A, B, C ... from here on */
 			{ "dump", no_argument, 0, 'A' },
+			{ "trace", no_argument, 0, 'B' },
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vhfnrt:j:kAs:ldc:", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vhfnrt:j:kAs:ldc:B", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -253,6 +271,9 @@ main (int argc, char* argv[])
 		case 'A':
 			dump = true;
 			break;
+		case 'B':
+			trace = true;
+			break;
 		case 's':
 			servers = optarg;
 			break;
@@ -318,6 +339,10 @@ main (int argc, char* argv[])
 		Config::instance()->set_master_encoding_threads (threads.get ());
 	}
 
+	if (trace) {
+		Config::instance()->set_trace (true);
+	}
+
 	shared_ptr<Film> film;
 	try {
 		film.reset (new Film (film_dir));
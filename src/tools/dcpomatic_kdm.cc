@@ -627,6 +627,18 @@ private:
 		return true;
 	}
 
+	int OnExit ()
+	{
+		/* Leave the cinemas file complete on its own, without its journal, for anything else that reads it */
+		try {
+			Config::instance()->compact_cinemas ();
+		} catch (...) {
+
+		}
+
+		return wxApp::OnExit ();
+	}
+
 	/* An unhandled exception has occurred inside the main event loop */
 	bool OnExceptionInMainLoop ()
 	{
@@ -31,6 +31,7 @@
 #include "lib/emailer.h"
 #include "lib/dkdm_wrapper.h"
 #include "lib/screen.h"
+#include "lib/kdm_batch.h"
 #include <dcp/certificate.h>
 #include <dcp/decrypted_kdm.h>
 #include <dcp/encrypted_kdm.h>
@@ -68,6 +69,7 @@ help ()
 		"  -S, --screen                             screen description\n"
 		"  -C, --certificate                        file containing projector certificate\n"
 		"  -T, --trusted-device                     file containing a trusted device's certificate\n"
+		"  -j, --threads                            number of threads to use when making KDMs (overriding configuration)\n"
 		"      --list-cinemas                       list known cinemas from the DCP-o-matic settings\n"
 		"      --list-dkdm-cpls                     list CPLs for which DCP-o-matic has DKDMs\n\n"
 		"CPL-ID must be the ID of a CPL that is mentioned in DCP-o-matic's DKDM list.\n\n"
@@ -166,22 +168,13 @@ write_files (
 shared_ptr<Cinema>
 find_cinema (string cinema_name)
 {
-	list<shared_ptr<Cinema> > cinemas = Config::instance()->cinemas ();
-	list<shared_ptr<Cinema> >::const_iterator i = cinemas.begin();
-	while (
-		i != cinemas.end() &&
-		(*i)->name != cinema_name &&
-		find ((*i)->emails.begin(), (*i)->emails.end(), cinema_name) == (*i)->emails.end()) {
-
-		++i;
-	}
-
-	if (i == cinemas.end ()) {
+	shared_ptr<Cinema> cinema = Config::instance()->find_cinema (cinema_name);
+	if (!cinema) {
 		cerr << program_name << ": could not find cinema \"" << cinema_name << "\"\n";
 		exit (EXIT_FAILURE);
 	}
 
-	return *i;
+	return cinema;
 }
 
 void
@@ -273,40 +266,6 @@ find_dkdm (string cpl_id)
 	return sub_find_dkdm (Config::instance()->dkdms(), cpl_id);
 }
 
-dcp::EncryptedKDM
-kdm_from_dkdm (
-	dcp::DecryptedKDM dkdm,
-	dcp::Certificate target,
-	vector<string> trusted_devices,
-	dcp::LocalTime valid_from,
-	dcp::LocalTime valid_to,
-	dcp::Formulation formulation,
-	bool disable_forensic_marking_picture,
-	optional<int> disable_forensic_marking_audio
-	)
-{
-	/* Signer for new KDM */
-	shared_ptr<const dcp::CertificateChain> signer = Config::instance()->signer_chain ();
-	if (!signer->valid ()) {
-		error ("signing certificate chain is invalid.");
-	}
-
-	/* Make a new empty KDM and add the keys from the DKDM to it */
-	dcp::DecryptedKDM kdm (
-		valid_from,
-		valid_to,
-		dkdm.annotation_text().get_value_or(""),
-		dkdm.content_title_text(),
-		dcp::LocalTime().as_string()
-		);
-
-	BOOST_FOREACH (dcp::DecryptedKDMKey const & j, dkdm.keys()) {
-		kdm.add_key(j);
-	}
-
-	return kdm.encrypt (signer, target, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
-}
-
 void
 from_dkdm (
 	list<shared_ptr<Screen> > screens,
@@ -329,28 +288,8 @@ from_dkdm (
 	values['e'] = dcp::LocalTime(valid_to).date() + " " + dcp::LocalTime(valid_to).time_of_day(true, false);
 
 	try {
-		list<ScreenKDM> screen_kdms;
-		BOOST_FOREACH (shared_ptr<Screen> i, screens) {
-			if (!i->recipient) {
-				continue;
-			}
-
-			screen_kdms.push_back (
-				ScreenKDM (
-					i,
-					kdm_from_dkdm (
-						dkdm,
-						i->recipient.get(),
-						i->trusted_device_thumbprints(),
-						dcp::LocalTime(valid_from, i->cinema->utc_offset_hour(), i->cinema->utc_offset_minute()),
-						dcp::LocalTime(valid_to, i->cinema->utc_offset_hour(), i->cinema->utc_offset_minute()),
-						formulation,
-						disable_forensic_marking_picture,
-						disable_forensic_marking_audio
-						)
-					)
-				);
-		}
+		KDMBatch batch (dkdm, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+		list<ScreenKDM> screen_kdms = batch.make (screens, valid_from, valid_to, Config::instance()->master_encoding_threads());
 		write_files (screen_kdms, zip, output, container_name_format, filename_format, values, verbose);
 	} catch (FileError& e) {
 		cerr << program_name << ": " << e.what() << " (" << e.file().string() << ")\n";
@@ -358,6 +297,8 @@ from_dkdm (
 	} catch (KDMError& e) {
 		cerr << program_name << ": " << e.what() << "\n";
 		exit (EXIT_FAILURE);
+	} catch (InvalidSignerError& e) {
+		error ("signing certificate chain is invalid.");
 	}
 }
 
@@ -405,6 +346,7 @@ int main (int argc, char* argv[])
 	dcp::Formulation formulation = dcp::MODIFIED_TRANSITIONAL_1;
 	bool disable_forensic_marking_picture = false;
 	optional<int> disable_forensic_marking_audio;
+	optional<int> threads;
 
 	program_name = argv[0];
 
@@ -429,10 +371,11 @@ int main (int argc, char* argv[])
 			{ "trusted-device", required_argument, 0, 'T' },
 			{ "list-cinemas", no_argument, 0, 'B' },
 			{ "list-dkdm-cpls", no_argument, 0, 'D' },
+			{ "threads", required_argument, 0, 'j' },
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "ho:K:Z:f:t:d:F:pa::zvc:S:C:T:BD", long_options, &option_index);
+		int c = getopt_long (argc, argv, "ho:K:Z:f:t:d:F:pa::zvc:S:C:T:BDj:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -524,6 +467,9 @@ int main (int argc, char* argv[])
 		case 'D':
 			list_dkdm_cpls = true;
 			break;
+		case 'j':
+			threads = atoi (optarg);
+			break;
 		}
 	}
 
@@ -569,6 +515,10 @@ int main (int argc, char* argv[])
 	dcpomatic_setup_path_encoding ();
 	dcpomatic_setup ();
 
+	if (threads) {
+		Config::instance()->set_master_encoding_threads (threads.get ());
+	}
+
 	if (verbose) {
 		cout << "Making KDMs valid from " << valid_from.get() << " to " << valid_to.get() << "\n";
 	}
@@ -28,10 +28,12 @@
 #include "lib/null_log.h"
 #include "lib/version.h"
 #include "lib/encode_server.h"
+#include "lib/encode_server_calibration.h"
 #include "lib/dcpomatic_log.h"
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
@@ -46,7 +48,17 @@
 using std::cerr;
 using std::string;
 using std::cout;
+using std::pair;
+using std::make_pair;
 using boost::shared_ptr;
+using boost::optional;
+
+static void
+print_calibration_result (EncodeServerCalibration::Result r)
+{
+	cout << (r.resolution == RESOLUTION_2K ? "2K" : "4K") << " with " << r.threads << " threads: "
+	     << r.frames_per_second << " fps, peak memory " << (r.peak_memory / 1048576) << "MB\n";
+}
 
 static void
 help (string n)
@@ -55,6 +67,8 @@ help (string n)
 	     << "  -v, --version      show DCP-o-matic version\n"
 	     << "  -h, --help         show this help\n"
 	     << "  -t, --threads      number of parallel encoding threads to use\n"
+	     << "  -c, --calibrate    measure encoding speed with different numbers of threads and use the best\n"
+	     << "                     (with -t, the number of threads is the most that will be tried)\n"
 	     << "  --verbose          be verbose to stdout\n"
 	     << "  --log              write a log file of activity\n";
 }
@@ -68,6 +82,8 @@ main (int argc, char* argv[])
 	int num_threads = Config::instance()->server_encoding_threads ();
 	bool verbose = false;
 	bool write_log = false;
+	bool calibrate = false;
+	bool threads_given = false;
 
 	int option_index = 0;
 	while (true) {
@@ -75,12 +91,13 @@ main (int argc, char* argv[])
 			{ "version", no_argument, 0, 'v'},
 			{ "help", no_argument, 0, 'h'},
 			{ "threads", required_argument, 0, 't'},
+			{ "calibrate", no_argument, 0, 'c'},
 			{ "verbose", no_argument, 0, 'A'},
 			{ "log", no_argument, 0, 'B'},
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vht:AB", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vht:cAB", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -95,6 +112,10 @@ main (int argc, char* argv[])
 			exit (EXIT_SUCCESS);
 		case 't':
 			num_threads = atoi (optarg);
+			threads_given = true;
+			break;
+		case 'c':
+			calibrate = true;
 			break;
 		case 'A':
 			verbose = true;
@@ -109,7 +130,20 @@ main (int argc, char* argv[])
 		dcpomatic_log.reset (new FileLog("dcpomatic_server_cli.log"));
 	}
 
+	optional<pair<float, float> > speeds;
+	if (calibrate) {
+		EncodeServerCalibration calibration (threads_given ? num_threads : boost::thread::hardware_concurrency());
+		cout << "Calibrating...\n";
+		calibration.run (boost::bind (&print_calibration_result, _1));
+		num_threads = calibration.threads ();
+		speeds = make_pair (calibration.frames_per_second_2k(), calibration.frames_per_second_4k());
+		cout << "Using " << num_threads << " threads: " << speeds->first << " 2K fps, " << speeds->second << " 4K fps.\n";
+	}
+
 	EncodeServer server (verbose, num_threads);
+	if (speeds) {
+		server.set_calibration (speeds->first, speeds->second);
+	}
 
 	try {
 		server.run ();
@@ -31,6 +31,8 @@
 #include "lib/player.h"
 #include "lib/player_video.h"
 #include "lib/encode_server_description.h"
+#include "lib/encode_server_calibration.h"
+#include <boost/thread.hpp>
 #include <getopt.h>
 #include <iostream>
 #include <iomanip>
@@ -40,6 +42,9 @@ using std::cout;
 using std::cerr;
 using std::string;
 using std::pair;
+using std::setw;
+using std::fixed;
+using std::setprecision;
 using boost::shared_ptr;
 using boost::optional;
 using boost::bind;
@@ -95,10 +100,18 @@ process_video (shared_ptr<PlayerVideo> pvf)
 	cout << "\033[0;32mgood\033[0m\n";
 }
 
+static void
+print_calibration_result (EncodeServerCalibration::Result r)
+{
+	cout << (r.resolution == RESOLUTION_2K ? "2K" : "4K") << " with " << setw(3) << r.threads << " threads: "
+	     << fixed << setprecision(1) << setw(6) << r.frames_per_second << " fps, peak memory " << (r.peak_memory / 1048576) << "MB\n";
+}
+
 static void
 help (string n)
 {
-	cerr << "Syntax: " << n << " [--help] --film <film> --server <host>\n";
+	cerr << "Syntax: " << n << " [--help] --film <film> --server <host>\n"
+	     << "        " << n << " --calibrate [--threads <n>]\n";
 	exit (EXIT_FAILURE);
 }
 
@@ -107,17 +120,21 @@ main (int argc, char* argv[])
 {
 	boost::filesystem::path film_dir;
 	string server_host;
+	bool calibrate = false;
+	int threads = boost::thread::hardware_concurrency ();
 
 	while (true) {
 		static struct option long_options[] = {
 			{ "help", no_argument, 0, 'h'},
 			{ "server", required_argument, 0, 's'},
 			{ "film", required_argument, 0, 'f'},
+			{ "calibrate", no_argument, 0, 'c'},
+			{ "threads", required_argument, 0, 't'},
 			{ 0, 0, 0, 0 }
 		};
 
 		int option_index = 0;
-		int c = getopt_long (argc, argv, "hs:f:", long_options, &option_index);
+		int c = getopt_long (argc, argv, "hs:f:ct:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -133,9 +150,24 @@ main (int argc, char* argv[])
 		case 'f':
 			film_dir = optarg;
 			break;
+		case 'c':
+			calibrate = true;
+			break;
+		case 't':
+			threads = atoi (optarg);
+			break;
 		}
 	}
 
+	if (calibrate) {
+		dcpomatic_setup ();
+		EncodeServerCalibration calibration (threads);
+		calibration.run (bind (&print_calibration_result, _1));
+		cout << "Best: " << calibration.threads() << " threads, " << calibration.frames_per_second_2k() << " 2K fps, "
+		     << calibration.frames_per_second_4k() << " 4K fps\n";
+		exit (EXIT_SUCCESS);
+	}
+
 	if (server_host.empty() || film_dir.string().empty()) {
 		help (argv[0]);
 		exit (EXIT_FAILURE);
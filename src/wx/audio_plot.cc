@@ -41,6 +41,7 @@ using boost::shared_ptr;
 int const AudioPlot::_minimum = -70;
 int const AudioPlot::_cursor_size = 8;
 int const AudioPlot::max_smoothing = 128;
+int const AudioPlot::_points = 1024;
 
 AudioPlot::AudioPlot (wxWindow* parent)
 	: wxPanel (parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxFULL_REPAINT_ON_RESIZE)
@@ -94,8 +95,11 @@ void
 AudioPlot::set_analysis (shared_ptr<AudioAnalysis> a)
 {
 	_analysis = a;
+	_level = 0;
 
-	if (!a) {
+	if (a) {
+		_level = a->level_for (_points);
+	} else {
 		_message = _("Please wait; audio is being analysed...");
 	}
 
@@ -161,7 +165,7 @@ AudioPlot::paint ()
 
 	int const data_width = GetSize().GetWidth() - metrics.db_label_width;
 	/* Assume all channels have the same number of points */
-	metrics.x_scale = data_width / float (_analysis->points (0));
+	metrics.x_scale = data_width / float (_analysis->points (0, _level));
 	metrics.height = GetSize().GetHeight ();
 	metrics.y_origin = 32;
 	metrics.y_scale = (metrics.height - metrics.y_origin) / -_minimum;
@@ -180,8 +184,8 @@ AudioPlot::paint ()
 
 	wxGraphicsPath v_grid = gc->CreatePath ();
 
-	DCPOMATIC_ASSERT (_analysis->samples_per_point() != 0.0);
-	double const pps = _analysis->sample_rate() * metrics.x_scale / _analysis->samples_per_point();
+	DCPOMATIC_ASSERT (_analysis->samples_per_point(_level) != 0.0);
+	double const pps = _analysis->sample_rate() * metrics.x_scale / _analysis->samples_per_point(_level);
 
 	gc->SetPen (*wxThePenList->FindOrCreatePen (wxColour (0, 0, 0), 1, wxPENSTYLE_SOLID));
 
@@ -273,14 +277,14 @@ AudioPlot::y_for_linear (float p, Metrics const & metrics) const
 void
 AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics) const
 {
-	if (_analysis->points (channel) == 0) {
+	if (_analysis->points (channel, _level) == 0) {
 		return;
 	}
 
 	_peak[channel] = PointList ();
 
 	float peak = 0;
-	int const N = _analysis->points(channel);
+	int const N = _analysis->points(channel, _level);
 	for (int i = 0; i < N; ++i) {
 		float const p = get_point(channel, i)[AudioPoint::PEAK];
 		peak -= 0.01f * (1 - log10 (_smoothing) / log10 (max_smoothing));
@@ -293,7 +297,7 @@ AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics
 		_peak[channel].push_back (
 			Point (
 				wxPoint (metrics.db_label_width + i * metrics.x_scale, y_for_linear (peak, metrics)),
-				DCPTime::from_frames (i * _analysis->samples_per_point(), _analysis->sample_rate()),
+				DCPTime::from_frames (i * _analysis->samples_per_point(_level), _analysis->sample_rate()),
 				20 * log10(peak)
 				)
 			);
@@ -310,7 +314,7 @@ AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics
 void
 AudioPlot::plot_rms (wxGraphicsPath& path, int channel, Metrics const & metrics) const
 {
-	if (_analysis->points (channel) == 0) {
+	if (_analysis->points (channel, _level) == 0) {
 		return;
 	}
 
@@ -318,7 +322,7 @@ AudioPlot::plot_rms (wxGraphicsPath& path, int channel, Metrics const & metrics)
 
 	list<float> smoothing;
 
-	int const N = _analysis->points(channel);
+	int const N = _analysis->points(channel, _level);
 
 	float const first = get_point(channel, 0)[AudioPoint::RMS];
 	float const last = get_point(channel, N - 1)[AudioPoint::RMS];
@@ -362,7 +366,7 @@ AudioPlot::plot_rms (wxGraphicsPath& path, int channel, Metrics const & metrics)
 		_rms[channel].push_back (
 			Point (
 				wxPoint (metrics.db_label_width + i * metrics.x_scale, y_for_linear (p, metrics)),
-				DCPTime::from_frames (i * _analysis->samples_per_point(), _analysis->sample_rate()),
+				DCPTime::from_frames (i * _analysis->samples_per_point(_level), _analysis->sample_rate()),
 				20 * log10(p)
 				)
 			);
@@ -395,7 +399,7 @@ AudioPlot::set_gain_correction (double gain)
 AudioPoint
 AudioPlot::get_point (int channel, int point) const
 {
-	AudioPoint p = _analysis->get_point (channel, point);
+	AudioPoint p = _analysis->get_point (channel, point, _level);
 	for (int i = 0; i < AudioPoint::COUNT; ++i) {
 		p[i] *= pow (10, _gain_correction / 20);
 	}
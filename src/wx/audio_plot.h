@@ -75,6 +75,8 @@ private:
 	void search (std::map<int, PointList> const & search, wxMouseEvent const & ev, double& min_dist, Point& min_point) const;
 
 	boost::shared_ptr<AudioAnalysis> _analysis;
+	/** Level of _analysis that we are plotting */
+	int _level;
 	bool _channel_visible[MAX_DCP_AUDIO_CHANNELS];
 	bool _type_visible[AudioPoint::COUNT];
 	int _smoothing;
@@ -89,4 +91,6 @@ private:
 
 	static const int _minimum;
 	static const int _cursor_size;
+	/** Number of points that we would like to plot across the width of the window */
+	static const int _points;
 };
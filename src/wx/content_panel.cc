@@ -788,11 +788,12 @@ ContentPanel::add_files (list<boost::filesystem::path> paths)
 	/* XXX: check for lots of files here and do something */
 
 	try {
+		ContentList content;
 		BOOST_FOREACH (boost::filesystem::path i, paths) {
-			BOOST_FOREACH (shared_ptr<Content> j, content_factory(i)) {
-				_film->examine_and_add_content (j);
-			}
+			list<shared_ptr<Content> > c = content_factory (i);
+			content.insert (content.end(), c.begin(), c.end());
 		}
+		_film->examine_and_add_content (content);
 	} catch (exception& e) {
 		error_dialog (_parent, e.what());
 	}
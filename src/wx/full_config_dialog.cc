@@ -120,11 +120,9 @@ private:
 
 		add_play_sound_controls (table, r);
 
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 		_analyse_ebur128 = new CheckBox (_panel, _("Find integrated loudness, true peak and loudness range when analysing audio"));
 		table->Add (_analyse_ebur128, wxGBPosition (r, 0), wxGBSpan (1, 2));
 		++r;
-#endif
 
 		_automatic_audio_analysis = new CheckBox (_panel, _("Automatically analyse content audio"));
 		table->Add (_automatic_audio_analysis, wxGBPosition (r, 0), wxGBSpan (1, 2));
@@ -159,9 +157,7 @@ private:
 		_server_encoding_threads->Bind (wxEVT_SPINCTRL, boost::bind (&FullGeneralPage::server_encoding_threads_changed, this));
 		export_cinemas->Bind (wxEVT_BUTTON, boost::bind (&FullGeneralPage::export_cinemas_file, this));
 
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 		_analyse_ebur128->Bind (wxEVT_CHECKBOX, boost::bind (&FullGeneralPage::analyse_ebur128_changed, this));
-#endif
 		_automatic_audio_analysis->Bind (wxEVT_CHECKBOX, boost::bind (&FullGeneralPage::automatic_audio_analysis_changed, this));
 
 		_issuer->Bind (wxEVT_TEXT, boost::bind (&FullGeneralPage::issuer_changed, this));
@@ -182,9 +178,7 @@ private:
 		}
 		checked_set (_master_encoding_threads, config->master_encoding_threads ());
 		checked_set (_server_encoding_threads, config->server_encoding_threads ());
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 		checked_set (_analyse_ebur128, config->analyse_ebur128 ());
-#endif
 		checked_set (_automatic_audio_analysis, config->automatic_audio_analysis ());
 		checked_set (_issuer, config->dcp_issuer ());
 		checked_set (_creator, config->dcp_creator ());
@@ -202,6 +196,8 @@ private:
                 );
 
 		if (d->ShowModal () == wxID_OK) {
+			/* Make sure that the file has everything in it, not just what was there before the last few changes */
+			Config::instance()->compact_cinemas ();
 			boost::filesystem::copy_file (Config::instance()->cinemas_file(), wx_to_std(d->GetPath()));
 		}
 		d->Destroy ();
@@ -217,12 +213,10 @@ private:
 	}
 
 
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	void analyse_ebur128_changed ()
 	{
 		Config::instance()->set_analyse_ebur128 (_analyse_ebur128->GetValue ());
 	}
-#endif
 
 	void automatic_audio_analysis_changed ()
 	{
@@ -285,9 +279,7 @@ private:
 	wxSpinCtrl* _server_encoding_threads;
 	FilePickerCtrl* _config_file;
 	FilePickerCtrl* _cinemas_file;
-#ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	wxCheckBox* _analyse_ebur128;
-#endif
 	wxCheckBox* _automatic_audio_analysis;
 	wxTextCtrl* _issuer;
 	wxTextCtrl* _creator;
@@ -1378,6 +1370,7 @@ public:
 		, _log_debug_decode (0)
 		, _log_debug_encode (0)
 		, _log_debug_email (0)
+		, _trace (0)
 	{}
 
 private:
@@ -1485,6 +1478,10 @@ private:
 			table->Add (t, 0, wxALL, 6);
 		}
 
+		_trace = new CheckBox (_panel, _("Write encoding trace to film folder"));
+		table->Add (_trace, 1, wxEXPAND | wxALL);
+		table->AddSpacer (0);
+
 #ifdef DCPOMATIC_WINDOWS
 		_win32_console = new CheckBox (_panel, _("Open console window"));
 		table->Add (_win32_console, 1, wxEXPAND | wxALL);
@@ -1506,6 +1503,7 @@ private:
 		_log_debug_decode->Bind (wxEVT_CHECKBOX, boost::bind (&AdvancedPage::log_changed, this));
 		_log_debug_encode->Bind (wxEVT_CHECKBOX, boost::bind (&AdvancedPage::log_changed, this));
 		_log_debug_email->Bind (wxEVT_CHECKBOX, boost::bind (&AdvancedPage::log_changed, this));
+		_trace->Bind (wxEVT_CHECKBOX, boost::bind (&AdvancedPage::trace_changed, this));
 #ifdef DCPOMATIC_WINDOWS
 		_win32_console->Bind (wxEVT_CHECKBOX, boost::bind (&AdvancedPage::win32_console_changed, this));
 #endif
@@ -1526,6 +1524,7 @@ private:
 		checked_set (_log_debug_decode, config->log_types() & LogEntry::TYPE_DEBUG_DECODE);
 		checked_set (_log_debug_encode, config->log_types() & LogEntry::TYPE_DEBUG_ENCODE);
 		checked_set (_log_debug_email, config->log_types() & LogEntry::TYPE_DEBUG_EMAIL);
+		checked_set (_trace, config->trace());
 		checked_set (_frames_in_memory_multiplier, config->frames_in_memory_multiplier());
 #ifdef DCPOMATIC_WINDOWS
 		checked_set (_win32_console, config->win32_console());
@@ -1594,6 +1593,11 @@ private:
 		Config::instance()->set_log_types (types);
 	}
 
+	void trace_changed ()
+	{
+		Config::instance()->set_trace (_trace->GetValue ());
+	}
+
 #ifdef DCPOMATIC_WINDOWS
 	void win32_console_changed ()
 	{
@@ -1615,6 +1619,7 @@ private:
 	wxCheckBox* _log_debug_decode;
 	wxCheckBox* _log_debug_encode;
 	wxCheckBox* _log_debug_email;
+	wxCheckBox* _trace;
 #ifdef DCPOMATIC_WINDOWS
 	wxCheckBox* _win32_console;
 #endif
@@ -178,7 +178,7 @@ ScreensPanel::edit_cinema_clicked ()
 		c.second->set_utc_offset_hour (d->utc_offset_hour ());
 		c.second->set_utc_offset_minute (d->utc_offset_minute ());
 		_targets->SetItemText (c.first, std_to_wx (d->name()));
-		Config::instance()->changed (Config::CINEMAS);
+		Config::instance()->cinema_changed (c.second);
 	}
 
 	d->Destroy ();
@@ -230,7 +230,7 @@ ScreensPanel::add_screen_clicked ()
 		_targets->Expand (id.get ());
 	}
 
-	Config::instance()->changed (Config::CINEMAS);
+	Config::instance()->cinema_changed (c);
 
 	d->Destroy ();
 }
@@ -269,7 +269,7 @@ ScreensPanel::edit_screen_clicked ()
 	s.second->recipient = d->recipient ();
 	s.second->trusted_devices = d->trusted_devices ();
 	_targets->SetItemText (s.first, std_to_wx (d->name()));
-	Config::instance()->changed (Config::CINEMAS);
+	Config::instance()->cinema_changed (c);
 
 	d->Destroy ();
 }
@@ -278,25 +278,15 @@ void
 ScreensPanel::remove_screen_clicked ()
 {
 	for (ScreenMap::iterator i = _selected_screens.begin(); i != _selected_screens.end(); ++i) {
-		CinemaMap::iterator j = _cinemas.begin ();
-		while (j != _cinemas.end ()) {
-			list<shared_ptr<Screen> > sc = j->second->screens ();
-			if (find (sc.begin(), sc.end(), i->second) != sc.end ()) {
-				break;
-			}
-
-			++j;
-		}
-
-		if (j == _cinemas.end()) {
+		shared_ptr<Cinema> c = i->second->cinema;
+		if (!c) {
 			continue;
 		}
 
-		j->second->remove_screen (i->second);
+		c->remove_screen (i->second);
 		_targets->Delete (i->first);
+		Config::instance()->cinema_changed (c);
 	}
-
-	Config::instance()->changed (Config::CINEMAS);
 }
 
 list<shared_ptr<Screen> >
@@ -37,8 +37,11 @@
 #include "lib/audio_content.h"
 #include "lib/content_factory.h"
 #include "lib/playlist.h"
+#include "lib/cross.h"
+#include "lib/exceptions.h"
 #include "test.h"
 #include <iostream>
+#include <cmath>
 
 using std::vector;
 using boost::shared_ptr;
@@ -98,6 +101,53 @@ BOOST_AUTO_TEST_CASE (audio_analysis_serialisation_test)
 	BOOST_CHECK_EQUAL (a.sample_rate(), 48000);
 }
 
+/** Check the coarser levels that AudioAnalysis makes, and that they survive a write and re-read */
+BOOST_AUTO_TEST_CASE (audio_analysis_levels_test)
+{
+	int const points = 1000;
+
+	AudioAnalysis a (2);
+	for (int i = 0; i < points; ++i) {
+		AudioPoint p;
+		p[AudioPoint::PEAK] = float (i) / points;
+		p[AudioPoint::RMS] = (i % 2) ? 0.4 : 0.3;
+		a.add_point (0, p);
+		a.add_point (1, p);
+	}
+
+	a.set_samples_per_point (10);
+	a.set_sample_rate (48000);
+	a.write ("build/test/audio_analysis_levels_test");
+
+	AudioAnalysis b ("build/test/audio_analysis_levels_test");
+	/* 1000, 500, 250 and 125 points */
+	BOOST_REQUIRE_EQUAL (b.levels(), 4);
+	BOOST_CHECK_EQUAL (b.points(0, 0), 1000);
+	BOOST_CHECK_EQUAL (b.points(0, 1), 500);
+	BOOST_CHECK_EQUAL (b.points(1, 3), 125);
+	BOOST_CHECK_EQUAL (b.samples_per_point(2), 40);
+
+	AudioPoint p = b.get_point (0, 10, 1);
+	BOOST_CHECK_CLOSE (p[AudioPoint::PEAK], 21.0 / points, 0.1);
+	BOOST_CHECK_CLOSE (p[AudioPoint::RMS], sqrt ((pow (0.3, 2) + pow (0.4, 2)) / 2), 0.1);
+
+	BOOST_CHECK_EQUAL (b.level_for(2000), 0);
+	BOOST_CHECK_EQUAL (b.level_for(300), 1);
+	BOOST_CHECK_EQUAL (b.level_for(250), 2);
+	BOOST_CHECK_EQUAL (b.level_for(10), 3);
+}
+
+/** Check that an analysis in the old XML format is rejected so that it will be re-run */
+BOOST_AUTO_TEST_CASE (audio_analysis_old_format_test)
+{
+	FILE* f = fopen_boost ("build/test/audio_analysis_old_format_test", "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<AudioAnalysis><Version>3</Version></AudioAnalysis>\n");
+	fclose (f);
+
+	BOOST_CHECK_THROW (AudioAnalysis ("build/test/audio_analysis_old_format_test"), OldFormatError);
+}
+
 static void
 finished ()
 {
@@ -0,0 +1,507 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/benchmark.cc
+ *  @brief Encode throughput benchmarks.
+ *
+ *  This builds some synthetic films (2K/4K, 2D/3D, image sequence, FFmpeg and DCP sources,
+ *  burnt-in subtitles, more than one reel) and, for each, measures:
+ *
+ *  - decode: running the Player to get every video frame;
+ *  - prepare: making the RGB/XYZ image that the encoder needs from each frame;
+ *  - encode: JPEG2000-encoding each (prepared) frame;
+ *  - full: the whole DCPEncoder pipeline, including writing the DCP.
+ *
+ *  prepare and encode are done with a fixed number of threads, and full uses the
+ *  same number of local encoding threads with no servers.  Results are written
+ *  as JSON.
+ */
+
+#include "lib/film.h"
+#include "lib/config.h"
+#include "lib/util.h"
+#include "lib/cross.h"
+#include "lib/image.h"
+#include "lib/ratio.h"
+#include "lib/player.h"
+#include "lib/player_video.h"
+#include "lib/dcp_video.h"
+#include "lib/dcp_encoder.h"
+#include "lib/ffmpeg_encoder.h"
+#include "lib/transcode_job.h"
+#include "lib/job_manager.h"
+#include "lib/signal_manager.h"
+#include "lib/encode_server_finder.h"
+#include "lib/dcp_content_type.h"
+#include "lib/image_content.h"
+#include "lib/ffmpeg_content.h"
+#include "lib/dcp_content.h"
+#include "lib/string_text_file_content.h"
+#include "lib/text_content.h"
+#include "lib/video_content.h"
+#include "lib/file_log.h"
+#include "lib/exceptions.h"
+#include "lib/dcpomatic_log.h"
+#include "lib/version.h"
+#include "lib/compose.hpp"
+#include <dcp/raw_convert.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <getopt.h>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <list>
+
+using std::string;
+using std::vector;
+using std::list;
+using std::cout;
+using std::cerr;
+using boost::shared_ptr;
+using boost::function;
+using boost::optional;
+using dcp::raw_convert;
+
+static boost::filesystem::path work = "build/benchmark";
+static int frames = 24;
+static int threads = 4;
+
+struct Result
+{
+	Result (string s, string m, int f, double t)
+		: scenario (s)
+		, mode (m)
+		, frames (f)
+		, seconds (t)
+	{}
+
+	string scenario;
+	string mode;
+	int frames;
+	double seconds;
+};
+
+class BenchmarkSignalManager : public SignalManager
+{
+public:
+	/* We call ui_idle ourselves */
+	void wake_ui () {}
+};
+
+static double
+now ()
+{
+	struct timeval tv;
+	gettimeofday (&tv, 0);
+	return seconds (tv);
+}
+
+static void
+wait_for_jobs ()
+{
+	JobManager* jm = JobManager::instance ();
+	while (jm->work_to_do ()) {
+		while (signal_manager->ui_idle ()) {}
+		dcpomatic_sleep (1);
+	}
+	while (signal_manager->ui_idle ()) {}
+
+	if (jm->errors ()) {
+		throw std::runtime_error ("job failed while setting up benchmark");
+	}
+}
+
+static shared_ptr<Film>
+new_film (string name, Resolution resolution)
+{
+	boost::filesystem::path const dir = work / name;
+	boost::filesystem::remove_all (dir);
+
+	shared_ptr<Film> film (new Film (dir));
+	film->set_name (name);
+	film->set_dcp_content_type (DCPContentType::from_isdcf_name ("TST"));
+	film->set_container (Ratio::from_id ("185"));
+	film->set_resolution (resolution);
+	film->set_video_frame_rate (24);
+	film->write_metadata ();
+	return film;
+}
+
+static dcp::Size
+size (Resolution resolution)
+{
+	return resolution == RESOLUTION_2K ? dcp::Size (1998, 1080) : dcp::Size (3996, 2160);
+}
+
+/** Write a PNG sequence of frames with some moving detail in them */
+static boost::filesystem::path
+image_sequence (string name, Resolution resolution)
+{
+	boost::filesystem::path const dir = work / "sources" / name;
+	if (boost::filesystem::exists (dir)) {
+		return dir;
+	}
+
+	boost::filesystem::create_directories (dir);
+	dcp::Size const s = size (resolution);
+	for (int i = 0; i < frames; ++i) {
+		shared_ptr<Image> image (new Image (AV_PIX_FMT_RGB24, s, true));
+		for (int y = 0; y < s.height; ++y) {
+			uint8_t* p = image->data()[0] + y * image->stride()[0];
+			for (int x = 0; x < s.width; ++x) {
+				*p++ = (x * y + i * 8) % 256;
+				*p++ = ((x + i) ^ y) % 256;
+				*p++ = (x + y * 3) % 256;
+			}
+		}
+		image->as_png().write (dir / String::compose ("%1.png", dcp::raw_convert<string> (10000 + i)));
+	}
+
+	return dir;
+}
+
+static void
+add (shared_ptr<Film> film, shared_ptr<Content> content)
+{
+	film->examine_and_add_content (content);
+	wait_for_jobs ();
+}
+
+static void
+make_dcp (shared_ptr<Film> film)
+{
+	shared_ptr<TranscodeJob> job (new TranscodeJob (film));
+	DCPEncoder encoder (film, job);
+	encoder.go ();
+}
+
+/** @return a film with a single image sequence in it */
+static shared_ptr<Film>
+image_film (string name, Resolution resolution)
+{
+	shared_ptr<Film> film = new_film (name, resolution);
+	add (film, shared_ptr<Content> (new ImageContent (image_sequence (name, resolution))));
+	return film;
+}
+
+/** @return an H.264 file exported from an image sequence */
+static boost::filesystem::path
+ffmpeg_source (Resolution resolution)
+{
+	string const name = resolution == RESOLUTION_2K ? "ffmpeg-source-2k" : "ffmpeg-source-4k";
+	boost::filesystem::path const file = work / "sources" / (name + ".mp4");
+	if (!boost::filesystem::exists (file)) {
+		shared_ptr<Film> film = image_film (name, resolution);
+		shared_ptr<TranscodeJob> job (new TranscodeJob (film));
+		FFmpegEncoder encoder (film, job, file, EXPORT_FORMAT_H264, false, false, 23);
+		encoder.go ();
+	}
+	return file;
+}
+
+/** @return a DCP made from an image sequence */
+static boost::filesystem::path
+dcp_source (Resolution resolution)
+{
+	string const name = resolution == RESOLUTION_2K ? "dcp-source-2k" : "dcp-source-4k";
+	shared_ptr<Film> film = image_film (name, resolution);
+	make_dcp (film);
+	return film->dir (film->dcp_name ());
+}
+
+/** Write a SubRip file with a subtitle on every half-second */
+static boost::filesystem::path
+subrip_source ()
+{
+	boost::filesystem::path const file = work / "sources" / "subtitles.srt";
+	FILE* f = fopen_boost (file, "w");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+	int const half_seconds = frames / 12 + 1;
+	for (int i = 0; i < half_seconds; ++i) {
+		int const from = i * 500;
+		int const to = from + 500;
+		fprintf (
+			f, "%d\n00:00:%02d,%03d --> 00:00:%02d,%03d\nBenchmark subtitle line %d\nwith a second line\n\n",
+			i + 1, from / 1000, from % 1000, to / 1000, to % 1000, i + 1
+			);
+	}
+	fclose (f);
+	return file;
+}
+
+static void
+run_some (function<void (size_t)> f, size_t n, size_t* next, boost::mutex* mutex)
+{
+	while (true) {
+		size_t i;
+		{
+			boost::mutex::scoped_lock lm (*mutex);
+			if (*next == n) {
+				return;
+			}
+			i = (*next)++;
+		}
+		f (i);
+	}
+}
+
+/** Call f(i) for i in [0, n) using `threads' threads */
+static void
+run_in_threads (function<void (size_t)> f, size_t n)
+{
+	boost::mutex mutex;
+	size_t next = 0;
+
+	boost::thread_group pool;
+	for (int i = 0; i < threads; ++i) {
+		pool.create_thread (boost::bind (&run_some, f, n, &next, &mutex));
+	}
+	pool.join_all ();
+}
+
+static void
+store_video (vector<shared_ptr<PlayerVideo> >* video, shared_ptr<PlayerVideo> pv)
+{
+	video->push_back (pv);
+}
+
+static void
+prepare (vector<shared_ptr<PlayerVideo> > const * video, size_t i)
+{
+	(*video)[i]->prepare (boost::bind (&PlayerVideo::keep_xyz_or_rgb, _1), true, false);
+}
+
+static void
+encode (shared_ptr<const Film> film, vector<shared_ptr<PlayerVideo> > const * video, size_t i)
+{
+	DCPVideo dv ((*video)[i], i, film->video_frame_rate(), film->j2k_bandwidth(), film->resolution());
+	dv.encode_locally ();
+}
+
+/** Run all the measurements on a film */
+static void
+measure (string scenario, shared_ptr<Film> film, list<Result>& results)
+{
+	cerr << scenario << ": decode";
+
+	vector<shared_ptr<PlayerVideo> > video;
+	shared_ptr<Player> player (new Player (film, film->playlist ()));
+	player->set_ignore_audio ();
+	player->Video.connect (boost::bind (&store_video, &video, _1));
+
+	double start = now ();
+	while (!player->pass ()) {}
+	results.push_back (Result (scenario, "decode", video.size(), now() - start));
+
+	cerr << ", prepare";
+	start = now ();
+	run_in_threads (boost::bind (&prepare, &video, _1), video.size());
+	results.push_back (Result (scenario, "prepare", video.size(), now() - start));
+
+	cerr << ", encode";
+	start = now ();
+	run_in_threads (boost::bind (&encode, film, &video, _1), video.size());
+	results.push_back (Result (scenario, "encode", video.size(), now() - start));
+
+	int const N = video.size ();
+	video.clear ();
+	player.reset ();
+
+	cerr << ", full";
+	start = now ();
+	make_dcp (film);
+	results.push_back (Result (scenario, "full", N, now() - start));
+
+	cerr << "\n";
+}
+
+static string
+json (list<Result> const & results)
+{
+	string j = "{\n";
+	j += "  \"version\": \"" + string (dcpomatic_version) + "\",\n";
+	j += "  \"git_commit\": \"" + string (dcpomatic_git_commit) + "\",\n";
+	j += "  \"threads\": " + raw_convert<string> (threads) + ",\n";
+	j += "  \"results\": [";
+	for (list<Result>::const_iterator i = results.begin(); i != results.end(); ++i) {
+		j += i == results.begin() ? "\n" : ",\n";
+		j += "    { \"scenario\": \"" + i->scenario + "\", \"mode\": \"" + i->mode + "\", ";
+		j += "\"frames\": " + raw_convert<string> (i->frames) + ", ";
+		j += "\"seconds\": " + raw_convert<string> (i->seconds) + ", ";
+		j += "\"fps\": " + raw_convert<string> (i->seconds > 0 ? i->frames / i->seconds : 0) + " }";
+	}
+	j += "\n  ]\n}\n";
+	return j;
+}
+
+static void
+help (string n)
+{
+	cerr << "Syntax: " << n << " [OPTION]\n"
+	     << "  -h, --help             show this help\n"
+	     << "  -t, --threads <n>      number of threads to use (default 4)\n"
+	     << "  -f, --frames <n>       number of frames in each film (default 24)\n"
+	     << "  -o, --output <file>    write JSON results to file rather than stdout\n"
+	     << "  -s, --scenario <name>  only run scenarios whose names contain this\n"
+	     << "  -w, --work <dir>       directory to build films in (default build/benchmark)\n";
+}
+
+int
+main (int argc, char* argv[])
+{
+	optional<boost::filesystem::path> output;
+	string only;
+
+	while (true) {
+		static struct option long_options[] = {
+			{ "help", no_argument, 0, 'h'},
+			{ "threads", required_argument, 0, 't'},
+			{ "frames", required_argument, 0, 'f'},
+			{ "output", required_argument, 0, 'o'},
+			{ "scenario", required_argument, 0, 's'},
+			{ "work", required_argument, 0, 'w'},
+			{ 0, 0, 0, 0 }
+		};
+
+		int option_index = 0;
+		int c = getopt_long (argc, argv, "ht:f:o:s:w:", long_options, &option_index);
+
+		if (c == -1) {
+			break;
+		}
+
+		switch (c) {
+		case 'h':
+			help (argv[0]);
+			exit (EXIT_SUCCESS);
+		case 't':
+			threads = atoi (optarg);
+			break;
+		case 'f':
+			frames = atoi (optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 's':
+			only = optarg;
+			break;
+		case 'w':
+			work = optarg;
+			break;
+		}
+	}
+
+	dcpomatic_setup_path_encoding ();
+	dcpomatic_setup ();
+	signal_manager = new BenchmarkSignalManager ();
+	EncodeServerFinder::instance()->stop ();
+
+	Config::instance()->set_master_encoding_threads (threads);
+	Config::instance()->set_only_servers_encode (false);
+	Config::instance()->set_automatic_audio_analysis (false);
+
+	boost::filesystem::create_directories (work / "sources");
+	dcpomatic_log.reset (new FileLog (work / "log"));
+
+	list<Result> results;
+
+	try {
+		if (string("2k-2d-image").find(only) != string::npos) {
+			measure ("2k-2d-image", image_film ("2k-2d-image", RESOLUTION_2K), results);
+		}
+
+		if (string("4k-2d-image").find(only) != string::npos) {
+			measure ("4k-2d-image", image_film ("4k-2d-image", RESOLUTION_4K), results);
+		}
+
+		if (string("2k-3d-image").find(only) != string::npos) {
+			shared_ptr<Film> film = new_film ("2k-3d-image", RESOLUTION_2K);
+			boost::filesystem::path const images = image_sequence ("2k-3d-image", RESOLUTION_2K);
+			shared_ptr<ImageContent> L (new ImageContent (images));
+			shared_ptr<ImageContent> R (new ImageContent (images));
+			add (film, L);
+			add (film, R);
+			L->video->set_frame_type (VIDEO_FRAME_TYPE_3D_LEFT);
+			R->video->set_frame_type (VIDEO_FRAME_TYPE_3D_RIGHT);
+			film->set_three_d (true);
+			measure ("2k-3d-image", film, results);
+		}
+
+		if (string("2k-2d-ffmpeg").find(only) != string::npos) {
+			shared_ptr<Film> film = new_film ("2k-2d-ffmpeg", RESOLUTION_2K);
+			add (film, shared_ptr<Content> (new FFmpegContent (ffmpeg_source (RESOLUTION_2K))));
+			measure ("2k-2d-ffmpeg", film, results);
+		}
+
+		if (string("4k-2d-ffmpeg").find(only) != string::npos) {
+			shared_ptr<Film> film = new_film ("4k-2d-ffmpeg", RESOLUTION_4K);
+			add (film, shared_ptr<Content> (new FFmpegContent (ffmpeg_source (RESOLUTION_4K))));
+			measure ("4k-2d-ffmpeg", film, results);
+		}
+
+		if (string("2k-2d-dcp").find(only) != string::npos) {
+			shared_ptr<Film> film = new_film ("2k-2d-dcp", RESOLUTION_2K);
+			add (film, shared_ptr<Content> (new DCPContent (dcp_source (RESOLUTION_2K))));
+			measure ("2k-2d-dcp", film, results);
+		}
+
+		if (string("2k-2d-image-subtitles").find(only) != string::npos) {
+			shared_ptr<Film> film = image_film ("2k-2d-image-subtitles", RESOLUTION_2K);
+			shared_ptr<StringTextFileContent> sub (new StringTextFileContent (subrip_source ()));
+			add (film, sub);
+			sub->only_text()->set_use (true);
+			sub->only_text()->set_burn (true);
+			measure ("2k-2d-image-subtitles", film, results);
+		}
+
+		if (string("2k-2d-image-reels").find(only) != string::npos) {
+			shared_ptr<Film> film = image_film ("2k-2d-image-reels", RESOLUTION_2K);
+			add (film, shared_ptr<Content> (new ImageContent (image_sequence ("2k-2d-image-reels", RESOLUTION_2K))));
+			film->set_reel_type (REELTYPE_BY_VIDEO_CONTENT);
+			measure ("2k-2d-image-reels", film, results);
+		}
+	} catch (std::exception& e) {
+		cerr << argv[0] << ": " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	}
+
+	string const j = json (results);
+	if (output) {
+		FILE* f = fopen_boost (*output, "w");
+		if (!f) {
+			cerr << argv[0] << ": could not open " << output->string() << " for writing\n";
+			exit (EXIT_FAILURE);
+		}
+		fwrite (j.c_str(), 1, j.length(), f);
+		fclose (f);
+	} else {
+		cout << j;
+	}
+
+	JobManager::drop ();
+	return 0;
+}
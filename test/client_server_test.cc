@@ -35,6 +35,8 @@
 #include "lib/raw_image_proxy.h"
 #include "lib/j2k_image_proxy.h"
 #include "lib/encode_server_description.h"
+#include "lib/encode_server_cache.h"
+#include "lib/j2k_encoder.h"
 #include "lib/file_log.h"
 #include "lib/dcpomatic_log.h"
 #include <boost/test/unit_test.hpp>
@@ -324,3 +326,70 @@ BOOST_AUTO_TEST_CASE (client_server_test_j2k)
 	delete server_thread;
 	delete server;
 }
+
+/** Check that servers added to the cache survive a write and re-read */
+BOOST_AUTO_TEST_CASE (encode_server_cache_test)
+{
+	/* Keep the cache out of the user's own state directory */
+	optional<boost::filesystem::path> const old_override = State::override_path;
+	State::override_path = "build/test/encode_server_cache_test";
+	boost::filesystem::remove_all (*State::override_path);
+
+	{
+		EncodeServerCache cache;
+		EncodeServerDescription a ("192.168.0.10", 8, SERVER_LINK_VERSION);
+		a.set_frames_per_second (24.5, optional<float>());
+		cache.add (a);
+		cache.add (EncodeServerDescription ("192.168.0.11", 4, SERVER_LINK_VERSION));
+		/* Adding the same host again should replace the old entry */
+		cache.add (EncodeServerDescription ("192.168.0.11", 16, SERVER_LINK_VERSION));
+	}
+
+	EncodeServerCache cache;
+	cache.read ();
+	list<EncodeServerDescription> servers = cache.servers ();
+	BOOST_REQUIRE_EQUAL (servers.size(), 2U);
+	BOOST_CHECK_EQUAL (servers.front().host_name(), "192.168.0.10");
+	BOOST_CHECK_EQUAL (servers.front().threads(), 8);
+	BOOST_CHECK_EQUAL (servers.front().link_version(), SERVER_LINK_VERSION);
+	BOOST_REQUIRE (servers.front().frames_per_second_2k());
+	BOOST_CHECK_CLOSE (*servers.front().frames_per_second_2k(), 24.5, 0.1);
+	BOOST_CHECK (!servers.front().frames_per_second_4k());
+	BOOST_CHECK_EQUAL (servers.back().host_name(), "192.168.0.11");
+	BOOST_CHECK_EQUAL (servers.back().threads(), 16);
+
+	State::override_path = old_override;
+}
+
+/** Check how many of our worker threads J2KEncoder gives to each server */
+BOOST_AUTO_TEST_CASE (j2k_encoder_remote_threads_test)
+{
+	/* 2 frames per second per thread at 2K */
+	EncodeServerDescription fast ("192.168.0.20", 8, SERVER_LINK_VERSION);
+	fast.set_frames_per_second (16, 4);
+	/* 1 frame per second per thread at 2K; as fast as `fast' at 4K */
+	EncodeServerDescription slow ("192.168.0.21", 4, SERVER_LINK_VERSION);
+	slow.set_frames_per_second (4, 2);
+	/* Not calibrated */
+	EncodeServerDescription unknown ("192.168.0.22", 6, SERVER_LINK_VERSION);
+	/* Already has more work than it can start */
+	EncodeServerDescription busy ("192.168.0.23", 6, SERVER_LINK_VERSION);
+	busy.set_load (6, 4);
+	/* Very busy indeed */
+	EncodeServerDescription swamped ("192.168.0.24", 6, SERVER_LINK_VERSION);
+	swamped.set_load (6, 40);
+
+	list<EncodeServerDescription> servers;
+	servers.push_back (fast);
+	servers.push_back (slow);
+	servers.push_back (unknown);
+	servers.push_back (busy);
+	servers.push_back (swamped);
+
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (fast, servers, RESOLUTION_2K), 8);
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (slow, servers, RESOLUTION_2K), 2);
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (slow, servers, RESOLUTION_4K), 4);
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (unknown, servers, RESOLUTION_2K), 6);
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (busy, servers, RESOLUTION_2K), 2);
+	BOOST_CHECK_EQUAL (J2KEncoder::remote_threads (swamped, servers, RESOLUTION_2K), 1);
+}
@@ -19,11 +19,28 @@
 */
 
 #include "lib/config.h"
+#include "lib/cinema.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
 #include <fstream>
 
 using std::ofstream;
+using std::list;
+using std::string;
+using boost::shared_ptr;
+
+/** Copy a cinemas file and its journal, as they are now, to another name */
+static void
+copy_cinemas (boost::filesystem::path from, boost::filesystem::path to)
+{
+	boost::system::error_code ec;
+	boost::filesystem::remove (to, ec);
+	boost::filesystem::remove (to.string() + ".journal", ec);
+	boost::filesystem::copy_file (from, to);
+	if (boost::filesystem::exists (from.string() + ".journal")) {
+		boost::filesystem::copy_file (from.string() + ".journal", to.string() + ".journal");
+	}
+}
 
 static void
 rewrite_bad_config ()
@@ -94,3 +111,121 @@ BOOST_AUTO_TEST_CASE (config_backup_test)
 	*/
 	setup_test_config ();
 }
+
+/** Check that changes to cinemas are written to the journal and read back */
+BOOST_AUTO_TEST_CASE (config_cinemas_journal_test)
+{
+	boost::filesystem::path const original = Config::instance()->cinemas_file ();
+
+	boost::system::error_code ec;
+	boost::filesystem::remove ("build/test/journal_cinemas.xml", ec);
+	boost::filesystem::remove ("build/test/journal_cinemas.xml.journal", ec);
+
+	ofstream f ("build/test/empty_cinemas.xml");
+	f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	  << "<Cinemas><Version>1</Version></Cinemas>\n";
+	f.close ();
+
+	Config::instance()->set_cinemas_file ("build/test/empty_cinemas.xml");
+	Config::instance()->set_cinemas_file ("build/test/journal_cinemas.xml");
+	BOOST_CHECK (Config::instance()->cinemas().empty());
+
+	list<string> emails;
+	emails.push_back ("fred@example.com");
+	shared_ptr<Cinema> fred (new Cinema ("Fred's", emails, "", 0, 0));
+	Config::instance()->add_cinema (fred);
+	shared_ptr<Cinema> jim (new Cinema ("Jim's", list<string>(), "", 0, 0));
+	Config::instance()->add_cinema (jim);
+	Config::instance()->write_cinemas ();
+
+	fred->name = "Frederick's";
+	Config::instance()->cinema_changed (fred);
+	Config::instance()->remove_cinema (jim);
+	Config::instance()->write_cinemas ();
+
+	/* The first write to a new file writes everything; the second just appends to the journal */
+	BOOST_CHECK (boost::filesystem::exists ("build/test/journal_cinemas.xml"));
+	BOOST_CHECK (boost::filesystem::exists ("build/test/journal_cinemas.xml.journal"));
+
+	/* Read everything back in from a copy, since moving away from a file folds its journal into it */
+	copy_cinemas ("build/test/journal_cinemas.xml", "build/test/journal_cinemas_copy.xml");
+	Config::instance()->set_cinemas_file ("build/test/empty_cinemas.xml");
+	BOOST_CHECK (Config::instance()->cinemas().empty());
+	BOOST_CHECK (!boost::filesystem::exists ("build/test/journal_cinemas.xml.journal"));
+	Config::instance()->set_cinemas_file ("build/test/journal_cinemas_copy.xml");
+	BOOST_CHECK (boost::filesystem::exists ("build/test/journal_cinemas_copy.xml.journal"));
+
+	list<shared_ptr<Cinema> > cinemas = Config::instance()->cinemas ();
+	BOOST_REQUIRE_EQUAL (cinemas.size(), 1U);
+	BOOST_CHECK_EQUAL (cinemas.front()->name, "Frederick's");
+	BOOST_CHECK_EQUAL (cinemas.front()->id(), fred->id());
+	BOOST_CHECK (Config::instance()->find_cinema ("fred@example.com") == cinemas.front());
+	BOOST_CHECK (Config::instance()->find_cinema ("Frederick's") == cinemas.front());
+	BOOST_CHECK (!Config::instance()->find_cinema ("Jim's"));
+
+	/* The compacted original should say the same thing on its own */
+	Config::instance()->set_cinemas_file ("build/test/journal_cinemas.xml");
+	cinemas = Config::instance()->cinemas ();
+	BOOST_REQUIRE_EQUAL (cinemas.size(), 1U);
+	BOOST_CHECK_EQUAL (cinemas.front()->name, "Frederick's");
+	BOOST_CHECK_EQUAL (cinemas.front()->id(), fred->id());
+
+	Config::instance()->set_cinemas_file (original);
+}
+
+/** Check that cinemas from a file written before cinemas had IDs survive edits and a re-load */
+BOOST_AUTO_TEST_CASE (config_cinemas_legacy_journal_test)
+{
+	boost::filesystem::path const original = Config::instance()->cinemas_file ();
+
+	boost::system::error_code ec;
+	boost::filesystem::remove ("build/test/legacy_cinemas.xml.journal", ec);
+
+	ofstream f ("build/test/legacy_cinemas.xml");
+	f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	  << "<Cinemas><Version>1</Version>"
+	  << "<Cinema><Name>Odeon</Name><Email>dup@example.com</Email><Notes></Notes><UTCOffsetHour>0</UTCOffsetHour><UTCOffsetMinute>0</UTCOffsetMinute></Cinema>"
+	  << "<Cinema><Name>dup@example.com</Name><Notes></Notes><UTCOffsetHour>0</UTCOffsetHour><UTCOffsetMinute>0</UTCOffsetMinute></Cinema>"
+	  << "<Cinema><Name>Roxy</Name><Notes></Notes><UTCOffsetHour>0</UTCOffsetHour><UTCOffsetMinute>0</UTCOffsetMinute></Cinema>"
+	  << "</Cinemas>\n";
+	f.close ();
+
+	Config::instance()->set_cinemas_file ("build/test/legacy_cinemas.xml");
+	list<shared_ptr<Cinema> > cinemas = Config::instance()->cinemas ();
+	BOOST_REQUIRE_EQUAL (cinemas.size(), 3U);
+
+	/* As with a search of the list, the first cinema matching by name or email is found */
+	BOOST_CHECK (Config::instance()->find_cinema ("dup@example.com") == cinemas.front());
+
+	shared_ptr<Cinema> odeon = cinemas.front ();
+	shared_ptr<Cinema> roxy = cinemas.back ();
+	odeon->name = "Odeon Leicester Square";
+	Config::instance()->cinema_changed (odeon);
+	Config::instance()->remove_cinema (roxy);
+	Config::instance()->write_cinemas ();
+
+	/* Edit again; this time the change can go in the journal */
+	odeon->notes = "Big screen";
+	Config::instance()->cinema_changed (odeon);
+	Config::instance()->write_cinemas ();
+
+	ofstream e ("build/test/empty_cinemas.xml");
+	e << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	  << "<Cinemas><Version>1</Version></Cinemas>\n";
+	e.close ();
+
+	BOOST_CHECK (boost::filesystem::exists ("build/test/legacy_cinemas.xml.journal"));
+	copy_cinemas ("build/test/legacy_cinemas.xml", "build/test/legacy_cinemas_copy.xml");
+	Config::instance()->set_cinemas_file ("build/test/empty_cinemas.xml");
+	Config::instance()->set_cinemas_file ("build/test/legacy_cinemas_copy.xml");
+
+	cinemas = Config::instance()->cinemas ();
+	BOOST_REQUIRE_EQUAL (cinemas.size(), 2U);
+	BOOST_CHECK_EQUAL (cinemas.front()->name, "Odeon Leicester Square");
+	BOOST_CHECK_EQUAL (cinemas.front()->notes, "Big screen");
+	BOOST_CHECK_EQUAL (cinemas.front()->id(), odeon->id());
+	BOOST_CHECK_EQUAL (cinemas.back()->name, "dup@example.com");
+	BOOST_CHECK (!Config::instance()->find_cinema ("Roxy"));
+
+	Config::instance()->set_cinemas_file (original);
+}
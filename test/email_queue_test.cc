@@ -0,0 +1,210 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/email_queue_test.cc
+ *  @brief Test EmailQueue against a minimal SMTP server running on localhost.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/email_queue.h"
+#include "lib/emailer.h"
+#include "lib/compose.hpp"
+#include <boost/test/unit_test.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+
+using std::string;
+using std::list;
+using boost::shared_ptr;
+using boost::optional;
+using boost::asio::ip::tcp;
+
+/** Just enough of an SMTP server to accept mail from libcurl */
+class TestSMTPServer
+{
+public:
+	explicit TestSMTPServer (int port)
+		: _acceptor (_io_service, tcp::endpoint (boost::asio::ip::address::from_string ("127.0.0.1"), port))
+		, _connections (0)
+		, _messages (0)
+	{
+		start_accept ();
+		_thread = boost::thread (boost::bind (&boost::asio::io_service::run, &_io_service));
+	}
+
+	~TestSMTPServer ()
+	{
+		/* Accepts are asynchronous, so this will stop the accepting thread even if it is waiting for a connection */
+		_io_service.stop ();
+		_thread.join ();
+		_sessions.join_all ();
+	}
+
+	int connections () const {
+		boost::mutex::scoped_lock lm (_mutex);
+		return _connections;
+	}
+
+	int messages () const {
+		boost::mutex::scoped_lock lm (_mutex);
+		return _messages;
+	}
+
+private:
+	void start_accept ()
+	{
+		shared_ptr<tcp::socket> socket (new tcp::socket (_io_service));
+		_acceptor.async_accept (*socket, boost::bind (&TestSMTPServer::handle_accept, this, socket, boost::asio::placeholders::error));
+	}
+
+	void handle_accept (shared_ptr<tcp::socket> socket, boost::system::error_code const & ec)
+	{
+		if (ec) {
+			return;
+		}
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			++_connections;
+		}
+
+		_sessions.create_thread (boost::bind (&TestSMTPServer::session, this, socket));
+		start_accept ();
+	}
+
+	void session (shared_ptr<tcp::socket> socket)
+	try
+	{
+		boost::asio::streambuf buffer;
+		reply (socket, "220 localhost");
+
+		while (true) {
+			boost::asio::read_until (*socket, buffer, "\r\n");
+			std::istream stream (&buffer);
+			string line;
+			std::getline (stream, line);
+			boost::algorithm::trim (line);
+			string const command = boost::algorithm::to_upper_copy (line.substr (0, 4));
+
+			if (command == "DATA") {
+				reply (socket, "354 go ahead");
+				size_t const n = boost::asio::read_until (*socket, buffer, "\r\n.\r\n");
+				buffer.consume (n);
+				{
+					boost::mutex::scoped_lock lm (_mutex);
+					++_messages;
+				}
+				reply (socket, "250 OK");
+			} else if (command == "QUIT") {
+				reply (socket, "221 bye");
+				return;
+			} else {
+				reply (socket, "250 OK");
+			}
+		}
+	}
+	catch (...)
+	{
+
+	}
+
+	void reply (shared_ptr<tcp::socket> socket, string r)
+	{
+		r += "\r\n";
+		boost::asio::write (*socket, boost::asio::buffer (r));
+	}
+
+	boost::asio::io_service _io_service;
+	tcp::acceptor _acceptor;
+	boost::thread _thread;
+	boost::thread_group _sessions;
+	mutable boost::mutex _mutex;
+	int _connections;
+	int _messages;
+};
+
+class Results
+{
+public:
+	Results ()
+		: ok (0)
+		, failed (0)
+	{}
+
+	void done (optional<string> error)
+	{
+		boost::mutex::scoped_lock lm (mutex);
+		if (error) {
+			++failed;
+		} else {
+			++ok;
+		}
+	}
+
+	boost::mutex mutex;
+	int ok;
+	int failed;
+};
+
+static shared_ptr<Emailer>
+test_email (int n)
+{
+	list<string> to;
+	to.push_back ("cinema@example.com");
+	return shared_ptr<Emailer> (new Emailer ("dcpomatic@example.com", to, "KDMs", String::compose ("Here are some KDMs (%1)", n)));
+}
+
+/** Send some emails through a queue with a couple of connections and check that they all
+ *  arrive without opening a new connection for each one.
+ */
+BOOST_AUTO_TEST_CASE (email_queue_test)
+{
+	TestSMTPServer server (31789);
+
+	Results results;
+	EmailQueue queue ("127.0.0.1", 31789, EMAIL_PROTOCOL_PLAIN, "", "", 2, 1);
+	for (int i = 0; i < 10; ++i) {
+		queue.add (test_email (i), boost::bind (&Results::done, &results, _1));
+	}
+
+	queue.send ();
+
+	BOOST_CHECK_EQUAL (results.ok, 10);
+	BOOST_CHECK_EQUAL (results.failed, 0);
+	BOOST_CHECK_EQUAL (server.messages(), 10);
+	BOOST_CHECK (server.connections() <= 2);
+}
+
+/** Check that failures are reported for each email when there is no server */
+BOOST_AUTO_TEST_CASE (email_queue_failure_test)
+{
+	Results results;
+	EmailQueue queue ("127.0.0.1", 31790, EMAIL_PROTOCOL_PLAIN, "", "", 2, 2);
+	for (int i = 0; i < 3; ++i) {
+		queue.add (test_email (i), boost::bind (&Results::done, &results, _1));
+	}
+
+	queue.send ();
+
+	BOOST_CHECK_EQUAL (results.ok, 0);
+	BOOST_CHECK_EQUAL (results.failed, 3);
+}
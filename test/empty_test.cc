@@ -34,7 +34,7 @@ using boost::shared_ptr;
 bool
 has_video (shared_ptr<Piece> piece)
 {
-        return piece->decoder && piece->decoder->video;
+        return static_cast<bool> (piece->content->video);
 }
 
 BOOST_AUTO_TEST_CASE (empty_test1)
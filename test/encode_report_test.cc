@@ -0,0 +1,50 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/encode_report_test.cc
+ *  @brief Test EncodeReport.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/encode_report.h"
+#include <boost/test/unit_test.hpp>
+
+using std::string;
+
+BOOST_AUTO_TEST_CASE (encode_report_test)
+{
+	EncodeReport report;
+
+	report.add_phase ("decode", 4);
+	report.add_phase ("encode", 0.5);
+	for (int i = 1; i <= 100; ++i) {
+		report.add_latency ("localhost", i);
+	}
+	report.add_latency ("server", 2);
+	report.add_count ("full_written", 100);
+	report.add_count ("pushed_to_disk", 0);
+
+	string const json = report.json ();
+
+	BOOST_CHECK (json.find ("\"phases\": { \"decode\": 4, \"encode\": 0.5 }") != string::npos);
+	BOOST_CHECK (json.find ("\"localhost\": { \"frames\": 100, \"mean\": 50.5, \"p50\": 50, \"p90\": 90, \"p99\": 99, \"max\": 100 }") != string::npos);
+	BOOST_CHECK (json.find ("\"server\": { \"frames\": 1, \"mean\": 2, \"p50\": 2, \"p90\": 2, \"p99\": 2, \"max\": 2 }") != string::npos);
+	BOOST_CHECK (json.find ("\"counts\": { \"full_written\": 100, \"pushed_to_disk\": 0 }") != string::npos);
+}
@@ -0,0 +1,217 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/examine_content_batch_test.cc
+ *  @brief Test examination of several pieces of content in one ExamineContentJob,
+ *  and the ExaminationCache.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/film.h"
+#include "lib/playlist.h"
+#include "lib/content_factory.h"
+#include "lib/video_content.h"
+#include "lib/image_content.h"
+#include "lib/examination_cache.h"
+#include "lib/cross.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <iterator>
+
+using std::string;
+using std::ifstream;
+using std::ofstream;
+using boost::shared_ptr;
+using boost::optional;
+using boost::bind;
+
+static int playlist_changes = 0;
+
+static void
+playlist_changed (ChangeType type)
+{
+	if (type == CHANGE_TYPE_DONE) {
+		++playlist_changes;
+	}
+}
+
+/** Add a batch including two identical pieces of content and check that everything is
+ *  examined, that the content is placed one after the other and that the playlist only
+ *  changes once.
+ */
+BOOST_AUTO_TEST_CASE (examine_content_batch_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("examine_content_batch_test");
+
+	ContentList content;
+	content.push_back (content_factory("test/data/flat_red.png").front());
+	content.push_back (content_factory("test/data/flat_green.png").front());
+	content.push_back (content_factory("test/data/flat_red.png").front());
+	content.push_back (content_factory("test/data/flat_blue.png").front());
+
+	boost::signals2::scoped_connection c = film->playlist()->Change.connect (bind (&playlist_changed, _1));
+	film->examine_and_add_content (content);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	BOOST_CHECK_EQUAL (playlist_changes, 1);
+
+	ContentList added = film->content ();
+	BOOST_REQUIRE_EQUAL (added.size(), 4U);
+
+	DCPTime position;
+	BOOST_FOREACH (shared_ptr<Content> i, added) {
+		BOOST_REQUIRE (i->video);
+		BOOST_CHECK (i->video->length() > 0);
+		BOOST_CHECK (!i->digest().empty());
+		BOOST_CHECK (i->position() == position);
+		position = i->end(film);
+	}
+
+	BOOST_CHECK_EQUAL (added[0]->path(0), added[2]->path(0));
+	BOOST_CHECK_EQUAL (added[0]->digest(), added[2]->digest());
+}
+
+/** Check that a folder of images, which has to be scanned as part of its examination, can be
+ *  examined in a batch (where the content is examined without a job).
+ */
+BOOST_AUTO_TEST_CASE (examine_content_batch_image_folder_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("examine_content_batch_image_folder_test");
+
+	ContentList content;
+	content.push_back (shared_ptr<Content> (new ImageContent("test/data/3d_test")));
+	content.push_back (content_factory("test/data/flat_red.png").front());
+	film->examine_and_add_content (content);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	ContentList added = film->content ();
+	BOOST_REQUIRE_EQUAL (added.size(), 2U);
+	BOOST_REQUIRE (added[0]->video);
+	BOOST_CHECK (added[0]->number_of_paths() > 1);
+	BOOST_CHECK_EQUAL (added[0]->video->length(), Frame (added[0]->number_of_paths()));
+}
+
+/** Check that a second batch of the same content is taken from the ExaminationCache */
+BOOST_AUTO_TEST_CASE (examination_cache_test)
+{
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	shared_ptr<Film> film = new_test_film2 ("examination_cache_test1");
+	optional<string> key = ExaminationCache::key (film, A);
+	BOOST_REQUIRE (key);
+
+	film->examine_and_add_content (ContentList (1, A));
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	shared_ptr<Content> cached = ExaminationCache::instance()->get (*key);
+	BOOST_REQUIRE (cached);
+	BOOST_REQUIRE (cached->video);
+	BOOST_CHECK_EQUAL (cached->video->length(), A->video->length());
+	BOOST_CHECK_EQUAL (cached->digest(), A->digest());
+
+	/* The same file, as yet unexamined, should give the same key */
+	shared_ptr<Content> B = content_factory("test/data/flat_red.png").front();
+	shared_ptr<Film> film2 = new_test_film2 ("examination_cache_test2");
+	BOOST_CHECK (ExaminationCache::key(film2, B) == key);
+
+	/* A film with a different frame rate would give a different still length, so it needs a different key */
+	shared_ptr<Film> film3 = new_test_film2 ("examination_cache_test3");
+	film3->set_video_frame_rate (25);
+	BOOST_CHECK (ExaminationCache::key(film3, B) != key);
+
+	film2->examine_and_add_content (ContentList (1, B));
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	BOOST_REQUIRE_EQUAL (film2->content().size(), 1U);
+	BOOST_CHECK (film2->content().front() != B);
+	BOOST_CHECK_EQUAL (film2->content().front()->digest(), A->digest());
+	BOOST_CHECK_EQUAL (film2->content().front()->video->length(), A->video->length());
+}
+
+/** Check that a cache file is only used if it was written by the same version of the cache */
+BOOST_AUTO_TEST_CASE (examination_cache_version_test)
+{
+	optional<boost::filesystem::path> const old_override = State::override_path;
+	State::override_path = "build/test/examination_cache_version_test";
+	boost::filesystem::remove_all (*State::override_path);
+	boost::filesystem::create_directories (*State::override_path);
+
+	shared_ptr<Film> film = new_test_film2 ("examination_cache_version_test");
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (A);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	ExaminationCache written;
+	written.add ("A", A);
+	written.write ();
+
+	ExaminationCache same;
+	same.read ();
+	BOOST_CHECK (same.get("A"));
+
+	boost::filesystem::path const file = *State::override_path / "examination_cache.xml";
+	string xml;
+	{
+		ifstream f (file.string().c_str());
+		xml.assign (std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+	BOOST_REQUIRE (xml.find("<Version>1</Version>") != string::npos);
+	boost::algorithm::replace_first (xml, "<Version>1</Version>", "<Version>2</Version>");
+	{
+		ofstream f (file.string().c_str());
+		f << xml;
+	}
+
+	ExaminationCache other;
+	other.read ();
+	BOOST_CHECK (!other.get("A"));
+
+	State::override_path = old_override;
+}
+
+/** Check that a piece of content in a batch which cannot be examined does not stop
+ *  the others from being added.
+ */
+BOOST_AUTO_TEST_CASE (examine_content_batch_failure_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("examine_content_batch_failure_test");
+
+	boost::filesystem::path const bad = "build/test/examine_content_batch_failure_test.mp4";
+	FILE* f = fopen_boost (bad, "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "This is not a video file\n");
+	fclose (f);
+
+	ContentList content;
+	content.push_back (content_factory("test/data/flat_red.png").front());
+	content.push_back (content_factory(bad).front());
+	content.push_back (content_factory("test/data/flat_blue.png").front());
+
+	film->examine_and_add_content (content);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	ContentList added = film->content ();
+	BOOST_REQUIRE_EQUAL (added.size(), 2U);
+	BOOST_CHECK_EQUAL (added[0]->path(0), "test/data/flat_red.png");
+	BOOST_CHECK_EQUAL (added[1]->path(0), "test/data/flat_blue.png");
+}
@@ -33,8 +33,10 @@
 #include "lib/content_factory.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
 
 using std::string;
+using std::list;
 using boost::shared_ptr;
 
 static void
@@ -338,3 +340,69 @@ BOOST_AUTO_TEST_CASE (ffmpeg_encoder_h264_test7)
 	encoder.go ();
 }
 
+
+/** Test export of a multi-reel film to one file per reel, with the reels encoded at the same time */
+BOOST_AUTO_TEST_CASE (ffmpeg_encoder_h264_test8)
+{
+	shared_ptr<Film> film = new_test_film2 ("ffmpeg_encoder_h264_test8");
+	shared_ptr<ImageContent> r (new ImageContent("test/data/flat_red.png"));
+	shared_ptr<ImageContent> g (new ImageContent("test/data/flat_green.png"));
+	shared_ptr<ImageContent> b (new ImageContent("test/data/flat_blue.png"));
+	film->examine_and_add_content (r);
+	film->examine_and_add_content (g);
+	film->examine_and_add_content (b);
+	film->set_reel_type (REELTYPE_BY_VIDEO_CONTENT);
+	BOOST_REQUIRE (!wait_for_jobs());
+	BOOST_REQUIRE_EQUAL (film->reels().size(), 3U);
+
+	shared_ptr<Job> job (new TranscodeJob (film));
+	FFmpegEncoder encoder (film, job, "build/test/ffmpeg_encoder_h264_test8.mp4", EXPORT_FORMAT_H264, false, true, 23);
+	encoder.set_max_segment_threads (3);
+	BOOST_REQUIRE_EQUAL (encoder.segment_threads(), 3);
+	encoder.go ();
+
+	BOOST_CHECK_EQUAL (encoder.frames_done(), film->length().frames_round(film->video_frame_rate()));
+
+	/* Each reel should be in its own file, complete */
+	shared_ptr<Film> check = new_test_film2 ("ffmpeg_encoder_h264_test8_check");
+	list<DCPTimePeriod> reels = film->reels ();
+	int n = 1;
+	BOOST_FOREACH (DCPTimePeriod i, reels) {
+		boost::filesystem::path const file = String::compose ("build/test/ffmpeg_encoder_h264_test8_reel%1.mp4", n);
+		BOOST_REQUIRE (boost::filesystem::exists (file));
+		shared_ptr<FFmpegContent> reel (new FFmpegContent(file));
+		check->examine_and_add_content (reel);
+		BOOST_REQUIRE (!wait_for_jobs());
+		BOOST_CHECK_EQUAL (reel->video->length(), i.duration().frames_round(film->video_frame_rate()));
+		++n;
+	}
+}
+
+/** Check that the threaded encode and mux of an export keeps all the video and audio */
+BOOST_AUTO_TEST_CASE (ffmpeg_encoder_h264_test9)
+{
+	shared_ptr<Film> film = new_test_film2 ("ffmpeg_encoder_h264_test9");
+	shared_ptr<ImageContent> image (new ImageContent("test/data/flat_red.png"));
+	film->examine_and_add_content (image);
+	shared_ptr<Content> sound = content_factory("test/data/staircase.wav").front();
+	film->examine_and_add_content (sound);
+	BOOST_REQUIRE (!wait_for_jobs());
+	image->video->set_length (48);
+
+	shared_ptr<Job> job (new TranscodeJob (film));
+	FFmpegEncoder encoder (film, job, "build/test/ffmpeg_encoder_h264_test9.mp4", EXPORT_FORMAT_H264, false, false, 23);
+	encoder.go ();
+
+	shared_ptr<Film> check = new_test_film2 ("ffmpeg_encoder_h264_test9_check");
+	shared_ptr<FFmpegContent> exported (new FFmpegContent("build/test/ffmpeg_encoder_h264_test9.mp4"));
+	check->examine_and_add_content (exported);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	BOOST_CHECK_EQUAL (exported->video->length(), film->length().frames_round(film->video_frame_rate()));
+	BOOST_REQUIRE (exported->audio);
+	BOOST_REQUIRE_EQUAL (exported->audio->streams().size(), 1U);
+	AudioStreamPtr stream = exported->audio->streams().front();
+	/* Allow one AAC frame of slack for the encoder's padding */
+	BOOST_CHECK_EQUAL (stream->frame_rate(), film->audio_frame_rate());
+	BOOST_CHECK (labs(stream->length() - film->length().frames_round(film->audio_frame_rate())) <= 1024);
+}
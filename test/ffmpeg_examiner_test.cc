@@ -45,6 +45,27 @@ BOOST_AUTO_TEST_CASE (ffmpeg_examiner_test)
 	BOOST_CHECK_EQUAL (examiner->audio_streams()[0]->first_audio.get().get(), ContentTime::from_seconds(600).get());
 }
 
+/** Check that the ways of finding a video length that do not trust the container's
+ *  duration count from the first video frame, not from 0, and include the last frame,
+ *  using data/count300bd24.m2ts (300 frames at 24fps starting at 600s).
+ */
+BOOST_AUTO_TEST_CASE (ffmpeg_examiner_length_test)
+{
+	shared_ptr<FFmpegContent> content (new FFmpegContent ("test/data/count300bd24.m2ts"));
+	shared_ptr<FFmpegExaminer> examiner (new FFmpegExaminer (content));
+
+	BOOST_REQUIRE (examiner->first_video());
+	BOOST_CHECK (examiner->first_video().get() > ContentTime());
+
+	boost::optional<Frame> end = examiner->end_video_length ();
+	BOOST_REQUIRE (end);
+	BOOST_CHECK_EQUAL (*end, 300);
+
+	examiner->_video_length = 0;
+	examiner->scan_video_length (shared_ptr<Job>());
+	BOOST_CHECK_EQUAL (examiner->video_length(), 300);
+}
+
 /** Check that audio sampling rate and channel counts are correctly picked up from
  *  a problematic file.  When we used to specify analyzeduration and probesize
  *  this file's details were picked up incorrectly.
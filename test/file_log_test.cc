@@ -24,10 +24,15 @@
  */
 
 #include "lib/file_log.h"
+#include "lib/cross.h"
+#include "lib/compose.hpp"
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 
 using std::cout;
+using std::string;
 
 BOOST_AUTO_TEST_CASE (file_log_test)
 {
@@ -35,3 +40,49 @@ BOOST_AUTO_TEST_CASE (file_log_test)
 	BOOST_CHECK_EQUAL (log.head_and_tail (1024), "This is a short log.\nWith only two lines.\n");
 	BOOST_CHECK_EQUAL (log.head_and_tail (8), "This is \n .\n .\n .\no lines.\n");
 }
+
+static void
+log_some (FileLog* log, int n)
+{
+	for (int i = 0; i < 100; ++i) {
+		log->log (String::compose ("general %1 %2", n, i), LogEntry::TYPE_GENERAL);
+		log->log (String::compose ("timing %1 %2", n, i), LogEntry::TYPE_TIMING);
+	}
+}
+
+/** Check that entries logged from several threads all end up in the file, and that
+ *  types which are not enabled are not written.
+ */
+BOOST_AUTO_TEST_CASE (file_log_write_test)
+{
+	boost::filesystem::path const file = "build/test/file_log_write_test.log";
+	boost::filesystem::remove (file);
+
+	{
+		FileLog log (file);
+		log.set_types (LogEntry::TYPE_GENERAL);
+		BOOST_CHECK (log.enabled (LogEntry::TYPE_GENERAL));
+		BOOST_CHECK (!log.enabled (LogEntry::TYPE_TIMING));
+
+		boost::thread_group threads;
+		for (int i = 0; i < 4; ++i) {
+			threads.create_thread (boost::bind (&log_some, &log, i));
+		}
+		threads.join_all ();
+	}
+
+	FILE* f = fopen_boost (file, "r");
+	BOOST_REQUIRE (f);
+	int general = 0;
+	char buffer[256];
+	while (fgets (buffer, sizeof(buffer), f)) {
+		string const line (buffer);
+		BOOST_CHECK (line.find ("timing") == string::npos);
+		if (line.find ("general") != string::npos) {
+			++general;
+		}
+	}
+	fclose (f);
+
+	BOOST_CHECK_EQUAL (general, 4 * 100);
+}
@@ -19,7 +19,7 @@
 */
 
 /** @file  test/film_metadata_test.cc
- *  @brief Test some basic reading/writing of film metadata.
+ *  @brief Test some basic reading/writing of film metadata, in the foreground and the background.
  *  @ingroup specific
  */
 
@@ -29,6 +29,8 @@
 #include "lib/film.h"
 #include "lib/dcp_content_type.h"
 #include "lib/ratio.h"
+#include "lib/content.h"
+#include "lib/content_factory.h"
 #include "test.h"
 
 using std::string;
@@ -66,3 +68,34 @@ BOOST_AUTO_TEST_CASE (film_metadata_test)
 	g->write_metadata ();
 	check_xml ("test/data/metadata.xml.ref", dir.string() + "/metadata.xml", ignore);
 }
+
+/** Test that background metadata writes are coalesced, that they see changes to content
+ *  made after earlier writes, and that they are finished when the Film is destroyed.
+ */
+BOOST_AUTO_TEST_CASE (film_metadata_background_test)
+{
+	boost::filesystem::path dir = test_film_dir ("film_metadata_background_test");
+
+	{
+		shared_ptr<Film> film = new_test_film2 ("film_metadata_background_test");
+		shared_ptr<Content> content = content_factory("test/data/flat_red.png").front();
+		/* Examine without a job so that nothing else holds a reference to film */
+		content->examine (film, shared_ptr<Job>());
+		film->add_content (content);
+
+		film->set_name ("first");
+		film->write_metadata_in_background ();
+		content->set_trim_start (ContentTime::from_seconds (1));
+		film->set_name ("second");
+		film->write_metadata_in_background ();
+		BOOST_CHECK (!film->dirty ());
+	}
+
+	BOOST_CHECK (!boost::filesystem::exists (dir / "metadata.xml.tmp"));
+
+	shared_ptr<Film> g (new Film (dir));
+	g->read_metadata ();
+	BOOST_CHECK_EQUAL (g->name(), "second");
+	BOOST_REQUIRE_EQUAL (g->content().size(), 1U);
+	BOOST_CHECK (g->content().front()->trim_start() == ContentTime::from_seconds (1));
+}
@@ -34,8 +34,9 @@ using boost::shared_ptr;
 class TestJob : public Job
 {
 public:
-	explicit TestJob (shared_ptr<Film> film)
+	explicit TestJob (shared_ptr<Film> film, Resource resource = RESOURCE_CPU)
 		: Job (film)
+		, _resource (resource)
 	{
 
 	}
@@ -69,6 +70,13 @@ public:
 	string json_name () const {
 		return "";
 	}
+
+	Resource resource () const {
+		return _resource;
+	}
+
+private:
+	Resource _resource;
 };
 
 BOOST_AUTO_TEST_CASE (job_manager_test)
@@ -85,3 +93,43 @@ BOOST_AUTO_TEST_CASE (job_manager_test)
 	dcpomatic_sleep (2);
 	BOOST_CHECK_EQUAL (a->finished_ok(), true);
 }
+
+/** Check that jobs using different resources run at the same time, and that
+ *  jobs using the same resource wait for each other.
+ */
+BOOST_AUTO_TEST_CASE (job_manager_resource_test)
+{
+	shared_ptr<Film> film;
+
+	int const cpu_limit = JobManager::instance()->resource_limit (Job::RESOURCE_CPU);
+	int const network_limit = JobManager::instance()->resource_limit (Job::RESOURCE_NETWORK);
+
+	JobManager::instance()->set_resource_limit (Job::RESOURCE_CPU, 1);
+	JobManager::instance()->set_resource_limit (Job::RESOURCE_NETWORK, 1);
+
+	shared_ptr<TestJob> a (new TestJob (film, Job::RESOURCE_CPU));
+	shared_ptr<TestJob> b (new TestJob (film, Job::RESOURCE_CPU));
+	shared_ptr<TestJob> c (new TestJob (film, Job::RESOURCE_NETWORK));
+
+	JobManager::instance()->add (a);
+	JobManager::instance()->add (b);
+	JobManager::instance()->add (c);
+	dcpomatic_sleep (1);
+	BOOST_CHECK_EQUAL (a->running (), true);
+	BOOST_CHECK_EQUAL (b->is_new (), true);
+	BOOST_CHECK_EQUAL (c->running (), true);
+
+	a->set_finished_ok ();
+	dcpomatic_sleep (1);
+	BOOST_CHECK_EQUAL (b->running (), true);
+	BOOST_CHECK_EQUAL (c->running (), true);
+
+	b->set_finished_ok ();
+	c->set_finished_ok ();
+	dcpomatic_sleep (1);
+	BOOST_CHECK_EQUAL (b->finished_ok(), true);
+	BOOST_CHECK_EQUAL (c->finished_ok(), true);
+	/* Put things back as they were for the tests which follow */
+	JobManager::instance()->set_resource_limit (Job::RESOURCE_CPU, cpu_limit);
+	JobManager::instance()->set_resource_limit (Job::RESOURCE_NETWORK, network_limit);
+}
@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/kdm_batch_test.cc
+ *  @brief Test making KDMs for several screens at once with KDMBatch.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/film.h"
+#include "lib/content_factory.h"
+#include "lib/config.h"
+#include "lib/cinema.h"
+#include "lib/screen.h"
+#include "lib/screen_kdm.h"
+#include "lib/compose.hpp"
+#include "test.h"
+#include <dcp/decrypted_kdm.h>
+#include <dcp/encrypted_kdm.h>
+#include <dcp/certificate_chain.h>
+#include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+
+using std::list;
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+using boost::optional;
+
+/** Make KDMs for some screens in different time zones using several threads and check that
+ *  each one is in the right place in the list, has the right validity period and
+ *  carries the same keys as a KDM made on its own.
+ */
+BOOST_AUTO_TEST_CASE (kdm_batch_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("kdm_batch_test");
+	film->examine_and_add_content (content_factory("test/data/flat_red.png").front());
+	film->set_encrypted (true);
+	BOOST_REQUIRE (!wait_for_jobs());
+	film->make_dcp ();
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	optional<boost::filesystem::path> cpl;
+	for (boost::filesystem::directory_iterator i(film->dir(film->dcp_name())); i != boost::filesystem::directory_iterator(); ++i) {
+		if (i->path().filename().string().substr(0, 4) == "cpl_") {
+			cpl = i->path();
+		}
+	}
+	BOOST_REQUIRE (cpl);
+
+	shared_ptr<const dcp::CertificateChain> chain = Config::instance()->decryption_chain ();
+
+	list<shared_ptr<Screen> > screens;
+	for (int i = 0; i < 8; ++i) {
+		shared_ptr<Cinema> cinema (new Cinema (String::compose("Cinema %1", i), list<string>(), "", i - 4, (i % 2) * 30));
+		optional<dcp::Certificate> recipient;
+		if (i != 3) {
+			/* One screen has no certificate, so it should be skipped */
+			recipient = chain->leaf ();
+		}
+		shared_ptr<Screen> screen (new Screen (String::compose("Screen %1", i), "", recipient, vector<TrustedDevice>()));
+		cinema->add_screen (screen);
+		screens.push_back (screen);
+	}
+
+	boost::posix_time::ptime const from = boost::posix_time::time_from_string ("2020-01-01 10:00:00");
+	boost::posix_time::ptime const until = boost::posix_time::time_from_string ("2030-01-01 10:00:00");
+
+	int const threads = Config::instance()->master_encoding_threads ();
+	Config::instance()->set_master_encoding_threads (4);
+	list<ScreenKDM> kdms = film->make_kdms (screens, *cpl, from, until, dcp::MODIFIED_TRANSITIONAL_1, true, 0);
+	Config::instance()->set_master_encoding_threads (threads);
+	BOOST_REQUIRE_EQUAL (kdms.size(), 7U);
+
+	list<dcp::DecryptedKDMKey> const reference_keys = dcp::DecryptedKDM (
+		film->make_kdm (chain->leaf(), vector<string>(), *cpl, dcp::LocalTime(from, 0, 0), dcp::LocalTime(until, 0, 0), dcp::MODIFIED_TRANSITIONAL_1, true, 0),
+		chain->key().get()
+		).keys ();
+
+	list<shared_ptr<Screen> >::const_iterator screen = screens.begin ();
+	BOOST_FOREACH (ScreenKDM const & i, kdms) {
+		if (!(*screen)->recipient) {
+			++screen;
+		}
+		BOOST_REQUIRE (screen != screens.end());
+		BOOST_CHECK (i.screen == *screen);
+
+		shared_ptr<Cinema> cinema = (*screen)->cinema;
+		BOOST_CHECK_EQUAL (i.kdm.not_valid_before().as_string(), dcp::LocalTime(from, cinema->utc_offset_hour(), cinema->utc_offset_minute()).as_string());
+		BOOST_CHECK_EQUAL (i.kdm.not_valid_after().as_string(), dcp::LocalTime(until, cinema->utc_offset_hour(), cinema->utc_offset_minute()).as_string());
+
+		list<dcp::DecryptedKDMKey> const keys = dcp::DecryptedKDM(i.kdm, chain->key().get()).keys ();
+		BOOST_REQUIRE_EQUAL (keys.size(), reference_keys.size());
+		list<dcp::DecryptedKDMKey>::const_iterator j = keys.begin ();
+		BOOST_FOREACH (dcp::DecryptedKDMKey const & k, reference_keys) {
+			BOOST_CHECK_EQUAL (j->id(), k.id());
+			BOOST_CHECK_EQUAL (j->key().hex(), k.key().hex());
+			++j;
+		}
+
+		++screen;
+	}
+}
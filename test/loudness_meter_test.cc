@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/loudness_meter_test.cc
+ *  @brief Test LoudnessMeter class against the EBU Tech 3341 and 3342 test signals.
+ *  @ingroup selfcontained
+ *
+ *  The signals are generated here rather than read from the EBU's files;
+ *  tolerances are those given in the EBU documents.
+ */
+
+#include "lib/loudness_meter.h"
+#include "lib/audio_buffers.h"
+#include "lib/util.h"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <vector>
+
+using std::vector;
+using std::min;
+using boost::shared_ptr;
+using boost::optional;
+
+/** A section of a sine wave test signal */
+struct Section
+{
+	Section (float level_, float seconds_)
+		: level (level_)
+		, seconds (seconds_)
+	{}
+
+	/** Peak level in dBFS */
+	float level;
+	float seconds;
+};
+
+/** Pass a sine wave test signal through a LoudnessMeter.
+ *  @param mask Bitmask of channels which should carry the signal; others will be silent.
+ */
+static void
+process (LoudnessMeter& meter, int sample_rate, int channels, int mask, vector<Section> sections, double frequency = 1000, double phase = 0)
+{
+	int64_t n = 0;
+	for (vector<Section>::const_iterator i = sections.begin(); i != sections.end(); ++i) {
+		float const amplitude = pow (10, i->level / 20);
+		int64_t remaining = int64_t (i->seconds * sample_rate);
+		while (remaining > 0) {
+			int const frames = min (remaining, int64_t (1920));
+			shared_ptr<AudioBuffers> buffers (new AudioBuffers (channels, frames));
+			buffers->make_silent ();
+			for (int j = 0; j < channels; ++j) {
+				if (mask & (1 << j)) {
+					for (int k = 0; k < frames; ++k) {
+						buffers->data(j)[k] = amplitude * sin (2 * M_PI * frequency * (n + k) / sample_rate + phase);
+					}
+				}
+			}
+			meter.process (buffers);
+			n += frames;
+			remaining -= frames;
+		}
+	}
+}
+
+static optional<float>
+integrated (int sample_rate, vector<Section> sections)
+{
+	LoudnessMeter meter (sample_rate, 2);
+	process (meter, sample_rate, 2, 3, sections);
+	return meter.integrated_loudness ();
+}
+
+static float
+range (vector<Section> sections)
+{
+	LoudnessMeter meter (48000, 2);
+	process (meter, 48000, 2, 3, sections);
+	return meter.loudness_range ();
+}
+
+/** Tech 3341 cases 1 to 4: integrated loudness of stereo 1kHz sine waves */
+BOOST_AUTO_TEST_CASE (loudness_meter_integrated_test)
+{
+	vector<Section> s;
+	s.push_back (Section (-23, 20));
+	optional<float> l = integrated (48000, s);
+	BOOST_REQUIRE (l);
+	BOOST_CHECK (fabs (*l + 23) <= 0.1);
+
+	l = integrated (44100, s);
+	BOOST_REQUIRE (l);
+	BOOST_CHECK (fabs (*l + 23) <= 0.1);
+
+	s.clear ();
+	s.push_back (Section (-33, 20));
+	l = integrated (48000, s);
+	BOOST_REQUIRE (l);
+	BOOST_CHECK (fabs (*l + 33) <= 0.1);
+
+	/* The quieter sections should be removed by the relative gate */
+	s.clear ();
+	s.push_back (Section (-36, 10));
+	s.push_back (Section (-23, 60));
+	s.push_back (Section (-36, 10));
+	l = integrated (48000, s);
+	BOOST_REQUIRE (l);
+	BOOST_CHECK (fabs (*l + 23) <= 0.1);
+
+	/* and the very quiet ones by the absolute gate */
+	s.clear ();
+	s.push_back (Section (-72, 10));
+	s.push_back (Section (-36, 10));
+	s.push_back (Section (-23, 60));
+	s.push_back (Section (-36, 10));
+	s.push_back (Section (-72, 10));
+	l = integrated (48000, s);
+	BOOST_REQUIRE (l);
+	BOOST_CHECK (fabs (*l + 23) <= 0.1);
+
+	/* Nothing above the absolute gate gives no answer */
+	s.clear ();
+	s.push_back (Section (-80, 10));
+	BOOST_CHECK (!integrated (48000, s));
+}
+
+/** Tech 3342 cases 1 to 3: loudness range of stereo 1kHz sine waves */
+BOOST_AUTO_TEST_CASE (loudness_meter_range_test)
+{
+	vector<Section> s;
+	s.push_back (Section (-20, 20));
+	s.push_back (Section (-30, 20));
+	BOOST_CHECK (fabs (range (s) - 10) <= 1);
+
+	s.clear ();
+	s.push_back (Section (-20, 20));
+	s.push_back (Section (-15, 20));
+	BOOST_CHECK (fabs (range (s) - 5) <= 1);
+
+	s.clear ();
+	s.push_back (Section (-40, 20));
+	s.push_back (Section (-20, 20));
+	BOOST_CHECK (fabs (range (s) - 20) <= 1);
+}
+
+/** Tech 3341 true-peak cases: a sine at a quarter of the sample rate whose samples miss its peaks */
+BOOST_AUTO_TEST_CASE (loudness_meter_true_peak_test)
+{
+	vector<Section> s;
+	s.push_back (Section (0, 5));
+
+	int const rates[] = { 44100, 48000 };
+	for (int i = 0; i < 2; ++i) {
+		LoudnessMeter meter (rates[i], 2);
+		process (meter, rates[i], 2, 3, s, rates[i] / 4.0, M_PI / 4);
+		vector<float> peaks = meter.true_peaks ();
+		BOOST_REQUIRE_EQUAL (peaks.size(), 2U);
+		/* Samples are at -3dBFS but the true peak is 0dBTP; Tech 3341 allows +0.2/-0.4dB */
+		float const peak = 20 * log10 (peaks[0]);
+		BOOST_CHECK (peak > -0.4);
+		BOOST_CHECK (peak < 0.2);
+	}
+}
+
+/** Check the channel weightings from BS.1770 */
+BOOST_AUTO_TEST_CASE (loudness_meter_channel_weights_test)
+{
+	vector<Section> s;
+	s.push_back (Section (-23, 10));
+
+	/* A surround channel is 1.5dB louder than a front one (and a single channel is 3dB quieter than two) */
+	LoudnessMeter surround (48000, 6);
+	process (surround, 48000, 6, 1 << 4, s);
+	BOOST_REQUIRE (surround.integrated_loudness());
+	BOOST_CHECK (fabs (*surround.integrated_loudness() + 24.5) <= 0.1);
+
+	/* LFE does not count at all */
+	LoudnessMeter lfe (48000, 6);
+	process (lfe, 48000, 6, 1 << 3, s);
+	BOOST_CHECK (!lfe.integrated_loudness());
+
+	/* Nor do the motion data, sync signal and sign language channels */
+	for (int i = 12; i < MAX_DCP_AUDIO_CHANNELS; ++i) {
+		LoudnessMeter data (48000, MAX_DCP_AUDIO_CHANNELS);
+		process (data, 48000, MAX_DCP_AUDIO_CHANNELS, 1 << i, s);
+		BOOST_CHECK (!data.integrated_loudness());
+	}
+}
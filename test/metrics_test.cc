@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/metrics_test.cc
+ *  @brief Test Metrics.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/metrics.h"
+#include <boost/test/unit_test.hpp>
+
+using std::string;
+
+BOOST_AUTO_TEST_CASE (metrics_test)
+{
+	Metrics* m = Metrics::instance ();
+
+	/* Nothing is recorded until metrics are enabled */
+	m->add ("metrics_test_disabled_total");
+	BOOST_CHECK_EQUAL (m->get ("metrics_test_disabled_total"), 0);
+
+	m->set_enabled (true);
+	m->add ("metrics_test_frames_total");
+	m->add ("metrics_test_frames_total", 2);
+	m->add ("metrics_test_failures_total", 1, "foo");
+	m->set ("metrics_test_queue", 4);
+	m->set ("metrics_test_queue", 3);
+
+	BOOST_CHECK_EQUAL (m->get ("metrics_test_frames_total"), 3);
+	BOOST_CHECK_EQUAL (m->get ("metrics_test_failures_total", "foo"), 1);
+	BOOST_CHECK_EQUAL (m->get ("metrics_test_failures_total"), 0);
+	BOOST_CHECK_EQUAL (m->get ("metrics_test_queue"), 3);
+
+	string const json = m->json ();
+	BOOST_CHECK (json.find ("{ \"name\": \"metrics_test_frames_total\", \"type\": \"counter\", \"value\": 3 }") != string::npos);
+	BOOST_CHECK (json.find ("{ \"name\": \"metrics_test_failures_total\", \"type\": \"counter\", \"server\": \"foo\", \"value\": 1 }") != string::npos);
+	BOOST_CHECK (json.find ("{ \"name\": \"metrics_test_queue\", \"type\": \"gauge\", \"value\": 3 }") != string::npos);
+
+	string const text = m->prometheus ();
+	BOOST_CHECK (text.find ("# TYPE dcpomatic_metrics_test_frames_total counter\ndcpomatic_metrics_test_frames_total 3\n") != string::npos);
+	BOOST_CHECK (text.find ("dcpomatic_metrics_test_failures_total{server=\"foo\"} 1\n") != string::npos);
+	BOOST_CHECK (text.find ("# TYPE dcpomatic_metrics_test_queue gauge\ndcpomatic_metrics_test_queue 3\n") != string::npos);
+
+	m->set_enabled (false);
+}
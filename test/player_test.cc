@@ -42,6 +42,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/algorithm/string.hpp>
 #include <iostream>
+#include <algorithm>
 
 using std::cout;
 using std::list;
@@ -398,3 +399,128 @@ BOOST_AUTO_TEST_CASE (player_silence_at_end_crash)
 	film2->make_dcp ();
 	BOOST_REQUIRE (!wait_for_jobs());
 }
+
+/** Check that decoders are only opened when their content is about to be played and closed
+ *  when it has finished.
+ */
+BOOST_AUTO_TEST_CASE (player_decoder_lifetime_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("player_decoder_lifetime_test");
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (A);
+	shared_ptr<Content> B = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (B);
+	BOOST_REQUIRE (!wait_for_jobs());
+	A->video->set_length (24);
+	B->video->set_length (24);
+	A->set_position (film, DCPTime());
+	B->set_position (film, DCPTime::from_seconds(10));
+
+	shared_ptr<Player> player (new Player(film, film->playlist()));
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	shared_ptr<Piece> a = player->_pieces.front();
+	shared_ptr<Piece> b = player->_pieces.back();
+	BOOST_REQUIRE (a->content == A);
+
+	player->pass ();
+	BOOST_CHECK (a->decoder);
+	BOOST_CHECK (!b->decoder);
+
+	player->seek (DCPTime::from_seconds(10), true);
+	BOOST_CHECK (!a->decoder);
+	player->pass ();
+	BOOST_CHECK (b->decoder);
+
+	/* Seeking back should re-open A and close B */
+	player->seek (DCPTime(), true);
+	BOOST_CHECK (!b->decoder);
+	player->pass ();
+	BOOST_CHECK (a->decoder);
+	BOOST_CHECK (!b->decoder);
+
+	while (!player->pass ()) {}
+	BOOST_CHECK (!a->decoder);
+	BOOST_CHECK (!b->decoder);
+}
+
+/** Check that content changes only re-make the pieces that they need to */
+BOOST_AUTO_TEST_CASE (player_incremental_update_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("player_incremental_update_test");
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (A);
+	shared_ptr<Content> B = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (B);
+	BOOST_REQUIRE (!wait_for_jobs());
+	A->video->set_length (24);
+	B->video->set_length (24);
+	B->set_position (film, DCPTime::from_seconds(1));
+
+	shared_ptr<Player> player (new Player(film, film->playlist()));
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	shared_ptr<Piece> a = player->_pieces.front();
+	shared_ptr<Piece> b = player->_pieces.back();
+	player->pass ();
+	BOOST_REQUIRE (a->decoder);
+	shared_ptr<Decoder> a_decoder = a->decoder;
+
+	/* Changes to how the video is processed should leave everything alone */
+	A->video->set_left_crop (4);
+	A->video->set_fade_in (2);
+	BOOST_CHECK (player->_pieces.front() == a);
+	BOOST_CHECK (a->decoder == a_decoder);
+
+	/* Moving B should keep both pieces, and move the black */
+	B->set_position (film, DCPTime::from_seconds(2));
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	BOOST_CHECK (player->_pieces.front() == a);
+	BOOST_CHECK (player->_pieces.back() == b);
+	BOOST_CHECK (a->decoder == a_decoder);
+	BOOST_REQUIRE_EQUAL (player->_black._periods.size(), 1);
+	BOOST_CHECK (player->_black._periods.front() == DCPTimePeriod(DCPTime::from_seconds(1), DCPTime::from_seconds(2)));
+
+	/* Changing A's frame type should re-make only A's piece */
+	A->video->set_frame_type (VIDEO_FRAME_TYPE_3D_LEFT_RIGHT);
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	BOOST_CHECK (player->_pieces.front() != a);
+	BOOST_CHECK (!player->_pieces.front()->decoder);
+	BOOST_CHECK (player->_pieces.back() == b);
+}
+
+/** Check that changing the type of some text re-makes its piece and puts the new piece,
+ *  rather than the old one, in the queue that pass() works from.
+ */
+BOOST_AUTO_TEST_CASE (player_text_type_change_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("player_text_type_change_test");
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (A);
+	shared_ptr<StringTextFileContent> B (new StringTextFileContent("test/data/subrip.srt"));
+	film->examine_and_add_content (B);
+	BOOST_REQUIRE (!wait_for_jobs());
+	A->video->set_length (24);
+
+	shared_ptr<Player> player (new Player(film, film->playlist()));
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	shared_ptr<Piece> a = player->_pieces.front();
+	shared_ptr<Piece> b = player->_pieces.back();
+	BOOST_REQUIRE (b->content == B);
+	player->pass ();
+	BOOST_REQUIRE_EQUAL (player->_queue.size(), 2);
+
+	B->only_text()->set_type (TEXT_CLOSED_CAPTION);
+	BOOST_REQUIRE_EQUAL (player->_pieces.size(), 2);
+	BOOST_CHECK (player->_pieces.front() == a);
+	shared_ptr<Piece> new_b = player->_pieces.back();
+	BOOST_CHECK (new_b != b);
+	BOOST_CHECK (new_b->content == B);
+	BOOST_CHECK (!new_b->decoder);
+
+	BOOST_REQUIRE_EQUAL (player->_queue.size(), 2);
+	BOOST_CHECK (std::find(player->_queue.begin(), player->_queue.end(), new_b) != player->_queue.end());
+	BOOST_CHECK (std::find(player->_queue.begin(), player->_queue.end(), a) != player->_queue.end());
+	BOOST_CHECK (std::find(player->_queue.begin(), player->_queue.end(), b) == player->_queue.end());
+
+	while (!player->pass ()) {}
+	BOOST_CHECK (player->_queue.empty());
+}
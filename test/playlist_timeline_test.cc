@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/playlist_timeline_test.cc
+ *  @brief Test PlaylistTimeline and the Playlist methods which use it.
+ *  @ingroup specific
+ */
+
+#include "lib/film.h"
+#include "lib/playlist.h"
+#include "lib/playlist_timeline.h"
+#include "lib/content_factory.h"
+#include "lib/video_content.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+
+using std::vector;
+using boost::shared_ptr;
+
+BOOST_AUTO_TEST_CASE (playlist_timeline_test)
+{
+	shared_ptr<Film> film = new_test_film2 ("playlist_timeline_test");
+	film->set_sequence (false);
+	shared_ptr<Content> A = content_factory("test/data/flat_red.png").front();
+	shared_ptr<Content> B = content_factory("test/data/flat_red.png").front();
+	shared_ptr<Content> C = content_factory("test/data/flat_red.png").front();
+	film->examine_and_add_content (A);
+	film->examine_and_add_content (B);
+	film->examine_and_add_content (C);
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	A->video->set_length (24);
+	B->video->set_length (48);
+	C->video->set_length (24);
+	A->set_position (film, DCPTime());
+	B->set_position (film, DCPTime::from_seconds(1));
+	C->set_position (film, DCPTime::from_seconds(5));
+
+	shared_ptr<const Playlist> playlist = film->playlist ();
+	BOOST_CHECK (playlist->length(film) == DCPTime::from_seconds(6));
+	BOOST_CHECK (playlist->video_end(film) == DCPTime::from_seconds(6));
+	BOOST_REQUIRE (playlist->start());
+	BOOST_CHECK (*playlist->start() == DCPTime());
+
+	/* The same snapshot should be handed out until something changes */
+	shared_ptr<const PlaylistTimeline> timeline = playlist->timeline (film);
+	BOOST_CHECK (timeline == playlist->timeline(film));
+
+	vector<PlaylistTimeline::Entry> const & e = timeline->entries ();
+	BOOST_REQUIRE_EQUAL (e.size(), 3U);
+	BOOST_CHECK (e[0].content == A);
+	BOOST_CHECK (e[0].period == DCPTimePeriod(DCPTime(), DCPTime::from_seconds(1)));
+	BOOST_CHECK (e[1].content == B);
+	BOOST_CHECK (e[1].period == DCPTimePeriod(DCPTime::from_seconds(1), DCPTime::from_seconds(3)));
+	BOOST_CHECK (e[2].content == C);
+	BOOST_CHECK (e[2].period == DCPTimePeriod(DCPTime::from_seconds(5), DCPTime::from_seconds(6)));
+
+	/* Moving some content should give us a new snapshot */
+	C->set_position (film, DCPTime::from_seconds(7));
+	BOOST_CHECK (timeline != playlist->timeline(film));
+	BOOST_CHECK (playlist->length(film) == DCPTime::from_seconds(8));
+
+	/* and so should removing some */
+	film->remove_content (C);
+	BOOST_CHECK (playlist->length(film) == DCPTime::from_seconds(3));
+}
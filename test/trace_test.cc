@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/trace_test.cc
+ *  @brief Test Trace.
+ *  @ingroup selfcontained
+ */
+
+#include "lib/trace.h"
+#include "lib/cross.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using std::string;
+
+static string
+read_file (boost::filesystem::path file)
+{
+	FILE* f = fopen_boost (file, "r");
+	BOOST_REQUIRE (f);
+	string s;
+	char buffer[256];
+	while (fgets (buffer, sizeof(buffer), f)) {
+		s += buffer;
+	}
+	fclose (f);
+	return s;
+}
+
+BOOST_AUTO_TEST_CASE (trace_test)
+{
+	Trace* trace = Trace::instance ();
+	boost::filesystem::path const file = "build/test/trace_test.json";
+
+	trace->clear ();
+	trace->set_enabled (false);
+	trace->begin ("ignored");
+
+	trace->set_enabled (true);
+	{
+		TraceSpan span ("encode", 42);
+		trace->counter ("queue", 3);
+	}
+	trace->set_enabled (false);
+	trace->end ("ignored");
+
+	trace->write (file);
+	string const json = read_file (file);
+
+	BOOST_CHECK (json.find ("ignored") == string::npos);
+	BOOST_CHECK (json.find ("{\"name\":\"encode\",\"pid\":1,\"tid\":1,") != string::npos);
+	BOOST_CHECK (json.find ("\"ph\":\"B\",\"args\":{\"frame\":42}") != string::npos);
+	BOOST_CHECK (json.find ("\"ph\":\"E\",\"args\":{\"frame\":42}") != string::npos);
+	BOOST_CHECK (json.find ("\"name\":\"queue\"") != string::npos);
+	BOOST_CHECK (json.find ("\"ph\":\"C\",\"args\":{\"value\":3}") != string::npos);
+
+	trace->clear ();
+}